@@ -55,6 +55,8 @@ static const char *KEY_SENSOR_UPDATE_INTERVAL
 /* Graph settings */
 static const char *KEY_GRAPH_UPDATE_INTERVAL = "graph-update-interval";
 static const char *KEY_GRAPH_MONITORING_DURATION = "graph-monitoring-duration";
+static const char *KEY_GRAPH_HISTORY_PERSISTENT = "graph-history-persistent";
+static const char *KEY_SHM_ENABLED = "shm-enabled";
 static const char *KEY_GRAPH_BACKGROUND_COLOR = "graph-background-color";
 static const char *DEFAULT_GRAPH_BACKGROUND_COLOR = "#e8f4e8f4a8f5";
 static const char *KEY_GRAPH_BACKGROUND_ALPHA = "graph-background-alpha";
@@ -106,6 +108,16 @@ static const char *KEY_INTERFACE_TEMPERATURE_UNIT
 /* Sensor logging settings */
 static const char *KEY_SLOG_ENABLED = "slog-enabled";
 static const char *KEY_SLOG_INTERVAL = "slog-interval";
+static const char *KEY_SLOG_FORMAT = "slog-format";
+static const char *KEY_SLOG_SYNC = "slog-sync";
+static const char *KEY_SLOG_ROTATION_SIZE = "slog-rotation-size";
+static const char *KEY_SLOG_ROTATION_DAILY = "slog-rotation-daily";
+static const char *KEY_SLOG_ROTATION_KEEP = "slog-rotation-keep";
+static const char *KEY_SLOG_COMPRESSION = "slog-compression";
+
+/* Remote psensor-server settings */
+static const char *KEY_REMOTE_CONNECT_TIMEOUT = "remote-connect-timeout";
+static const char *KEY_REMOTE_TIMEOUT = "remote-timeout";
 
 /* Path to the script called when a notification is raised */
 static const char *KEY_NOTIFICATION_SCRIPT = "notif-script";
@@ -117,10 +129,18 @@ static const char *KEY_PROVIDER_ATIADLSDK_ENABLED
 = "provider-atiadlsdk-enabled";
 static const char *KEY_PROVIDER_GTOP2_ENABLED = "provider-gtop2-enabled";
 static const char *KEY_PROVIDER_HDDTEMP_ENABLED = "provider-hddtemp-enabled";
+static const char *KEY_PROVIDER_HDDTEMP_HOST = "provider-hddtemp-host";
+static const char *KEY_PROVIDER_HDDTEMP_PORT = "provider-hddtemp-port";
 static const char *KEY_PROVIDER_LIBATASMART_ENABLED
 = "provider-libatasmart-enabled";
 static const char *KEY_PROVIDER_NVCTRL_ENABLED = "provider-nvctrl-enabled";
 static const char *KEY_PROVIDER_UDISKS2_ENABLED = "provider-udisks2-enabled";
+static const char *KEY_PROVIDER_HWMON_DISK_ENABLED
+= "provider-hwmon-disk-enabled";
+static const char *KEY_PROVIDER_THERMAL_ENABLED = "provider-thermal-enabled";
+static const char *KEY_PROVIDER_CPUSTAT_ENABLED = "provider-cpustat-enabled";
+static const char *KEY_PROVIDER_PSI_ENABLED = "provider-psi-enabled";
+static const char *KEY_PROVIDER_PSI_TRIGGER = "provider-psi-trigger";
 
 static const char *KEY_DEFAULT_HIGH_THRESHOLD_TEMPERATURE
 = "default-high-threshold-temperature";
@@ -336,6 +356,73 @@ static void set_slog_interval(int interval)
 	set_int(KEY_SLOG_INTERVAL, interval);
 }
 
+enum slog_format config_get_slog_format(void)
+{
+	enum slog_format format;
+	char *str;
+
+	str = get_string(KEY_SLOG_FORMAT);
+
+	if (!str || !slog_format_from_str(str, &format)) {
+		log_warn(_("Unknown sensor log format: %s."), str);
+		format = SLOG_FORMAT_CSV;
+	}
+
+	free(str);
+
+	return format;
+}
+
+enum slog_sync config_get_slog_sync(void)
+{
+	enum slog_sync policy;
+	char *str;
+
+	str = get_string(KEY_SLOG_SYNC);
+
+	if (!str || !slog_sync_from_str(str, &policy)) {
+		log_warn(_("Unknown sensor log sync policy: %s."), str);
+		policy = SLOG_SYNC_NONE;
+	}
+
+	free(str);
+
+	return policy;
+}
+
+void config_get_slog_rotation(struct slog_rotation *r)
+{
+	char *str;
+	int v;
+
+	v = get_int(KEY_SLOG_ROTATION_SIZE);
+	r->max_size = v > 0 ? (off_t)v * 1024 * 1024 : 0;
+
+	r->daily = get_bool(KEY_SLOG_ROTATION_DAILY);
+
+	v = get_int(KEY_SLOG_ROTATION_KEEP);
+	r->keep = v > 0 ? v : 0;
+
+	str = get_string(KEY_SLOG_COMPRESSION);
+
+	if (!str || !slog_compression_from_str(str, &r->compression)) {
+		log_warn(_("Unknown sensor log compression: %s."), str);
+		r->compression = SLOG_COMPRESSION_NONE;
+	}
+
+	free(str);
+}
+
+int config_get_remote_connect_timeout(void)
+{
+	return get_int(KEY_REMOTE_CONNECT_TIMEOUT);
+}
+
+int config_get_remote_timeout(void)
+{
+	return get_int(KEY_REMOTE_TIMEOUT);
+}
+
 bool config_is_window_decoration_enabled(void)
 {
 	return !get_bool(KEY_INTERFACE_WINDOW_DECORATION_DISABLED);
@@ -886,11 +973,60 @@ bool config_is_udisks2_enabled(void)
 	return get_bool(KEY_PROVIDER_UDISKS2_ENABLED);
 }
 
+bool config_is_history_persistent(void)
+{
+	return get_bool(KEY_GRAPH_HISTORY_PERSISTENT);
+}
+
+bool config_is_shm_enabled(void)
+{
+	return get_bool(KEY_SHM_ENABLED);
+}
+
+bool config_is_hwmon_disk_enabled(void)
+{
+	return get_bool(KEY_PROVIDER_HWMON_DISK_ENABLED);
+}
+
+bool config_is_thermal_enabled(void)
+{
+	return get_bool(KEY_PROVIDER_THERMAL_ENABLED);
+}
+
+bool config_is_cpustat_enabled(void)
+{
+	return get_bool(KEY_PROVIDER_CPUSTAT_ENABLED);
+}
+
+bool config_is_psi_enabled(void)
+{
+	return get_bool(KEY_PROVIDER_PSI_ENABLED);
+}
+
+unsigned int config_get_psi_trigger(void)
+{
+	int v;
+
+	v = get_int(KEY_PROVIDER_PSI_TRIGGER);
+
+	return v > 0 ? v : 0;
+}
+
 bool config_is_hddtemp_enabled(void)
 {
 	return get_bool(KEY_PROVIDER_HDDTEMP_ENABLED);
 }
 
+char *config_get_hddtemp_host(void)
+{
+	return get_string(KEY_PROVIDER_HDDTEMP_HOST);
+}
+
+int config_get_hddtemp_port(void)
+{
+	return get_int(KEY_PROVIDER_HDDTEMP_PORT);
+}
+
 bool config_is_libatasmart_enabled(void)
 {
 	return get_bool(KEY_PROVIDER_LIBATASMART_ENABLED);
@@ -941,6 +1077,26 @@ void config_set_udisks2_enable(bool b)
 	set_bool(KEY_PROVIDER_UDISKS2_ENABLED, b);
 }
 
+void config_set_hwmon_disk_enable(bool b)
+{
+	set_bool(KEY_PROVIDER_HWMON_DISK_ENABLED, b);
+}
+
+void config_set_thermal_enable(bool b)
+{
+	set_bool(KEY_PROVIDER_THERMAL_ENABLED, b);
+}
+
+void config_set_cpustat_enable(bool b)
+{
+	set_bool(KEY_PROVIDER_CPUSTAT_ENABLED, b);
+}
+
+void config_set_psi_enable(bool b)
+{
+	set_bool(KEY_PROVIDER_PSI_ENABLED, b);
+}
+
 enum temperature_unit config_get_temperature_unit(void)
 {
 	return get_int(KEY_INTERFACE_TEMPERATURE_UNIT);
@@ -23,6 +23,7 @@
 
 #include <bool.h>
 #include <color.h>
+#include <slog.h>
 
 enum temperature_unit {
 	CELSIUS,
@@ -96,6 +97,13 @@ bool is_slog_enabled(void);
 void config_set_slog_enabled_changed_cbk(void (*)(void *), void *);
 
 int config_get_slog_interval(void);
+enum slog_format config_get_slog_format(void);
+enum slog_sync config_get_slog_sync(void);
+void config_get_slog_rotation(struct slog_rotation *r);
+
+/* Timeouts of the requests to the psensor-servers in milliseconds */
+int config_get_remote_connect_timeout(void);
+int config_get_remote_timeout(void);
 
 bool config_is_smooth_curves_enabled(void);
 void config_set_smooth_curves_enabled(bool);
@@ -118,7 +126,30 @@ void config_set_gtop2_enable(bool);
 bool config_is_udisks2_enabled(void);
 void config_set_udisks2_enable(bool);
 
+/* Whether the measures are kept across restarts, see pring.h. */
+bool config_is_history_persistent(void);
+
+/* Whether the current values are published, see psensor_shm.h. */
+bool config_is_shm_enabled(void);
+
+bool config_is_hwmon_disk_enabled(void);
+void config_set_hwmon_disk_enable(bool);
+
+bool config_is_thermal_enabled(void);
+void config_set_thermal_enable(bool);
+
+bool config_is_cpustat_enabled(void);
+void config_set_cpustat_enable(bool);
+
+bool config_is_psi_enabled(void);
+void config_set_psi_enable(bool);
+/* stall in milliseconds which triggers an update, 0 if disabled */
+unsigned int config_get_psi_trigger(void);
+
 bool config_is_hddtemp_enabled(void);
+/* Address of the hddtemp daemon, the returned string must be freed */
+char *config_get_hddtemp_host(void);
+int config_get_hddtemp_port(void);
 void config_set_hddtemp_enable(bool);
 
 bool config_is_libatasmart_enabled(void);
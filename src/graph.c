@@ -789,6 +789,10 @@ graph_update(struct psensor **sensors,
 				min = 0;
 				max = get_max_value(enabled_sensors,
 						    SENSOR_TYPE_PERCENT);
+			} else if (s->type & SENSOR_TYPE_FREQUENCY) {
+				min = 0;
+				max = get_max_value(enabled_sensors,
+						    SENSOR_TYPE_FREQUENCY);
 			} else {
 				min = mint;
 				max = maxt;
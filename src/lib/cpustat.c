@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cpustat.h>
+#include <psysfs.h>
+
+static const char *PROVIDER_NAME = "cpustat";
+
+static char *root;
+
+struct cpu_times {
+	uint64_t busy;
+	uint64_t total;
+};
+
+struct cpustat_data {
+	int cpu;
+	/* scaling_cur_freq for the frequency sensors, -1 otherwise */
+	int fd;
+	/* counters of the previous measure of the usage sensors */
+	struct cpu_times last;
+};
+
+/* content of /proc/stat, kept between the updates */
+static int stat_fd = -1;
+static char *buf;
+static size_t buf_size;
+
+/* counters of the last read of /proc/stat, indexed by cpu number */
+static struct cpu_times *times;
+static int times_len;
+
+void cpustat_set_root(const char *r)
+{
+	free(root);
+	root = r ? strdup(r) : NULL;
+
+	if (stat_fd != -1) {
+		close(stat_fd);
+		stat_fd = -1;
+	}
+}
+
+static void cpustat_data_free(void *data)
+{
+	struct cpustat_data *d;
+
+	d = data;
+
+	if (d->fd != -1)
+		close(d->fd);
+
+	free(d);
+}
+
+/*
+ * Reads /proc/stat in one call, the buffer is enlarged until the
+ * whole content fits into it.
+ */
+static bool read_stat(void)
+{
+	char *path;
+	ssize_t n;
+
+	if (stat_fd == -1) {
+		if (asprintf(&path, "%s/proc/stat", root ? root : "") == -1)
+			return false;
+
+		stat_fd = open(path, O_RDONLY | O_CLOEXEC);
+
+		if (stat_fd == -1)
+			log_err(_("%s: cannot open %s."), PROVIDER_NAME, path);
+
+		free(path);
+
+		if (stat_fd == -1)
+			return false;
+	}
+
+	if (!buf) {
+		buf_size = 4096;
+		buf = malloc(buf_size);
+	}
+
+	for (;;) {
+		n = pread(stat_fd, buf, buf_size, 0);
+
+		if (n < 0)
+			return false;
+
+		if ((size_t)n < buf_size) {
+			buf[n] = '\0';
+			return true;
+		}
+
+		buf_size *= 2;
+		buf = realloc(buf, buf_size);
+	}
+}
+
+static const char *parse_u64(const char *c, uint64_t *v)
+{
+	uint64_t r;
+
+	while (*c == ' ')
+		c++;
+
+	if (*c < '0' || *c > '9')
+		return NULL;
+
+	r = 0;
+	while (*c >= '0' && *c <= '9')
+		r = r * 10 + (*c++ - '0');
+
+	*v = r;
+
+	return c;
+}
+
+/*
+ * Parses the "cpuN user nice system idle iowait irq softirq steal"
+ * lines which are at the beginning of /proc/stat. The guest times
+ * are already included in user and nice. Returns the number of cpus.
+ */
+static int parse_stat(void)
+{
+	const char *c, *next;
+	uint64_t cpu, v[8];
+	int i, n;
+
+	n = 0;
+	c = buf;
+	while (!strncmp(c, "cpu", 3)) {
+		c += 3;
+
+		/* the first line is the sum of all cpus */
+		if (*c != ' ') {
+			c = parse_u64(c, &cpu);
+			if (!c)
+				break;
+
+			memset(v, 0, sizeof(v));
+			for (i = 0; i < 8; i++) {
+				next = parse_u64(c, &v[i]);
+				if (!next)
+					break;
+				c = next;
+			}
+
+			/* user, nice, system and idle are always present */
+			if (i < 4)
+				break;
+
+			if (cpu >= (uint64_t)times_len) {
+				times = realloc(times,
+						(cpu + 1) * sizeof(*times));
+				memset(times + times_len,
+				       0,
+				       (cpu + 1 - times_len) * sizeof(*times));
+				times_len = cpu + 1;
+			}
+
+			times[cpu].busy = v[0] + v[1] + v[2] + v[5] + v[6]
+				+ v[7];
+			times[cpu].total = times[cpu].busy + v[3] + v[4];
+
+			if (cpu + 1 > (uint64_t)n)
+				n = cpu + 1;
+		}
+
+		c = strchr(c, '\n');
+		if (!c)
+			break;
+		c++;
+	}
+
+	return n;
+}
+
+static int open_freq(int cpu)
+{
+	char *path;
+	int fd;
+
+	if (asprintf(&path,
+		     "%s/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq",
+		     root ? root : "",
+		     cpu) == -1)
+		return -1;
+
+	fd = sysfs_open(path);
+
+	free(path);
+
+	return fd;
+}
+
+static struct psensor *create_sensor(int cpu,
+				     int fd,
+				     unsigned int values_max_length)
+{
+	char *id, *name, *chip;
+	unsigned int type;
+	struct cpustat_data *data;
+	struct psensor *s;
+
+	type = SENSOR_TYPE_CPUSTAT | SENSOR_TYPE_CPU;
+
+	if (fd == -1) {
+		if (asprintf(&id, "%s cpu%d usage", PROVIDER_NAME, cpu) == -1
+		    || asprintf(&name, _("cpu%d usage"), cpu) == -1)
+			return NULL;
+		chip = strdup(_("CPU usage"));
+		type |= SENSOR_TYPE_PERCENT;
+	} else {
+		if (asprintf(&id, "%s cpu%d freq", PROVIDER_NAME, cpu) == -1
+		    || asprintf(&name, _("cpu%d frequency"), cpu) == -1)
+			return NULL;
+		chip = strdup(_("CPU frequency"));
+		type |= SENSOR_TYPE_FREQUENCY;
+	}
+
+	s = psensor_create(id, name, chip, type, values_max_length);
+
+	data = malloc(sizeof(*data));
+	data->cpu = cpu;
+	data->fd = fd;
+	if (cpu < times_len)
+		data->last = times[cpu];
+	else
+		memset(&data->last, 0, sizeof(data->last));
+
+	s->provider_data = data;
+	s->provider_data_free_fct = &cpustat_data_free;
+
+	return s;
+}
+
+void cpustat_psensor_list_append(struct psensor ***sensors,
+				 unsigned int values_max_length)
+{
+	int i, n, fd;
+	struct psensor *s;
+
+	if (!read_stat())
+		return;
+
+	n = parse_stat();
+
+	for (i = 0; i < n; i++) {
+		/* offline cpus are not listed */
+		if (!times[i].total)
+			continue;
+
+		s = create_sensor(i, -1, values_max_length);
+		if (s)
+			psensor_list_append(sensors, s);
+
+		fd = open_freq(i);
+		if (fd == -1)
+			continue;
+
+		s = create_sensor(i, fd, values_max_length);
+		if (s)
+			psensor_list_append(sensors, s);
+		else
+			close(fd);
+	}
+
+	log_debug("%s: %d cpus", PROVIDER_NAME, n);
+}
+
+static void usage_update(struct psensor *s, struct cpustat_data *d)
+{
+	struct cpu_times *t;
+	uint64_t dt;
+
+	if (d->cpu >= times_len)
+		return;
+
+	t = &times[d->cpu];
+
+	/* the counters restart when a cpu is put online again */
+	if (t->total > d->last.total && t->busy >= d->last.busy) {
+		dt = t->total - d->last.total;
+		psensor_set_current_value(s,
+					  100.0 * (t->busy - d->last.busy) / dt);
+	}
+
+	d->last = *t;
+}
+
+void cpustat_psensor_list_update(struct psensor **sensors)
+{
+	struct psensor *s;
+	struct cpustat_data *d;
+	bool parsed;
+	long v;
+
+	if (!sensors)
+		return;
+
+	parsed = false;
+
+	for (; *sensors; sensors++) {
+		s = *sensors;
+
+		if (s->type & SENSOR_TYPE_REMOTE
+		    || !(s->type & SENSOR_TYPE_CPUSTAT))
+			continue;
+
+		d = s->provider_data;
+
+		if (d->fd != -1) {
+			/* kHz */
+			if (sysfs_pread_long(d->fd, &v))
+				psensor_set_current_value(s, v / 1000.0);
+			continue;
+		}
+
+		if (!parsed) {
+			if (!read_stat())
+				return;
+			parse_stat();
+			parsed = true;
+		}
+
+		usage_update(s, d);
+	}
+}
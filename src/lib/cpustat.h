@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_CPUSTAT_H
+#define PSENSOR_CPUSTAT_H
+
+#include <psensor.h>
+
+/*
+ * Usage and frequency of each CPU core, read from /proc/stat and
+ * from the scaling_cur_freq attributes of the cpufreq sysfs
+ * directories.
+ *
+ * The root of /proc and /sys can be changed for testing, NULL for /.
+ */
+void cpustat_set_root(const char *root);
+
+void cpustat_psensor_list_append(struct psensor ***, unsigned int);
+void cpustat_psensor_list_update(struct psensor **);
+
+#endif
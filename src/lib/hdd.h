@@ -39,7 +39,60 @@ static inline void atasmart_psensor_list_update(struct psensor **s) {}
 
 #endif
 
+/*
+ * Disk temperatures of the kernel hwmon devices (drivetemp, nvme).
+ * The sysfs root can be changed for testing, NULL for /sys.
+ */
+void hwmon_disk_set_sysfs_root(const char *root);
+void hwmon_disk_psensor_list_append(struct psensor ***, unsigned int);
+void hwmon_disk_psensor_list_update(struct psensor **);
+
+/* Whether a block device (e.g. /dev/sda) is monitored through hwmon */
+bool hwmon_disk_has_device(struct psensor **, const char *dev);
+
+/*
+ * Whether a hwmon device (e.g. hwmon2 or its sysfs path) is monitored
+ * as a disk.
+ */
+bool hwmon_disk_has_hwmon(struct psensor **, const char *hwmon);
+
+/* A record of the hddtemp daemon output: |name|model|temp|unit| */
+struct hddtemp_record {
+	/* Device name, not null-terminated */
+	const char *name;
+	size_t name_len;
+	int temp;
+	/* false if the temperature is not a number (SLP, NA...) */
+	bool temp_valid;
+};
+
+/*
+ * Parses in place the record starting at 'str', returns the position
+ * of the next record or NULL if there is no valid record.
+ */
+const char *hddtemp_parse_next(const char *str, struct hddtemp_record *r);
+
+/*
+ * Address of the hddtemp daemon, NULL and 0 for the default host and
+ * port. 'timeout' is the maximum duration of a fetch in
+ * milliseconds, 0 for the default.
+ */
+void hddtemp_set_server(const char *host, unsigned int port, int timeout);
+
 void hddtemp_psensor_list_append(struct psensor ***sensors, unsigned int values_length);
+
+/*
+ * Retrieves the temperatures from the daemon. It does not access the
+ * sensors and must be called without holding the sensors mutex, the
+ * temperatures are applied by hddtemp_psensor_list_update.
+ */
+void hddtemp_fetch(void);
+
+/*
+ * A sensor created by hddtemp_psensor_list_append is only updated
+ * once it is in 'sensors', the monitored ones: until then its history
+ * can be loaded without the sensors mutex.
+ */
 void hddtemp_psensor_list_update(struct psensor **sensors);
 
 #endif
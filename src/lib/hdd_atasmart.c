@@ -25,12 +25,14 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <atasmart.h>
@@ -39,9 +41,37 @@
 #include "io.h"
 #include <hdd.h>
 #include <plog.h>
+#include <pmutex.h>
 
 static const char *PROVIDER_NAME = "atasmart";
 
+/* Minimum interval between two SMART reads of a disk in seconds */
+static const time_t SMART_UPDATE_INTERVAL = 30;
+
+/*
+ * A disk polled by the worker thread. The SMART reads are slow
+ * ioctls, they are done by the worker and the update of the sensors
+ * only publishes the last temperature.
+ */
+struct atasmart_disk {
+	SkDisk *disk;
+	char *path;
+	/* Last temperature in Celsius, UNKNOWN_DOUBLE_VALUE if none */
+	double temp;
+	time_t last_read;
+	/*
+	 * Set when the sensor is freed, the disk is then freed by the
+	 * worker which may be reading it.
+	 */
+	bool removed;
+	struct atasmart_disk *next;
+};
+
+/* Protects the disks list and the fields of the disks */
+static pthread_mutex_t disks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct atasmart_disk *disks;
+static bool worker_running;
+
 static int filter_sd(const char *p)
 {
 	return strlen(p) == 8 && !strncmp(p, "/dev/sd", 7);
@@ -49,16 +79,143 @@ static int filter_sd(const char *p)
 
 static void provider_data_free(void *data)
 {
-	sk_disk_free((SkDisk *)data);
+	pmutex_lock(&disks_mutex);
+	((struct atasmart_disk *)data)->removed = true;
+	pmutex_unlock(&disks_mutex);
+}
+
+static void disk_free(struct atasmart_disk *d)
+{
+	sk_disk_free(d->disk);
+	free(d->path);
+	free(d);
+}
+
+/*
+ * Reads the temperature of a disk unless it is in standby, the
+ * SMART read would wake it up.
+ */
+static void disk_read(struct atasmart_disk *d)
+{
+	SkBool awake;
+	uint64_t kelvin;
+	double c;
+
+	if (!sk_disk_check_sleep_mode(d->disk, &awake) && !awake) {
+		log_debug("%s: %s is sleeping.", PROVIDER_NAME, d->path);
+		return;
+	}
+
+	if (sk_disk_smart_read_data(d->disk)
+	    || sk_disk_smart_get_temperature(d->disk, &kelvin))
+		return;
+
+	c = (kelvin - 273150) / 1000;
+
+	log_functionname("%s %.2f", d->path, c);
+
+	pmutex_lock(&disks_mutex);
+	d->temp = c;
+	pmutex_unlock(&disks_mutex);
+}
+
+/*
+ * Removes the disks of the freed sensors, returns the disk which
+ * must be read next or NULL.
+ */
+static struct atasmart_disk *next_disk(time_t now)
+{
+	struct atasmart_disk **cur, *d, *ret;
+
+	ret = NULL;
+	cur = &disks;
+	while (*cur) {
+		d = *cur;
+
+		if (d->removed) {
+			*cur = d->next;
+			disk_free(d);
+			continue;
+		}
+
+		if (!ret && now - d->last_read >= SMART_UPDATE_INTERVAL)
+			ret = d;
+
+		cur = &d->next;
+	}
+
+	return ret;
+}
+
+static void *worker(void *data)
+{
+	struct atasmart_disk *d;
+	time_t now;
+
+	for (;;) {
+		now = time(NULL);
+
+		pmutex_lock(&disks_mutex);
+
+		d = next_disk(now);
+		if (d)
+			d->last_read = now;
+
+		if (!disks) {
+			worker_running = false;
+			pmutex_unlock(&disks_mutex);
+			break;
+		}
+
+		pmutex_unlock(&disks_mutex);
+
+		/* disks are only freed by this thread, no lock is needed */
+		if (d)
+			disk_read(d);
+		else
+			sleep(1);
+	}
+
+	return NULL;
 }
 
-static SkDisk *get_disk(struct psensor *s)
+static struct atasmart_disk *disk_add(SkDisk *disk, const char *path)
 {
-	return (SkDisk *)s->provider_data;
+	struct atasmart_disk *d;
+	pthread_t thread;
+
+	d = malloc(sizeof(struct atasmart_disk));
+	d->disk = disk;
+	d->path = strdup(path);
+	d->temp = UNKNOWN_DOUBLE_VALUE;
+	d->last_read = 0;
+	d->removed = false;
+
+	pmutex_lock(&disks_mutex);
+
+	d->next = disks;
+	disks = d;
+
+	if (!worker_running) {
+		if (pthread_create(&thread, NULL, worker, NULL)) {
+			log_err(_("%s: failed to create the worker thread."),
+				PROVIDER_NAME);
+		} else {
+			pthread_detach(thread);
+			worker_running = true;
+		}
+	}
+
+	pmutex_unlock(&disks_mutex);
+
+	return d;
 }
 
 static struct psensor *
-create_sensor(char *id, char *name, SkDisk *disk, unsigned int values_max_length)
+create_sensor(char *id,
+	      char *name,
+	      struct atasmart_disk *disk,
+	      unsigned int values_max_length)
 {
 	struct psensor *s;
 	int t;
@@ -134,6 +291,12 @@ atasmart_psensor_list_append(struct psensor ***sensors, unsigned int values_max_
 
 	tmp = paths;
 	while (*tmp) {
+		if (hwmon_disk_has_device(*sensors, *tmp)) {
+			log_functionname("%s monitored by hwmon", *tmp);
+			tmp++;
+			continue;
+		}
+
 		log_functionname("Open %s", *tmp);
 
 		if (!sk_disk_open(*tmp, &disk)) {
@@ -145,7 +308,7 @@ atasmart_psensor_list_append(struct psensor ***sensors, unsigned int values_max_
 
 			sensor = create_sensor(id,
 					       *tmp,
-					       disk,
+					       disk_add(disk, *tmp),
 					       values_max_length);
 
 			psensor_list_append(sensors, sensor);
@@ -167,35 +330,24 @@ atasmart_psensor_list_append(struct psensor ***sensors, unsigned int values_max_
 void atasmart_psensor_list_update(struct psensor **sensors)
 {
 	struct psensor **cur, *s;
-	uint64_t kelvin;
-	int ret;
+	struct atasmart_disk *d;
 	double c;
-	SkDisk *disk;
 
 	if (!sensors)
 		return;
 
-	cur = sensors;
-	while (*cur) {
+	for (cur = sensors; *cur; cur++) {
 		s = *cur;
 		if (!(s->type & SENSOR_TYPE_REMOTE)
 		    && s->type & SENSOR_TYPE_ATASMART) {
-			disk = get_disk(s);
+			d = s->provider_data;
 
-			ret = sk_disk_smart_read_data(disk);
+			pmutex_lock(&disks_mutex);
+			c = d->temp;
+			pmutex_unlock(&disks_mutex);
 
-			if (!ret) {
-				ret = sk_disk_smart_get_temperature(disk,
-								    &kelvin);
-
-				if (!ret) {
-					c = (kelvin - 273150) / 1000;
-					psensor_set_current_value(s, c);
-					log_functionname("%s %.2f", s->id, c);
-				}
-			}
+			if (c != UNKNOWN_DOUBLE_VALUE)
+				psensor_set_current_value(s, c);
 		}
-
-		cur++;
 	}
 }
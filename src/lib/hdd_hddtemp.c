@@ -25,158 +25,376 @@
 #include <libintl.h>
 #define _(str) gettext(str)
 
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <hdd.h>
+#include <pindex.h>
+#include <pmutex.h>
 #include <psensor.h>
 
 static const char *PROVIDER_NAME = "hddtemp";
 
-static const char *HDDTEMP_SERVER_IP_ADDRESS = "127.0.0.1";
-static const int HDDTEMP_PORT_NUMBER = 7634;
+static const char *HDDTEMP_DEFAULT_HOST = "127.0.0.1";
+static const unsigned int HDDTEMP_DEFAULT_PORT = 7634;
 static const size_t HDDTEMP_OUTPUT_BUFFER_LENGTH = 4048;
 
-struct hdd_info {
-	int temp;
-	char *name;
-};
+/* Maximum duration of a fetch in milliseconds */
+static const int HDDTEMP_DEFAULT_TIMEOUT = 2000;
 
-static char *fetch(void)
+/* Delay before connecting again to a failing daemon in seconds */
+static const time_t HDDTEMP_RETRY_DELAY = 30;
+
+static char *server_host;
+static unsigned int server_port;
+static int server_timeout;
+
+/*
+ * hddtemp_psensor_list_append runs in a discovery thread while the
+ * sensors are updated: it only sets 'enabled' and adds the new
+ * sensors to 'pending', under 'provider_mutex'.
+ */
+static pthread_mutex_t provider_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Whether hddtemp sensors have been created */
+static bool enabled;
+
+/*
+ * Sensors not updated yet: they are moved to the index by
+ * hddtemp_psensor_list_update once they are in its list, the
+ * history of a new sensor is loaded before.
+ */
+static struct psensor **pending;
+
+/*
+ * The index and the order are only used with the sensors mutex held,
+ * by hddtemp_psensor_list_update and by the adoption of a sensor.
+ */
+
+/* Associates the device names to the sensors */
+static struct pindex sensors_index;
+
+/*
+ * Sensors in the order of the records of the daemon output. The
+ * order does not change between two fetches, the sensor of a record
+ * is usually found without lookup.
+ */
+static struct psensor **sensors_order;
+static size_t sensors_order_n;
+
+/*
+ * Output of the last fetch, waiting to be parsed by
+ * hddtemp_psensor_list_update.
+ */
+static char *output;
+static pthread_mutex_t output_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Time before which no connection is attempted after a failure */
+static time_t retry_time;
+
+void hddtemp_set_server(const char *host, unsigned int port, int timeout)
 {
-	int sockfd;
-	size_t n = 1, output_length = 0;
-	char *pc, *buffer;
-	struct sockaddr_in address;
-
-	sockfd = socket(AF_INET, SOCK_STREAM, 0);
-	if (sockfd == -1) {
-		log_err(_("%s: failed to open socket."), PROVIDER_NAME);
-		return NULL;
-	}
+	free(server_host);
+
+	server_host = host ? strdup(host) : NULL;
+	server_port = port;
+	server_timeout = timeout;
+	retry_time = 0;
+}
 
-	address.sin_family = AF_INET;
-	address.sin_addr.s_addr = inet_addr(HDDTEMP_SERVER_IP_ADDRESS);
-	address.sin_port = htons(HDDTEMP_PORT_NUMBER);
+static long long get_time_ms(void)
+{
+	struct timespec ts;
 
-	buffer = NULL;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
-	if (connect(sockfd,
-		    (struct sockaddr *)&address,
-		    (socklen_t) sizeof(address)) == -1) {
-		log_err(_("%s: failed to open connection."), PROVIDER_NAME);
-	} else {
-		buffer = malloc(HDDTEMP_OUTPUT_BUFFER_LENGTH);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Waits for an event of a socket until a deadline, returns false on
+ * timeout or error.
+ */
+static bool wait_fd(int fd, short events, long long deadline)
+{
+	struct pollfd pfd;
+	long long now;
+	int ret;
 
-		pc = buffer;
-		while ((n = read(sockfd,
-				 pc,
-				 HDDTEMP_OUTPUT_BUFFER_LENGTH -
-				 output_length)) > 0) {
+	pfd.fd = fd;
+	pfd.events = events;
 
-			output_length += n;
-			pc = &pc[n];
+	do {
+		now = get_time_ms();
+		if (now >= deadline)
+			return false;
+
+		ret = poll(&pfd, 1, deadline - now);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret > 0;
+}
+
+/*
+ * Starts a non-blocking connection to the daemon and waits for its
+ * completion, returns the socket or -1.
+ */
+static int connect_server(long long deadline)
+{
+	struct addrinfo hints, *res, *ai;
+	char port[sizeof("4294967295")];
+	int fd, err;
+	socklen_t len;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_NUMERICSERV;
+
+	snprintf(port, sizeof(port), "%u",
+		 server_port ? server_port : HDDTEMP_DEFAULT_PORT);
+
+	if (getaddrinfo(server_host ? server_host : HDDTEMP_DEFAULT_HOST,
+			port,
+			&hints,
+			&res))
+		return -1;
+
+	fd = -1;
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd == -1)
+			continue;
+
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+		if (!connect(fd, ai->ai_addr, ai->ai_addrlen))
+			break;
+
+		if (errno == EINPROGRESS && wait_fd(fd, POLLOUT, deadline)) {
+			len = sizeof(err);
+			if (!getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len)
+			    && !err)
+				break;
 		}
 
-		buffer[output_length] = '\0';
+		close(fd);
+		fd = -1;
 	}
 
-	close(sockfd);
+	freeaddrinfo(res);
 
-	return buffer;
+	return fd;
 }
 
-static int str_index(char *str, char d)
+/*
+ * Retrieves the output of the daemon which sends the temperatures
+ * of the disks and closes the connection. Returns NULL on failure or
+ * if the daemon does not answer before the timeout.
+ */
+static char *fetch(void)
 {
-	char *c;
-	int i;
+	int fd, timeout;
+	ssize_t n;
+	size_t len;
+	char *buffer;
+	long long deadline;
+	time_t now;
+
+	now = time(NULL);
+	if (now < retry_time)
+		return NULL;
 
-	if (!str || *str == '\0')
-		return -1;
+	timeout = server_timeout > 0 ? server_timeout : HDDTEMP_DEFAULT_TIMEOUT;
+	deadline = get_time_ms() + timeout;
 
-	c = str;
+	fd = connect_server(deadline);
+	if (fd == -1) {
+		log_err(_("%s: failed to open connection."), PROVIDER_NAME);
+		retry_time = now + HDDTEMP_RETRY_DELAY;
+		return NULL;
+	}
 
-	i = 0;
-	while (*c) {
-		if (*c == d)
-			return i;
-		i++;
-		c++;
+	buffer = malloc(HDDTEMP_OUTPUT_BUFFER_LENGTH);
+
+	len = 0;
+	while (len < HDDTEMP_OUTPUT_BUFFER_LENGTH - 1) {
+		n = read(fd, buffer + len, HDDTEMP_OUTPUT_BUFFER_LENGTH - 1 - len);
+
+		if (n > 0) {
+			len += n;
+		} else if (!n) {
+			break;
+		} else if (errno == EINTR) {
+			continue;
+		} else if (errno != EAGAIN || !wait_fd(fd, POLLIN, deadline)) {
+			log_err(_("%s: failed to read the temperatures."),
+				PROVIDER_NAME);
+			retry_time = now + HDDTEMP_RETRY_DELAY;
+			free(buffer);
+			buffer = NULL;
+			break;
+		}
 	}
 
-	return -1;
+	close(fd);
+
+	if (buffer)
+		buffer[len] = '\0';
+
+	return buffer;
+}
+
+static bool is_enabled(void)
+{
+	bool ret;
+
+	pmutex_lock(&provider_mutex);
+	ret = enabled;
+	pmutex_unlock(&provider_mutex);
+
+	return ret;
+}
+
+void hddtemp_fetch(void)
+{
+	char *buffer;
+
+	if (!is_enabled())
+		return;
+
+	buffer = fetch();
+
+	pmutex_lock(&output_mutex);
+	free(output);
+	output = buffer;
+	pmutex_unlock(&output_mutex);
+}
+
+static void replace(struct psensor **sensors,
+		    struct psensor *old,
+		    struct psensor *s)
+{
+	if (sensors)
+		for (; *sensors; sensors++)
+			if (*sensors == old)
+				*sensors = s;
+}
+
+/*
+ * Called with the sensors mutex held, as hddtemp_psensor_list_update:
+ * the sensor is usually still pending, it is only adopted when it is
+ * found again.
+ */
+static void adopt(struct psensor *dst, struct psensor *src)
+{
+	size_t i;
+
+	pmutex_lock(&provider_mutex);
+
+	replace(pending, src, dst);
+
+	for (i = 0; i < sensors_index.n; i++)
+		if (sensors_index.entries[i].data == src)
+			sensors_index.entries[i].data = dst;
+
+	for (i = 0; i < sensors_order_n; i++)
+		if (sensors_order[i] == src)
+			sensors_order[i] = dst;
+
+	pmutex_unlock(&provider_mutex);
 }
 
 static struct psensor *
 create_sensor(char *id, char *name, unsigned int values_max_length)
 {
+	struct psensor *s;
 	unsigned int t;
 
 	t = SENSOR_TYPE_HDD | SENSOR_TYPE_HDDTEMP | SENSOR_TYPE_TEMP;
 
-	return psensor_create(id, name, strdup(_("Disk")),
-			      t,
-			      values_max_length);
+	s = psensor_create(id, name, strdup(_("Disk")),
+			   t,
+			   values_max_length);
+	s->provider_adopt_fct = &adopt;
+
+	return s;
 }
 
-static char *next_hdd_info(char *string, struct hdd_info *info)
+/* Parses an integer field, returns false if it is not a number. */
+static bool parse_temp(const char *str, const char *end, int *temp)
 {
-	char *c;
-	int idx_name_n, i, temp;
+	bool neg;
+	int v;
 
-	if (!string || strlen(string) <= 5	/* at least 5 pipes */
-	    || string[0] != '|')
-		return NULL;
+	neg = str < end && *str == '-';
+	if (neg)
+		str++;
 
-	/* skip first pipe */
-	c = string + 1;
+	if (str == end)
+		return false;
 
-	/* name */
-	idx_name_n = str_index(c, '|');
+	v = 0;
+	for (; str < end; str++) {
+		if (*str < '0' || *str > '9' || v > 100000)
+			return false;
+		v = v * 10 + (*str - '0');
+	}
 
-	if (idx_name_n == -1)
-		return NULL;
-	c = c + idx_name_n + 1;
+	*temp = neg ? -v : v;
 
-	/* skip label */
-	i = str_index(c, '|');
-	if (i == -1)
-		return NULL;
-	c = c + i + 1;
+	return true;
+}
 
-	/* temp */
-	i = str_index(c, '|');
-	if (i == -1)
-		return NULL;
-	temp = atoi(c);
-	c = c + i + 1;
+const char *hddtemp_parse_next(const char *str, struct hddtemp_record *r)
+{
+	const char *fields[4], *c;
+	int i;
 
-	/* skip unit  */
-	i = str_index(c, '|');
-	if (i == -1)
+	if (!str || *str != '|')
 		return NULL;
-	c = c + i + 1;
 
-	info->name = malloc(idx_name_n + 1);
-	strncpy(info->name, string + 1, idx_name_n);
-	info->name[idx_name_n] = '\0';
+	/* |name|model|temp|unit| */
+	c = str + 1;
+	for (i = 0; i < 4; i++) {
+		fields[i] = c;
+
+		c = strchr(c, '|');
+		if (!c)
+			return NULL;
+		c++;
+	}
 
-	info->temp = temp;
+	r->name = fields[0];
+	r->name_len = fields[1] - fields[0] - 1;
+	r->temp_valid = parse_temp(fields[2], fields[3] - 1, &r->temp);
 
 	return c;
 }
 
+static void sensors_order_add(struct psensor *s)
+{
+	sensors_order = realloc(sensors_order,
+				(sensors_order_n + 1) * sizeof(struct psensor *));
+	sensors_order[sensors_order_n++] = s;
+}
+
 void
 hddtemp_psensor_list_append(struct psensor ***sensors, unsigned int values_max_length)
 {
-	char *hddtemp_output, *c, *id;
-	struct hdd_info info;
+	char *hddtemp_output, *id, *name;
+	const char *c;
+	struct hddtemp_record r;
 	struct psensor *sensor;
 
 	hddtemp_output = fetch();
@@ -195,73 +413,118 @@ hddtemp_psensor_list_append(struct psensor ***sensors, unsigned int values_max_l
 
 	c = hddtemp_output;
 
-	while (c && (c = next_hdd_info(c, &info))) {
-		id = malloc(strlen(PROVIDER_NAME) + 1 + strlen(info.name) + 1);
-		sprintf(id, "%s %s", PROVIDER_NAME, info.name);
+	pmutex_lock(&provider_mutex);
+
+	if (!pending) {
+		pending = malloc(sizeof(struct psensor *));
+		*pending = NULL;
+	}
+
+	while ((c = hddtemp_parse_next(c, &r))) {
+		name = strndup(r.name, r.name_len);
+
+		id = malloc(strlen(PROVIDER_NAME) + 1 + r.name_len + 1);
+		sprintf(id, "%s %s", PROVIDER_NAME, name);
+
+		if (pindex_get(&sensors_index, name)
+		    || psensor_list_get_by_id(pending, id)
+		    || hwmon_disk_has_device(*sensors, name)) {
+			free(id);
+			free(name);
+			continue;
+		}
 
-		sensor = create_sensor(id, info.name, values_max_length);
+		sensor = create_sensor(id, name, values_max_length);
 
 		psensor_list_append(sensors, sensor);
+		psensor_list_append(&pending, sensor);
+
+		enabled = true;
 	}
 
+	pmutex_unlock(&provider_mutex);
+
 	free(hddtemp_output);
 }
 
-static void update(struct psensor **sensors, struct hdd_info *info)
+static bool list_has(struct psensor **sensors, struct psensor *s)
+{
+	for (; *sensors; sensors++)
+		if (*sensors == s)
+			return true;
+
+	return false;
+}
+
+/* Indexes the pending sensors which are now in 'sensors'. */
+static void publish_pending(struct psensor **sensors)
 {
-	while (*sensors) {
-		if (!((*sensors)->type & SENSOR_TYPE_REMOTE)
-		    && (*sensors)->type & SENSOR_TYPE_HDDTEMP
-		    && !strcmp((*sensors)->id + 8, info->name))
-			psensor_set_current_value(*sensors,
-						  (double)info->temp);
-
-		sensors++;
+	struct psensor **cur;
+
+	if (!pending)
+		return;
+
+	cur = pending;
+	while (*cur) {
+		if (list_has(sensors, *cur)) {
+			pindex_add(&sensors_index, (*cur)->name, *cur);
+			sensors_order_add(*cur);
+			/* the next one is moved to 'cur' */
+			psensor_list_remove(pending, *cur);
+		} else {
+			cur++;
+		}
 	}
 }
 
-static bool contains_hddtemp_sensor(struct psensor **sensors)
+static struct psensor *get_sensor(const struct hddtemp_record *r, size_t i)
 {
 	struct psensor *s;
 
-	if (!sensors)
-		return false;
-
-	while (*sensors) {
-		s = *sensors;
-		if (!(s->type & SENSOR_TYPE_REMOTE)
-		     && (s->type & SENSOR_TYPE_HDDTEMP))
-			return true;
-		sensors++;
+	if (i < sensors_order_n) {
+		s = sensors_order[i];
+		if (!strncmp(s->name, r->name, r->name_len)
+		    && !s->name[r->name_len])
+			return s;
 	}
 
-	return false;
+	return pindex_getn(&sensors_index, r->name, r->name_len);
 }
 
 void hddtemp_psensor_list_update(struct psensor **sensors)
 {
 	char *hddtemp_output;
+	const char *c;
+	struct hddtemp_record r;
+	struct psensor *s;
+	size_t i;
+	bool e;
 
-	if (!contains_hddtemp_sensor(sensors))
+	pmutex_lock(&provider_mutex);
+	e = enabled;
+	if (e)
+		publish_pending(sensors);
+	pmutex_unlock(&provider_mutex);
+
+	if (!e)
 		return;
 
-	hddtemp_output = fetch();
+	pmutex_lock(&output_mutex);
+	hddtemp_output = output;
+	output = NULL;
+	pmutex_unlock(&output_mutex);
 
 	if (!hddtemp_output)
 		return;
 
 	if (hddtemp_output[0] == '|') {
-		char *c = hddtemp_output;
-		struct hdd_info info;
-
-		info.name = NULL;
-		info.temp = 0;
-
-		while (c && (c = next_hdd_info(c, &info))) {
-
-			update(sensors, &info);
-
-			free(info.name);
+		c = hddtemp_output;
+		i = 0;
+		while ((c = hddtemp_parse_next(c, &r))) {
+			s = get_sensor(&r, i);
+			if (s && r.temp_valid)
+				psensor_set_current_value(s, r.temp);
+			i++;
 		}
 	} else {
 		log_err(_("%s: wrong string: %s."),
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+/*
+ * Temperatures of the disks exposed by the kernel through hwmon:
+ * drivetemp for SATA disks and the nvme driver for NVMe drives.
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hdd.h>
+#include <io.h>
+#include <psysfs.h>
+
+static const char *PROVIDER_NAME = "hwmon";
+
+static const char *DEFAULT_SYSFS_ROOT = "/sys";
+
+/* Maximum index of the temperature attributes of a device */
+static const int TEMP_MAX_INDEX = 8;
+
+static char *sysfs_root;
+
+struct hwmon_data {
+	/* Opened tempN_input attribute */
+	int fd;
+	/* Block device, e.g. /dev/sda */
+	char *dev;
+	/* Name of the hwmon directory, e.g. hwmon2 */
+	char *hwmon;
+	/* Watched tempN_alarm and tempN_crit_alarm attributes or -1 */
+	int alarm_fds[2];
+};
+
+void hwmon_disk_set_sysfs_root(const char *root)
+{
+	free(sysfs_root);
+	sysfs_root = root ? strdup(root) : NULL;
+}
+
+static void hwmon_data_free(void *data)
+{
+	struct hwmon_data *d;
+
+	d = data;
+
+	close(d->fd);
+	sysfs_alarm_unwatch(d->alarm_fds[0]);
+	sysfs_alarm_unwatch(d->alarm_fds[1]);
+	free(d->dev);
+	free(d->hwmon);
+	free(d);
+}
+
+static int filter_nvme_ns(const char *path)
+{
+	const char *name;
+
+	name = sysfs_basename(path);
+
+	return !strncmp(name, "nvme", 4) && strchr(name + 4, 'n');
+}
+
+/*
+ * Returns the first entry of a directory matching a filter, NULL if
+ * there is none. The returned string must be freed.
+ */
+static char *dir_first(const char *dir, int (*filter)(const char *))
+{
+	char **paths, *ret;
+
+	paths = dir_list(dir, filter);
+	if (!paths)
+		return NULL;
+
+	ret = *paths ? strdup(sysfs_basename(*paths)) : NULL;
+
+	paths_free(paths);
+
+	return ret;
+}
+
+/*
+ * Returns the block device of a hwmon device, e.g. /dev/sda, or NULL
+ * if it is not a disk.
+ */
+static char *get_block_device(const char *hwmon_dir, const char *driver)
+{
+	char *dir, *name, *dev;
+
+	dev = NULL;
+	name = NULL;
+
+	if (!strcmp(driver, "drivetemp")) {
+		/* device is the SCSI device which has a block/sdX entry */
+		dir = sysfs_path_printf("%s/device/block", hwmon_dir);
+		name = dir_first(dir, NULL);
+		free(dir);
+	} else if (!strcmp(driver, "nvme")) {
+		/* device is the controller, the namespaces are nvmeXnY */
+		dir = sysfs_path_printf("%s/device", hwmon_dir);
+		name = dir_first(dir, filter_nvme_ns);
+		free(dir);
+	}
+
+	if (name) {
+		dev = sysfs_path_printf("/dev/%s", name);
+		free(name);
+	}
+
+	return dev;
+}
+
+static struct psensor *create_sensor(const char *hwmon_dir,
+				     const char *dev,
+				     const char *model,
+				     int i,
+				     bool several,
+				     unsigned int values_max_length)
+{
+	struct psensor *s;
+	struct hwmon_data *data;
+	char *path, *id, *name, *label;
+	int fd, type;
+	long v;
+
+	path = sysfs_path_printf("%s/temp%d_input", hwmon_dir, i);
+	fd = sysfs_open(path);
+	free(path);
+
+	if (fd == -1)
+		return NULL;
+
+	if (several) {
+		path = sysfs_path_printf("%s/temp%d_label", hwmon_dir, i);
+		label = sysfs_read_str(path);
+		free(path);
+
+		id = sysfs_path_printf("%s %s %d", PROVIDER_NAME, dev, i);
+		if (label)
+			name = sysfs_path_printf("%s %s", dev, label);
+		else
+			name = sysfs_path_printf("%s %d", dev, i);
+
+		free(label);
+	} else {
+		id = sysfs_path_printf("%s %s", PROVIDER_NAME, dev);
+		name = strdup(dev);
+	}
+
+	type = SENSOR_TYPE_HWMON | SENSOR_TYPE_HDD | SENSOR_TYPE_TEMP;
+
+	s = psensor_create(id,
+			   name,
+			   strdup(model ? model : _("Disk")),
+			   type,
+			   values_max_length);
+
+	path = sysfs_path_printf("%s/temp%d_crit", hwmon_dir, i);
+	if (sysfs_read_long(path, &v)) {
+		s->max = v / 1000.0;
+	} else {
+		free(path);
+		path = sysfs_path_printf("%s/temp%d_max", hwmon_dir, i);
+		if (sysfs_read_long(path, &v))
+			s->max = v / 1000.0;
+	}
+	free(path);
+
+	data = malloc(sizeof(struct hwmon_data));
+	data->fd = fd;
+	data->dev = strdup(dev);
+	data->hwmon = strdup(sysfs_basename(hwmon_dir));
+
+	path = sysfs_path_printf("%s/temp%d_alarm", hwmon_dir, i);
+	data->alarm_fds[0] = sysfs_alarm_watch(path);
+	free(path);
+
+	path = sysfs_path_printf("%s/temp%d_crit_alarm", hwmon_dir, i);
+	data->alarm_fds[1] = sysfs_alarm_watch(path);
+	free(path);
+
+	s->provider_data = data;
+	s->provider_data_free_fct = &hwmon_data_free;
+
+	return s;
+}
+
+static void hwmon_append(struct psensor ***sensors,
+			 const char *hwmon_dir,
+			 unsigned int values_max_length)
+{
+	char *driver, *dev, *model, *path;
+	struct psensor *s;
+	int i, n;
+	bool inputs[TEMP_MAX_INDEX + 1];
+
+	path = sysfs_path_printf("%s/name", hwmon_dir);
+	driver = sysfs_read_str(path);
+	free(path);
+
+	if (!driver)
+		return;
+
+	dev = get_block_device(hwmon_dir, driver);
+	free(driver);
+
+	if (!dev)
+		return;
+
+	path = sysfs_path_printf("%s/device/model", hwmon_dir);
+	model = sysfs_read_str(path);
+	free(path);
+
+	n = 0;
+	for (i = 1; i <= TEMP_MAX_INDEX; i++) {
+		path = sysfs_path_printf("%s/temp%d_input", hwmon_dir, i);
+		inputs[i] = is_file(path);
+		free(path);
+
+		if (inputs[i])
+			n++;
+	}
+
+	for (i = 1; i <= TEMP_MAX_INDEX; i++) {
+		if (!inputs[i])
+			continue;
+
+		s = create_sensor(hwmon_dir,
+				  dev,
+				  model,
+				  i,
+				  n > 1,
+				  values_max_length);
+		if (s) {
+			log_functionname("%s: %s", PROVIDER_NAME, s->id);
+			psensor_list_append(sensors, s);
+		}
+	}
+
+	free(model);
+	free(dev);
+}
+
+void hwmon_disk_psensor_list_append(struct psensor ***sensors,
+				    unsigned int values_max_length)
+{
+	char *dir, **paths, **cur;
+
+	dir = sysfs_path_printf("%s/class/hwmon",
+			  sysfs_root ? sysfs_root : DEFAULT_SYSFS_ROOT);
+
+	paths = dir_list(dir, NULL);
+	free(dir);
+
+	if (!paths)
+		return;
+
+	for (cur = paths; *cur; cur++)
+		hwmon_append(sensors, *cur, values_max_length);
+
+	paths_free(paths);
+}
+
+static struct hwmon_data *get_data(struct psensor *s)
+{
+	if (s->type & SENSOR_TYPE_REMOTE
+	    || !(s->type & SENSOR_TYPE_HWMON)
+	    || !(s->type & SENSOR_TYPE_HDD))
+		return NULL;
+
+	return s->provider_data;
+}
+
+void hwmon_disk_psensor_list_update(struct psensor **sensors)
+{
+	struct psensor *s;
+	struct hwmon_data *data;
+	long v;
+
+	if (!sensors)
+		return;
+
+	for (; *sensors; sensors++) {
+		s = *sensors;
+
+		data = get_data(s);
+		if (!data)
+			continue;
+
+		if (sysfs_pread_long(data->fd, &v))
+			psensor_set_current_value(s, v / 1000.0);
+	}
+}
+
+bool hwmon_disk_has_device(struct psensor **sensors, const char *dev)
+{
+	struct hwmon_data *data;
+
+	if (!sensors)
+		return false;
+
+	for (; *sensors; sensors++) {
+		data = get_data(*sensors);
+		if (data && !strcmp(data->dev, dev))
+			return true;
+	}
+
+	return false;
+}
+
+bool hwmon_disk_has_hwmon(struct psensor **sensors, const char *hwmon)
+{
+	struct hwmon_data *data;
+
+	if (!sensors)
+		return false;
+
+	hwmon = sysfs_basename(hwmon);
+
+	for (; *sensors; sensors++) {
+		data = get_data(*sensors);
+		if (data && !strcmp(data->hwmon, hwmon))
+			return true;
+	}
+
+	return false;
+}
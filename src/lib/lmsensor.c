@@ -27,7 +27,9 @@
 #include <sensors/sensors.h>
 #include <sensors/error.h>
 
+#include <hdd.h>
 #include <lmsensor.h>
+#include <psysfs.h>
 
 static int init_done;
 
@@ -37,6 +39,10 @@ struct lmsensor_data {
 	const sensors_chip_name *chip;
 
 	const sensors_feature *feature;
+
+	/* watched *_alarm attributes of the feature */
+	int *alarm_fds;
+	int alarm_fds_len;
 };
 
 static const sensors_chip_name *get_chip_name(struct psensor *s)
@@ -49,6 +55,74 @@ static const sensors_feature *get_feature(struct psensor *s)
 	return ((struct lmsensor_data *)s->provider_data)->feature;
 }
 
+static void lmsensor_data_free(void *data)
+{
+	struct lmsensor_data *d;
+	int i;
+
+	d = data;
+
+	for (i = 0; i < d->alarm_fds_len; i++)
+		sysfs_alarm_unwatch(d->alarm_fds[i]);
+
+	free(d->alarm_fds);
+	free(d);
+}
+
+static bool is_alarm(const sensors_subfeature *sf)
+{
+	size_t n;
+
+	if (!(sf->flags & SENSORS_MODE_R))
+		return false;
+
+	n = strlen(sf->name);
+
+	return n > 6 && !strcmp(sf->name + n - 6, "_alarm");
+}
+
+/*
+ * Watches the alarm attributes of the feature so that a raised alarm
+ * is noticed without waiting for the next update.
+ */
+static void watch_alarms(struct lmsensor_data *data)
+{
+	const sensors_subfeature *sf;
+	char *path;
+	int i, fd;
+
+	if (!data->chip->path)
+		return;
+
+	i = 0;
+	while ((sf = sensors_get_all_subfeatures(data->chip,
+						 data->feature,
+						 &i))) {
+		if (!is_alarm(sf))
+			continue;
+
+		path = malloc(strlen(data->chip->path)
+			      + 1
+			      + strlen(sf->name)
+			      + 1);
+		sprintf(path, "%s/%s", data->chip->path, sf->name);
+
+		fd = sysfs_alarm_watch(path);
+
+		if (fd != -1) {
+			log_debug("%s: watching %s", PROVIDER_NAME, path);
+
+			data->alarm_fds = realloc(data->alarm_fds,
+						  (data->alarm_fds_len + 1)
+						  * sizeof(int));
+			data->alarm_fds[data->alarm_fds_len] = fd;
+			data->alarm_fds_len++;
+		}
+
+		free(path);
+	}
+}
+
 static void lmsensor_data_set(struct psensor *s,
 			      const struct sensors_chip_name *chip,
 			      const struct sensors_feature *feature)
@@ -58,8 +132,11 @@ static void lmsensor_data_set(struct psensor *s,
 	data = malloc(sizeof(struct lmsensor_data));
 	data->chip = chip;
 	data->feature = feature;
+	data->alarm_fds = NULL;
+	data->alarm_fds_len = 0;
 
 	s->provider_data = data;
+	s->provider_data_free_fct = &lmsensor_data_free;
 }
 
 static double get_value(const sensors_chip_name *name,
@@ -228,10 +305,12 @@ lmsensor_psensor_create(const sensors_chip_name *chip,
 
 	if (feature->type == SENSORS_FEATURE_TEMP
 	    && (get_temp_input(psensor) == UNKNOWN_DOUBLE_VALUE)) {
-		free(psensor);
+		psensor_free(psensor);
 		return NULL;
 	}
 
+	watch_alarms(psensor->provider_data);
+
 	return psensor;
 }
 
@@ -266,6 +345,9 @@ void lmsensor_psensor_list_append(struct psensor ***sensors, unsigned int values
 
 	chip_nr = 0;
 	while ((chip = sensors_get_detected_chips(NULL, &chip_nr))) {
+		/* disks are monitored by the hwmon disk provider */
+		if (chip->path && hwmon_disk_has_hwmon(*sensors, chip->path))
+			continue;
 
 		i = 0;
 		while ((feature = sensors_get_features(chip, &i))) {
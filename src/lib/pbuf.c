@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pbuf.h>
+#include <plog.h>
+
+static const size_t PBUF_MIN_SIZE = 256;
+
+void pbuf_init(struct pbuf *b, size_t size)
+{
+	b->data = NULL;
+	b->len = 0;
+	b->size = 0;
+	b->err = false;
+
+	if (size)
+		pbuf_reserve(b, size);
+}
+
+void pbuf_reset(struct pbuf *b)
+{
+	b->len = 0;
+	b->err = false;
+
+	if (b->data)
+		*b->data = '\0';
+}
+
+void pbuf_free(struct pbuf *b)
+{
+	free(b->data);
+
+	b->data = NULL;
+	b->len = 0;
+	b->size = 0;
+}
+
+bool pbuf_reserve(struct pbuf *b, size_t n)
+{
+	size_t size;
+	char *tmp;
+
+	if (b->err)
+		return false;
+
+	/* +1 for the trailing '\0' */
+	if (b->len + n + 1 <= b->size)
+		return true;
+
+	size = b->size ? b->size : PBUF_MIN_SIZE;
+	while (size < b->len + n + 1)
+		size *= 2;
+
+	tmp = realloc(b->data, size);
+	if (!tmp) {
+		log_err("pbuf: failed to allocate %zu bytes", size);
+		b->err = true;
+		return false;
+	}
+
+	b->data = tmp;
+	b->size = size;
+
+	return true;
+}
+
+void pbuf_append(struct pbuf *b, const char *s, size_t n)
+{
+	if (!pbuf_reserve(b, n))
+		return;
+
+	memcpy(b->data + b->len, s, n);
+	b->len += n;
+	b->data[b->len] = '\0';
+}
+
+void pbuf_append_str(struct pbuf *b, const char *s)
+{
+	pbuf_append(b, s, strlen(s));
+}
+
+void pbuf_append_char(struct pbuf *b, char c)
+{
+	if (!pbuf_reserve(b, 1))
+		return;
+
+	b->data[b->len++] = c;
+	b->data[b->len] = '\0';
+}
+
+void pbuf_printf(struct pbuf *b, const char *fmt, ...)
+{
+	va_list ap;
+	size_t avail;
+	int n;
+
+	if (!pbuf_reserve(b, 64))
+		return;
+
+	avail = b->size - b->len;
+
+	va_start(ap, fmt);
+	n = vsnprintf(b->data + b->len, avail, fmt, ap);
+	va_end(ap);
+
+	if (n < 0)
+		return;
+
+	if ((size_t)n >= avail) {
+		if (!pbuf_reserve(b, n))
+			return;
+
+		va_start(ap, fmt);
+		vsnprintf(b->data + b->len, n + 1, fmt, ap);
+		va_end(ap);
+	}
+
+	b->len += n;
+}
+
+char *pbuf_detach(struct pbuf *b)
+{
+	char *str;
+
+	if (b->err || !pbuf_reserve(b, 0)) {
+		pbuf_free(b);
+		b->err = false;
+		return NULL;
+	}
+
+	str = b->data;
+
+	b->data = NULL;
+	b->len = 0;
+	b->size = 0;
+
+	return str;
+}
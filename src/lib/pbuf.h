@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PBUF_H
+#define PSENSOR_PBUF_H
+
+#include <stddef.h>
+
+#include <bool.h>
+
+/*
+ * Growable character buffer.
+ *
+ * The memory is kept between successive uses (see pbuf_reset) so
+ * that a serialization done at each update does not allocate once
+ * the buffer has reached its working size.
+ */
+struct pbuf {
+	char *data;
+	/* Number of used bytes, the trailing '\0' is not counted */
+	size_t len;
+	/* Number of allocated bytes */
+	size_t size;
+	/* Whether an allocation failed, the content is then truncated */
+	bool err;
+};
+
+void pbuf_init(struct pbuf *b, size_t size);
+void pbuf_reset(struct pbuf *b);
+void pbuf_free(struct pbuf *b);
+
+/* Ensures that 'n' more bytes can be appended. */
+bool pbuf_reserve(struct pbuf *b, size_t n);
+
+void pbuf_append(struct pbuf *b, const char *s, size_t n);
+void pbuf_append_str(struct pbuf *b, const char *s);
+void pbuf_append_char(struct pbuf *b, char c);
+void pbuf_printf(struct pbuf *b, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/*
+ * Returns the content as an allocated null-terminated string and
+ * leaves the buffer empty. Returns NULL if an allocation failed.
+ */
+char *pbuf_detach(struct pbuf *b);
+
+#endif
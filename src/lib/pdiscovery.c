@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <pdiscovery.h>
+#include <pmutex.h>
+
+struct discovery;
+
+struct task {
+	struct pdiscovery_provider provider;
+	struct discovery *discovery;
+	struct psensor **sensors;
+	bool done;
+};
+
+struct discovery {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	struct task *tasks;
+	int tasks_len;
+	int running;
+
+	size_t seed_len;
+	unsigned int values_len;
+
+	pdiscovery_cbk cbk;
+	pdiscovery_done_cbk done;
+	void *data;
+
+	struct timespec start;
+};
+
+static long elapsed_ms(const struct timespec *start)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (t.tv_sec - start->tv_sec) * 1000
+		+ (t.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void discovery_free(struct discovery *d)
+{
+	int i;
+
+	for (i = 0; i < d->tasks_len; i++)
+		free(d->tasks[i].sensors);
+
+	pthread_cond_destroy(&d->cond);
+	pthread_mutex_destroy(&d->mutex);
+
+	free(d->tasks);
+	free(d);
+}
+
+static void *task_routine(void *data)
+{
+	struct task *t;
+	struct discovery *d;
+	struct psensor **result, **cur;
+	long ms;
+
+	t = data;
+	d = t->discovery;
+
+	t->provider.append(&t->sensors, d->values_len);
+
+	if (t->provider.append_after)
+		t->provider.append_after(&t->sensors, d->values_len);
+
+	ms = elapsed_ms(&d->start);
+
+	log_info(_("%s: discovery done in %ld ms."), t->provider.name, ms);
+
+	/* the seed sensors are not part of the result */
+	result = malloc(sizeof(struct psensor *));
+	*result = NULL;
+	for (cur = t->sensors + d->seed_len; *cur; cur++)
+		psensor_list_append(&result, *cur);
+
+	d->cbk(t->provider.name, result, d->data);
+
+	pmutex_lock(&d->mutex);
+	t->done = true;
+	d->running--;
+	pthread_cond_signal(&d->cond);
+	pmutex_unlock(&d->mutex);
+
+	return NULL;
+}
+
+static bool is_before(const struct timespec *t1, const struct timespec *t2)
+{
+	return t1->tv_sec < t2->tv_sec
+		|| (t1->tv_sec == t2->tv_sec && t1->tv_nsec < t2->tv_nsec);
+}
+
+static struct timespec get_deadline(struct discovery *d, struct task *t)
+{
+	struct timespec ts;
+
+	ts = d->start;
+	ts.tv_sec += t->provider.deadline_ms / 1000;
+	ts.tv_nsec += (t->provider.deadline_ms % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	return ts;
+}
+
+/*
+ * Waits for the tasks, reports those exceeding their deadline and
+ * frees the discovery once all are done.
+ */
+static void *monitor_routine(void *data)
+{
+	struct discovery *d;
+	struct task *t;
+	struct timespec now, next, deadline;
+	bool *reported;
+	bool has_next;
+	int i;
+
+	d = data;
+
+	reported = calloc(d->tasks_len, sizeof(bool));
+
+	pmutex_lock(&d->mutex);
+
+	while (d->running) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		has_next = false;
+
+		for (i = 0; i < d->tasks_len; i++) {
+			t = &d->tasks[i];
+
+			if (t->done || reported[i])
+				continue;
+
+			deadline = get_deadline(d, t);
+
+			if (!is_before(&now, &deadline)) {
+				log_warn(_("%s: discovery exceeds %u ms."),
+					 t->provider.name,
+					 t->provider.deadline_ms);
+				reported[i] = true;
+				continue;
+			}
+
+			if (!has_next || is_before(&deadline, &next)) {
+				next = deadline;
+				has_next = true;
+			}
+		}
+
+		if (has_next)
+			pthread_cond_timedwait(&d->cond, &d->mutex, &next);
+		else
+			pthread_cond_wait(&d->cond, &d->mutex);
+	}
+
+	pmutex_unlock(&d->mutex);
+
+	log_info(_("Discovery of the sensors done in %ld ms."),
+		 elapsed_ms(&d->start));
+
+	if (d->done)
+		d->done(d->data);
+
+	free(reported);
+	discovery_free(d);
+
+	return NULL;
+}
+
+void pdiscovery_start(const struct pdiscovery_provider *providers,
+		      int n,
+		      struct psensor **seed,
+		      unsigned int values_len,
+		      pdiscovery_cbk cbk,
+		      pdiscovery_done_cbk done,
+		      void *data)
+{
+	struct discovery *d;
+	struct task *t;
+	pthread_condattr_t attr;
+	pthread_t thread;
+	int i;
+
+	d = malloc(sizeof(struct discovery));
+
+	pmutex_init(&d->mutex);
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&d->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	d->tasks = calloc(n, sizeof(struct task));
+	d->tasks_len = n;
+	d->running = 0;
+	d->seed_len = psensor_list_size(seed);
+	d->values_len = values_len;
+	d->cbk = cbk;
+	d->done = done;
+	d->data = data;
+
+	clock_gettime(CLOCK_MONOTONIC, &d->start);
+
+	pmutex_lock(&d->mutex);
+
+	for (i = 0; i < n; i++) {
+		t = &d->tasks[i];
+
+		t->provider = providers[i];
+		t->discovery = d;
+		t->sensors = psensor_list_copy(seed);
+
+		if (pthread_create(&thread, NULL, task_routine, t)) {
+			log_err(_("%s: failed to create the discovery thread."),
+				t->provider.name);
+			t->done = true;
+			continue;
+		}
+
+		pthread_detach(thread);
+		d->running++;
+	}
+
+	pmutex_unlock(&d->mutex);
+
+	if (pthread_create(&thread, NULL, monitor_routine, d)) {
+		/* the discovery is never freed */
+		log_err(_("Failed to create the discovery monitor thread."));
+		return;
+	}
+
+	pthread_detach(thread);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PDISCOVERY_H
+#define PSENSOR_PDISCOVERY_H
+
+#include <psensor.h>
+
+/* A xxx_psensor_list_append function of a provider. */
+typedef void (*pdiscovery_fct)(struct psensor ***, unsigned int);
+
+struct pdiscovery_provider {
+	const char *name;
+	pdiscovery_fct append;
+	/*
+	 * Optional, called after 'append' in the same thread and with
+	 * the same list, e.g. when it skips the sensors of 'append'.
+	 */
+	pdiscovery_fct append_after;
+	/* a warning is logged when the discovery exceeds it */
+	unsigned int deadline_ms;
+};
+
+/*
+ * Called from the thread of a provider once its discovery is done
+ * with the null-terminated list of the sensors it found (possibly
+ * empty), to be freed by the callback.
+ */
+typedef void (*pdiscovery_cbk)(const char *name,
+			       struct psensor **sensors,
+			       void *data);
+
+/*
+ * Called from a thread of the discovery once all the providers are
+ * done, may be NULL.
+ */
+typedef void (*pdiscovery_done_cbk)(void *data);
+
+/*
+ * Starts the discovery of the providers in parallel, one thread per
+ * provider because they mostly wait for devices or daemons, and
+ * returns immediately.
+ *
+ * 'seed' is the list of the sensors already known: each provider
+ * starts from a copy of it (e.g. to skip the disks of the hwmon
+ * provider) but they are not part of the results.
+ *
+ * The duration of each discovery is logged. A provider still running
+ * after its deadline is reported; its sensors are given to 'cbk'
+ * whenever it finishes, 'done' is called after the last one.
+ */
+void pdiscovery_start(const struct pdiscovery_provider *providers,
+		      int n,
+		      struct psensor **seed,
+		      unsigned int values_len,
+		      pdiscovery_cbk cbk,
+		      pdiscovery_done_cbk done,
+		      void *data);
+
+#endif
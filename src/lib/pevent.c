@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <pevent.h>
+#include <plog.h>
+#include <pmutex.h>
+
+struct pevent_entry {
+	int fd;
+	short events;
+	pevent_cbk cbk;
+	void *data;
+};
+
+/* protects the entries, held while a callback is running */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pevent_entry *entries;
+static int entries_len;
+
+static bool started;
+/* written to interrupt the poll when the entries change */
+static int ctl[2] = {-1, -1};
+
+static pthread_mutex_t wakeup_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup_cond;
+static bool wakeup_requested;
+
+static void interrupt(void)
+{
+	char c;
+
+	c = 0;
+	if (write(ctl[1], &c, 1) == -1 && errno != EAGAIN)
+		log_err("pevent: write: %s", strerror(errno));
+}
+
+static void drain(void)
+{
+	char buf[64];
+
+	while (read(ctl[0], buf, sizeof(buf)) > 0)
+		;
+}
+
+static struct pevent_entry *get_entry(int fd)
+{
+	int i;
+
+	for (i = 0; i < entries_len; i++)
+		if (entries[i].fd == fd)
+			return &entries[i];
+
+	return NULL;
+}
+
+static void entry_remove(int fd)
+{
+	struct pevent_entry *e;
+
+	e = get_entry(fd);
+	if (!e)
+		return;
+
+	*e = entries[entries_len - 1];
+	entries_len--;
+}
+
+static void *loop(void *data)
+{
+	struct pollfd *fds;
+	struct pevent_entry *e;
+	int i, n, ret;
+
+	fds = NULL;
+
+	for (;;) {
+		pmutex_lock(&lock);
+
+		n = entries_len + 1;
+		fds = realloc(fds, n * sizeof(*fds));
+
+		fds[0].fd = ctl[0];
+		fds[0].events = POLLIN;
+
+		for (i = 1; i < n; i++) {
+			fds[i].fd = entries[i - 1].fd;
+			fds[i].events = entries[i - 1].events;
+		}
+
+		pmutex_unlock(&lock);
+
+		ret = poll(fds, n, -1);
+
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+
+			log_err("pevent: poll: %s", strerror(errno));
+			break;
+		}
+
+		if (fds[0].revents)
+			drain();
+
+		pmutex_lock(&lock);
+
+		for (i = 1; i < n; i++) {
+			if (!fds[i].revents)
+				continue;
+
+			/* removed meanwhile */
+			e = get_entry(fds[i].fd);
+			if (!e)
+				continue;
+
+			if (fds[i].revents & POLLNVAL) {
+				log_err(_("pevent: invalid file descriptor %d."),
+					fds[i].fd);
+				entry_remove(fds[i].fd);
+				continue;
+			}
+
+			if (!e->cbk(fds[i].fd, fds[i].revents, e->data))
+				entry_remove(fds[i].fd);
+		}
+
+		pmutex_unlock(&lock);
+	}
+
+	free(fds);
+
+	return NULL;
+}
+
+static bool start(void)
+{
+	pthread_t thread;
+	int i;
+
+	if (pipe(ctl) == -1) {
+		log_err("pevent: pipe: %s", strerror(errno));
+		return false;
+	}
+
+	for (i = 0; i < 2; i++) {
+		fcntl(ctl[i], F_SETFL, O_NONBLOCK);
+		fcntl(ctl[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	if (pthread_create(&thread, NULL, loop, NULL)) {
+		log_err(_("pevent: failed to create the thread."));
+		close(ctl[0]);
+		close(ctl[1]);
+		return false;
+	}
+
+	pthread_detach(thread);
+
+	started = true;
+
+	return true;
+}
+
+bool pevent_add(int fd, short events, pevent_cbk cbk, void *data)
+{
+	struct pevent_entry *e;
+	bool ret;
+
+	pmutex_lock(&lock);
+
+	ret = started || start();
+
+	if (ret) {
+		entries = realloc(entries,
+				  (entries_len + 1) * sizeof(*entries));
+
+		e = &entries[entries_len];
+		e->fd = fd;
+		e->events = events;
+		e->cbk = cbk;
+		e->data = data;
+
+		entries_len++;
+
+		interrupt();
+	}
+
+	pmutex_unlock(&lock);
+
+	return ret;
+}
+
+void pevent_remove(int fd)
+{
+	pmutex_lock(&lock);
+
+	entry_remove(fd);
+
+	if (started)
+		interrupt();
+
+	pmutex_unlock(&lock);
+}
+
+static void wakeup_init(void)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&wakeup_cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+static pthread_once_t wakeup_once = PTHREAD_ONCE_INIT;
+
+void pevent_wakeup(void)
+{
+	pthread_once(&wakeup_once, wakeup_init);
+
+	pmutex_lock(&wakeup_mutex);
+
+	wakeup_requested = true;
+	pthread_cond_signal(&wakeup_cond);
+
+	pmutex_unlock(&wakeup_mutex);
+}
+
+bool pevent_wait(unsigned int timeout_ms)
+{
+	struct timespec t;
+	bool ret;
+
+	pthread_once(&wakeup_once, wakeup_init);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	t.tv_sec += timeout_ms / 1000;
+	t.tv_nsec += (timeout_ms % 1000) * 1000000L;
+	if (t.tv_nsec >= 1000000000L) {
+		t.tv_sec++;
+		t.tv_nsec -= 1000000000L;
+	}
+
+	pmutex_lock(&wakeup_mutex);
+
+	while (!wakeup_requested)
+		if (pthread_cond_timedwait(&wakeup_cond,
+					   &wakeup_mutex,
+					   &t) == ETIMEDOUT)
+			break;
+
+	ret = wakeup_requested;
+	wakeup_requested = false;
+
+	pmutex_unlock(&wakeup_mutex);
+
+	return ret;
+}
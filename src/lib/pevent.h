@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PEVENT_H
+#define PSENSOR_PEVENT_H
+
+#include <bool.h>
+
+/*
+ * A thread shared by the providers to wait for events on file
+ * descriptors (PSI triggers, sysfs notifications, ...) and wake up
+ * the update loop before the end of its interval.
+ */
+
+/*
+ * Called from the event thread when 'fd' is ready, must not block
+ * nor call pevent_add or pevent_remove. Returns false to stop
+ * watching 'fd', e.g. on error.
+ */
+typedef bool (*pevent_cbk)(int fd, short revents, void *data);
+
+/* Watches 'fd' for 'events' (poll() flags), starts the thread. */
+bool pevent_add(int fd, short events, pevent_cbk cbk, void *data);
+
+/*
+ * Stops watching 'fd'. The callback is not running anymore when it
+ * returns.
+ */
+void pevent_remove(int fd);
+
+/* Requests an immediate update of the sensors. */
+void pevent_wakeup(void);
+
+/*
+ * Sleeps until 'timeout_ms' milliseconds elapsed or pevent_wakeup is
+ * called. Returns whether it has been woken up.
+ */
+bool pevent_wait(unsigned int timeout_ms);
+
+#endif
@@ -27,8 +27,8 @@
 
 #include <pgtop2.h>
 
-static float last_used;
-static float last_total;
+static guint64 last_used;
+static guint64 last_total;
 
 static const char *PROVIDER_NAME = "gtop2";
 
@@ -69,7 +69,7 @@ static struct psensor *create_mem_free_sensor(unsigned int measures_len)
 static double get_usage(void)
 {
 	glibtop_cpu cpu;
-	unsigned long int used, dt;
+	guint64 used, dt;
 	double cpu_rate;
 
 	glibtop_get_cpu(&cpu);
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <pindex.h>
+
+static int keycmp(const char *k1, size_t n1, const char *k2, size_t n2)
+{
+	int ret;
+
+	ret = memcmp(k1, k2, n1 < n2 ? n1 : n2);
+	if (ret)
+		return ret;
+
+	if (n1 < n2)
+		return -1;
+
+	return n1 > n2;
+}
+
+static int entry_cmp(const void *p1, const void *p2)
+{
+	const struct pindex_entry *e1 = p1, *e2 = p2;
+
+	return keycmp(e1->key, e1->key_len, e2->key, e2->key_len);
+}
+
+void pindex_init(struct pindex *idx)
+{
+	idx->entries = NULL;
+	idx->n = 0;
+	idx->size = 0;
+	idx->sorted = true;
+}
+
+void pindex_cleanup(struct pindex *idx)
+{
+	size_t i;
+
+	for (i = 0; i < idx->n; i++)
+		free(idx->entries[i].key);
+
+	free(idx->entries);
+
+	pindex_init(idx);
+}
+
+void pindex_add(struct pindex *idx, const char *key, void *data)
+{
+	struct pindex_entry *tmp, *e;
+
+	if (idx->n == idx->size) {
+		idx->size = idx->size ? 2 * idx->size : 16;
+
+		tmp = realloc(idx->entries,
+			      idx->size * sizeof(struct pindex_entry));
+		if (!tmp) {
+			idx->size = idx->n;
+			return;
+		}
+
+		idx->entries = tmp;
+	}
+
+	e = &idx->entries[idx->n];
+	e->key = strdup(key);
+	e->key_len = strlen(key);
+	e->data = data;
+
+	idx->n++;
+	idx->sorted = false;
+}
+
+void *pindex_getn(struct pindex *idx, const char *key, size_t len)
+{
+	size_t lo, hi, mid;
+	struct pindex_entry *e;
+	int cmp;
+
+	if (!idx->n)
+		return NULL;
+
+	if (!idx->sorted) {
+		qsort(idx->entries,
+		      idx->n,
+		      sizeof(struct pindex_entry),
+		      entry_cmp);
+		idx->sorted = true;
+	}
+
+	lo = 0;
+	hi = idx->n;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		e = &idx->entries[mid];
+
+		cmp = keycmp(key, len, e->key, e->key_len);
+		if (!cmp)
+			return e->data;
+
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+void *pindex_get(struct pindex *idx, const char *key)
+{
+	return pindex_getn(idx, key, strlen(key));
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PINDEX_H
+#define PSENSOR_PINDEX_H
+
+#include <stddef.h>
+
+#include <bool.h>
+
+/*
+ * Index associating strings (sensor ids, device names...) to
+ * pointers.
+ *
+ * Entries are kept in a sorted array, lookups are binary searches.
+ * It is meant to be built once (when sensors are created) and then
+ * used for each update.
+ */
+struct pindex_entry {
+	char *key;
+	size_t key_len;
+	void *data;
+};
+
+struct pindex {
+	struct pindex_entry *entries;
+	size_t n;
+	size_t size;
+	bool sorted;
+};
+
+void pindex_init(struct pindex *idx);
+
+/* Frees the memory used by the index, the data are not freed. */
+void pindex_cleanup(struct pindex *idx);
+
+/* Adds an entry, the key is copied. */
+void pindex_add(struct pindex *idx, const char *key, void *data);
+
+/* Returns the data associated to a key or NULL. */
+void *pindex_get(struct pindex *idx, const char *key);
+
+/*
+ * Same as pindex_get but the key is the 'len' first characters of
+ * 'key' which does not need to be null-terminated.
+ */
+void *pindex_getn(struct pindex *idx, const char *key, size_t len);
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <pjson.h>
+
+static const char HEX[] = "0123456789abcdef";
+
+/* Doubles below this bound are exactly representable integers. */
+static const double INT_FAST_PATH_MAX = 9007199254740992.0; /* 2^53 */
+
+void pjson_init(struct pjson *w, struct pbuf *buf)
+{
+	w->buf = buf;
+	w->depth = 0;
+	w->empty[0] = true;
+	w->key = false;
+}
+
+/* Writes the separator required before a new element. */
+static void element_begin(struct pjson *w)
+{
+	if (w->key) {
+		w->key = false;
+		return;
+	}
+
+	if (w->depth) {
+		if (w->empty[w->depth])
+			pbuf_append_char(w->buf, ' ');
+		else
+			pbuf_append(w->buf, ", ", 2);
+	}
+
+	w->empty[w->depth] = false;
+}
+
+static void container_begin(struct pjson *w, char c)
+{
+	element_begin(w);
+	pbuf_append_char(w->buf, c);
+
+	if (w->depth < PJSON_MAX_DEPTH - 1)
+		w->depth++;
+
+	w->empty[w->depth] = true;
+}
+
+static void container_end(struct pjson *w, char c)
+{
+	char end[2] = { ' ', c };
+
+	pbuf_append(w->buf, end, 2);
+
+	if (w->depth)
+		w->depth--;
+}
+
+void pjson_object_begin(struct pjson *w)
+{
+	container_begin(w, '{');
+}
+
+void pjson_object_end(struct pjson *w)
+{
+	container_end(w, '}');
+}
+
+void pjson_array_begin(struct pjson *w)
+{
+	container_begin(w, '[');
+}
+
+void pjson_array_end(struct pjson *w)
+{
+	container_end(w, ']');
+}
+
+static void escape_append(struct pbuf *buf, const char *str)
+{
+	const unsigned char *c, *start;
+	char esc[6];
+
+	start = (const unsigned char *)str;
+	for (c = start; *c; c++) {
+		switch (*c) {
+		case '\b':
+			esc[1] = 'b';
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		case '\f':
+			esc[1] = 'f';
+			break;
+		case '"':
+		case '\\':
+		case '/':
+			esc[1] = *c;
+			break;
+		default:
+			if (*c >= ' ')
+				continue;
+			esc[1] = 'u';
+			break;
+		}
+
+		pbuf_append(buf, (const char *)start, c - start);
+		start = c + 1;
+
+		esc[0] = '\\';
+		if (esc[1] == 'u') {
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = HEX[*c >> 4];
+			esc[5] = HEX[*c & 0x0f];
+			pbuf_append(buf, esc, 6);
+		} else {
+			pbuf_append(buf, esc, 2);
+		}
+	}
+
+	pbuf_append(buf, (const char *)start, c - start);
+}
+
+static void string_append(struct pbuf *buf, const char *str)
+{
+	pbuf_append_char(buf, '"');
+	escape_append(buf, str);
+	pbuf_append_char(buf, '"');
+}
+
+void pjson_key(struct pjson *w, const char *key)
+{
+	element_begin(w);
+	string_append(w->buf, key);
+	pbuf_append(w->buf, ": ", 2);
+
+	w->key = true;
+}
+
+void pjson_string(struct pjson *w, const char *str)
+{
+	element_begin(w);
+	string_append(w->buf, str);
+}
+
+/*
+ * Appends the decimal representation of a non-negative integer
+ * lower than 2^53.
+ */
+static void uint_append(struct pbuf *buf, uint64_t v)
+{
+	char tmp[20];
+	int i;
+
+	i = sizeof(tmp);
+	do {
+		tmp[--i] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+
+	pbuf_append(buf, tmp + i, sizeof(tmp) - i);
+}
+
+void pjson_double_append(struct pbuf *buf, double d)
+{
+	char tmp[128], *p;
+	int n;
+
+	if (isnan(d)) {
+		pbuf_append_str(buf, "NaN");
+		return;
+	}
+
+	if (isinf(d)) {
+		pbuf_append_str(buf, d > 0 ? "Infinity" : "-Infinity");
+		return;
+	}
+
+	/*
+	 * Fast path for integral values (most of the fan speeds and
+	 * many temperatures): "%.17g" prints them without exponent
+	 * and json-c appends ".0".
+	 */
+	if (d == floor(d) && fabs(d) < INT_FAST_PATH_MAX) {
+		if (signbit(d)) {
+			pbuf_append_char(buf, '-');
+			d = -d;
+		}
+		uint_append(buf, (uint64_t)d);
+		pbuf_append(buf, ".0", 2);
+		return;
+	}
+
+	n = snprintf(tmp, sizeof(tmp), "%.17g", d);
+	if (n < 0)
+		return;
+
+	/* The decimal separator depends on the locale. */
+	p = strchr(tmp, ',');
+	if (p)
+		*p = '.';
+	else
+		p = strchr(tmp, '.');
+
+	if (!p && !strchr(tmp, 'e') && n < (int)sizeof(tmp) - 2) {
+		memcpy(tmp + n, ".0", 3);
+		n += 2;
+	}
+
+	pbuf_append(buf, tmp, n);
+}
+
+void pjson_double(struct pjson *w, double d)
+{
+	element_begin(w);
+	pjson_double_append(w->buf, d);
+}
+
+void pjson_int(struct pjson *w, int i)
+{
+	element_begin(w);
+
+	if (i < 0) {
+		pbuf_append_char(w->buf, '-');
+		uint_append(w->buf, -(int64_t)i);
+	} else {
+		uint_append(w->buf, i);
+	}
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PJSON_H
+#define PSENSOR_PJSON_H
+
+#include <bool.h>
+#include <pbuf.h>
+
+#define PJSON_MAX_DEPTH 16
+
+/*
+ * Streaming JSON writer.
+ *
+ * Values are directly appended to a pbuf, no intermediate tree is
+ * built.  The output is byte-identical to json-c's
+ * json_object_to_json_string() (JSON_C_TO_STRING_SPACED, json-c >=
+ * 0.13) so that clients parsing the previous output are not
+ * affected.
+ */
+struct pjson {
+	struct pbuf *buf;
+	int depth;
+	/* Whether the current container has no element yet */
+	bool empty[PJSON_MAX_DEPTH];
+	/* Whether a key has just been written */
+	bool key;
+};
+
+void pjson_init(struct pjson *w, struct pbuf *buf);
+
+void pjson_object_begin(struct pjson *w);
+void pjson_object_end(struct pjson *w);
+void pjson_array_begin(struct pjson *w);
+void pjson_array_end(struct pjson *w);
+
+void pjson_key(struct pjson *w, const char *key);
+
+void pjson_string(struct pjson *w, const char *str);
+void pjson_double(struct pjson *w, double d);
+void pjson_int(struct pjson *w, int i);
+
+/* Appends the json-c representation of a double to a buffer. */
+void pjson_double_append(struct pbuf *buf, double d);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <math.h>
+
+#include <pjson.h>
+#include <pmetrics.h>
+
+void pmetrics_init(struct pmetrics *w, struct pbuf *buf)
+{
+	w->buf = buf;
+	w->labels = false;
+}
+
+/* Escapes the HELP text: backslash and line feed. */
+static void help_append(struct pbuf *b, const char *s)
+{
+	for (; *s; s++)
+		if (*s == '\\')
+			pbuf_append(b, "\\\\", 2);
+		else if (*s == '\n')
+			pbuf_append(b, "\\n", 2);
+		else
+			pbuf_append_char(b, *s);
+}
+
+void pmetrics_family(struct pmetrics *w,
+		     const char *name,
+		     const char *type,
+		     const char *help)
+{
+	pbuf_append(w->buf, "# HELP ", 7);
+	pbuf_append_str(w->buf, name);
+	pbuf_append_char(w->buf, ' ');
+	help_append(w->buf, help);
+
+	pbuf_append(w->buf, "\n# TYPE ", 8);
+	pbuf_append_str(w->buf, name);
+	pbuf_append_char(w->buf, ' ');
+	pbuf_append_str(w->buf, type);
+	pbuf_append_char(w->buf, '\n');
+}
+
+void pmetrics_sample_begin(struct pmetrics *w, const char *name)
+{
+	pbuf_append_str(w->buf, name);
+	w->labels = false;
+}
+
+void pmetrics_label(struct pmetrics *w, const char *key, const char *value)
+{
+	const char *s;
+
+	pbuf_append_char(w->buf, w->labels ? ',' : '{');
+	w->labels = true;
+
+	pbuf_append_str(w->buf, key);
+	pbuf_append(w->buf, "=\"", 2);
+
+	/* backslash, double-quote and line feed are escaped */
+	for (s = value; s && *s; s++)
+		if (*s == '\\' || *s == '"') {
+			pbuf_append_char(w->buf, '\\');
+			pbuf_append_char(w->buf, *s);
+		} else if (*s == '\n') {
+			pbuf_append(w->buf, "\\n", 2);
+		} else {
+			pbuf_append_char(w->buf, *s);
+		}
+
+	pbuf_append_char(w->buf, '"');
+}
+
+void pmetrics_sample_end(struct pmetrics *w, double value)
+{
+	if (w->labels)
+		pbuf_append_char(w->buf, '}');
+	pbuf_append_char(w->buf, ' ');
+
+	/* the JSON form of the finite values is a valid sample value */
+	if (isinf(value))
+		pbuf_append_str(w->buf, value > 0 ? "+Inf" : "-Inf");
+	else
+		pjson_double_append(w->buf, value);
+
+	pbuf_append_char(w->buf, '\n');
+	w->labels = false;
+}
+
+void pmetrics_sample(struct pmetrics *w, const char *name, double value)
+{
+	pmetrics_sample_begin(w, name);
+	pmetrics_sample_end(w, value);
+}
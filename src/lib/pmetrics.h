@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PMETRICS_H
+#define PSENSOR_PMETRICS_H
+
+#include <bool.h>
+#include <pbuf.h>
+
+/*
+ * Streaming writer of the Prometheus text exposition format
+ * (version 0.0.4).
+ *
+ * A family is declared with pmetrics_family() and followed by its
+ * samples:
+ *
+ *	pmetrics_family(&w, "psensor_load1", "gauge", "Load average.");
+ *	pmetrics_sample_begin(&w, "psensor_load1");
+ *	pmetrics_label(&w, "host", "foo");
+ *	pmetrics_sample_end(&w, 0.5);
+ */
+struct pmetrics {
+	struct pbuf *buf;
+	/* Whether the current sample has labels */
+	bool labels;
+};
+
+#define PMETRICS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+void pmetrics_init(struct pmetrics *w, struct pbuf *buf);
+
+/* Writes the HELP and TYPE lines of a family. */
+void pmetrics_family(struct pmetrics *w,
+		     const char *name,
+		     const char *type,
+		     const char *help);
+
+void pmetrics_sample_begin(struct pmetrics *w, const char *name);
+/* 'value' is escaped, NULL is written as an empty value. */
+void pmetrics_label(struct pmetrics *w, const char *key, const char *value);
+void pmetrics_sample_end(struct pmetrics *w, double value);
+
+/* Writes a sample without label. */
+void pmetrics_sample(struct pmetrics *w, const char *name, double value);
+
+#endif
@@ -0,0 +1,468 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <pjson.h>
+#include <plog.h>
+#include <ppush.h>
+#include <pqueue.h>
+#include <pworker.h>
+
+/* batches kept when the collector is late, beyond they are dropped */
+static const unsigned int QUEUE_SIZE = 16;
+/* initial size of the buffer of a batch */
+static const size_t BATCH_SIZE = 4096;
+/* payload of a datagram which is not fragmented on Ethernet */
+static const size_t DATAGRAM_SIZE = 1432;
+/* maximum wait of a TCP connection or write */
+static const int TCP_TIMEOUT_MS = 1000;
+/* delay before connecting again after a TCP failure */
+static const time_t TCP_RETRY_DELAY = 10;
+
+static char *push_url;
+static enum ppush_format push_format;
+static char *push_prefix;
+
+static struct addrinfo *addr;
+static int sock = -1;
+static time_t retry_time;
+
+/* sender thread */
+static struct pworker sender;
+static struct pbuf *batches;
+static bool late;
+static unsigned long dropped;
+
+bool ppush_format_from_str(const char *str, enum ppush_format *format)
+{
+	if (!strcmp(str, "statsd"))
+		*format = PPUSH_FORMAT_STATSD;
+	else if (!strcmp(str, "graphite"))
+		*format = PPUSH_FORMAT_GRAPHITE;
+	else if (!strcmp(str, "influx"))
+		*format = PPUSH_FORMAT_INFLUX;
+	else
+		return false;
+
+	return true;
+}
+
+static void name_append(struct pbuf *b, const char *prefix, const char *id)
+{
+	const char *c;
+
+	if (*prefix) {
+		pbuf_append_str(b, prefix);
+		pbuf_append_char(b, '.');
+	}
+
+	for (c = id; *c; c++)
+		if ((*c >= 'a' && *c <= 'z')
+		    || (*c >= 'A' && *c <= 'Z')
+		    || (*c >= '0' && *c <= '9')
+		    || *c == '-'
+		    || *c == '_')
+			pbuf_append_char(b, *c);
+		else
+			pbuf_append_char(b, '_');
+}
+
+/* Escapes ',', '=' and ' ' of the InfluxDB tags and measurements. */
+static void influx_append(struct pbuf *b, const char *s)
+{
+	for (; *s; s++) {
+		if (*s == ',' || *s == '=' || *s == ' ' || *s == '\\')
+			pbuf_append_char(b, '\\');
+		pbuf_append_char(b, *s);
+	}
+}
+
+/* The empty tags are not valid in the line protocol. */
+static void influx_tag(struct pbuf *b, const char *key, const char *value)
+{
+	if (!value || !*value)
+		return;
+
+	pbuf_append_char(b, ',');
+	pbuf_append_str(b, key);
+	pbuf_append_char(b, '=');
+	influx_append(b, value);
+}
+
+static void encode_measure(struct pbuf *b,
+			   enum ppush_format format,
+			   const char *prefix,
+			   struct psensor *s,
+			   const struct measure *m)
+{
+	switch (format) {
+	case PPUSH_FORMAT_STATSD:
+		name_append(b, prefix, s->id);
+		pbuf_append_char(b, ':');
+		pjson_double_append(b, m->value);
+		pbuf_append(b, "|g\n", 3);
+		break;
+	case PPUSH_FORMAT_GRAPHITE:
+		name_append(b, prefix, s->id);
+		pbuf_append_char(b, ' ');
+		pjson_double_append(b, m->value);
+		pbuf_printf(b, " %ld\n", (long)m->time.tv_sec);
+		break;
+	case PPUSH_FORMAT_INFLUX:
+		influx_append(b, *prefix ? prefix : "psensor");
+		influx_tag(b, "id", s->id);
+		influx_tag(b, "name", s->name);
+		influx_tag(b, "chip", s->chip);
+		influx_tag(b, "type", psensor_type_to_str(s->type));
+		pbuf_append(b, " value=", 7);
+		pjson_double_append(b, m->value);
+		/* nanoseconds */
+		pbuf_printf(b,
+			    " %ld%06ld000\n",
+			    (long)m->time.tv_sec,
+			    (long)m->time.tv_usec);
+		break;
+	}
+}
+
+void ppush_encode(struct pbuf *b,
+		  enum ppush_format format,
+		  const char *prefix,
+		  struct psensor **sensors)
+{
+	struct measure *m;
+
+	for (; *sensors; sensors++) {
+		m = psensor_get_current_measure(*sensors);
+
+		/* no representation of NaN or Infinity in the formats */
+		if (m && m->value != UNKNOWN_DOUBLE_VALUE && isfinite(m->value))
+			encode_measure(b, format, prefix, *sensors, m);
+	}
+}
+
+static void disconnect(void)
+{
+	if (sock != -1) {
+		close(sock);
+		sock = -1;
+	}
+}
+
+/* Waits until 'sock' is writable, at most TCP_TIMEOUT_MS. */
+static bool wait_writable(void)
+{
+	struct pollfd fd;
+	int ret;
+
+	fd.fd = sock;
+	fd.events = POLLOUT;
+
+	do
+		ret = poll(&fd, 1, TCP_TIMEOUT_MS);
+	while (ret == -1 && errno == EINTR);
+
+	return ret == 1 && !(fd.revents & (POLLERR | POLLHUP));
+}
+
+static bool sock_connect(void)
+{
+	int err;
+	socklen_t len;
+
+	if (sock != -1)
+		return true;
+
+	if (addr->ai_socktype == SOCK_STREAM && time(NULL) < retry_time)
+		return false;
+
+	sock = socket(addr->ai_family,
+		      addr->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		      addr->ai_protocol);
+	if (sock == -1) {
+		log_err(_("Push: cannot create a socket: %s."),
+			strerror(errno));
+		return false;
+	}
+
+	/* immediate for UDP, only sets the destination */
+	if (!connect(sock, addr->ai_addr, addr->ai_addrlen))
+		return true;
+
+	err = errno;
+	if (err == EINPROGRESS && wait_writable()) {
+		len = sizeof(err);
+		if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len))
+			err = errno;
+		if (!err)
+			return true;
+	}
+
+	log_debug("Push: cannot connect to %s: %s.",
+		  push_url,
+		  strerror(err == EINPROGRESS ? ETIMEDOUT : err));
+
+	disconnect();
+	retry_time = time(NULL) + TCP_RETRY_DELAY;
+
+	return false;
+}
+
+/* Sends a batch in datagrams of whole lines. */
+static void send_udp(const struct pbuf *b)
+{
+	const char *p, *end, *nl;
+	size_t n;
+
+	p = b->data;
+	end = b->data + b->len;
+
+	while (p < end) {
+		n = end - p;
+
+		/* a line longer than a datagram is sent alone */
+		if (n > DATAGRAM_SIZE) {
+			nl = memrchr(p, '\n', DATAGRAM_SIZE);
+			if (!nl)
+				nl = memchr(p, '\n', n);
+			if (nl)
+				n = nl + 1 - p;
+		}
+
+		/* a refused or full datagram is lost */
+		if (send(sock, p, n, MSG_DONTWAIT) == -1)
+			log_debug("Push: %s: %s.", push_url, strerror(errno));
+
+		p += n;
+	}
+}
+
+static void send_tcp(const struct pbuf *b)
+{
+	const char *p, *end;
+	ssize_t n;
+
+	p = b->data;
+	end = b->data + b->len;
+
+	while (p < end) {
+		n = send(sock, p, end - p, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+		if (n >= 0) {
+			p += n;
+		} else if (errno == EINTR) {
+			continue;
+		} else if (errno != EAGAIN || !wait_writable()) {
+			log_debug("Push: %s: %s.", push_url, strerror(errno));
+			disconnect();
+			retry_time = time(NULL) + TCP_RETRY_DELAY;
+			return;
+		}
+	}
+}
+
+/* Sends all the queued batches. */
+static void send_batches(struct pqueue *queue)
+{
+	struct pbuf *b;
+	int i;
+
+	while ((i = pqueue_front(queue)) != -1) {
+		b = &batches[i];
+
+		if (b->len && sock_connect()) {
+			if (addr->ai_socktype == SOCK_DGRAM)
+				send_udp(b);
+			else
+				send_tcp(b);
+		}
+
+		pqueue_pop(queue);
+	}
+}
+
+static const char *default_port(enum ppush_format format)
+{
+	switch (format) {
+	case PPUSH_FORMAT_GRAPHITE:
+		return "2003";
+	case PPUSH_FORMAT_INFLUX:
+		return "8089";
+	default:
+		return "8125";
+	}
+}
+
+/* Resolves udp://HOST[:PORT] or tcp://HOST[:PORT]. */
+static struct addrinfo *resolve(const char *url, enum ppush_format format)
+{
+	struct addrinfo hints, *res;
+	char *host, *port, *end;
+	int ret;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+
+	if (!strncmp(url, "udp://", 6)) {
+		hints.ai_socktype = SOCK_DGRAM;
+	} else if (!strncmp(url, "tcp://", 6)) {
+		hints.ai_socktype = SOCK_STREAM;
+	} else {
+		log_err(_("Push: invalid URL %s."), url);
+		return NULL;
+	}
+
+	host = strdup(url + 6);
+
+	/* [IPv6]:PORT */
+	if (*host == '[' && (end = strchr(host, ']'))) {
+		*end = '\0';
+		port = end[1] == ':' ? end + 2 : NULL;
+		memmove(host, host + 1, end - host);
+	} else {
+		port = strrchr(host, ':');
+		if (port)
+			*port++ = '\0';
+	}
+
+	ret = getaddrinfo(host,
+			  port && *port ? port : default_port(format),
+			  &hints,
+			  &res);
+	if (ret) {
+		log_err(_("Push: cannot resolve %s: %s."),
+			url,
+			gai_strerror(ret));
+		res = NULL;
+	}
+
+	free(host);
+
+	return res;
+}
+
+bool ppush_open(const char *url,
+		enum ppush_format format,
+		const char *prefix)
+{
+	unsigned int i;
+
+	if (push_url) {
+		log_err(_("Push already started."));
+		return false;
+	}
+
+	addr = resolve(url, format);
+	if (!addr)
+		return false;
+
+	push_url = strdup(url);
+	push_format = format;
+	push_prefix = strdup(prefix ? prefix : "psensor");
+	retry_time = 0;
+	dropped = 0;
+	late = false;
+
+	pworker_init(&sender, QUEUE_SIZE, send_batches);
+	batches = malloc(sender.queue.size * sizeof(struct pbuf));
+	for (i = 0; i < sender.queue.size; i++)
+		pbuf_init(&batches[i], BATCH_SIZE);
+
+	if (!pworker_start(&sender)) {
+		log_err(_("Push: cannot create the thread."));
+		ppush_close();
+		return false;
+	}
+
+	log_info(_("Pushing the sensor values to %s."), url);
+
+	return true;
+}
+
+void ppush_send(struct psensor **sensors)
+{
+	struct pbuf *b;
+	int i;
+
+	if (!push_url)
+		return;
+
+	i = pqueue_reserve(&sender.queue);
+	if (i == -1) {
+		if (!late)
+			log_warn(_("Push to %s is late, the values are "
+				   "dropped."),
+				 push_url);
+		late = true;
+		dropped++;
+		return;
+	}
+	late = false;
+
+	b = &batches[i];
+	pbuf_reset(b);
+	ppush_encode(b, push_format, push_prefix, sensors);
+
+	pworker_push(&sender);
+}
+
+unsigned long ppush_get_dropped(void)
+{
+	return dropped;
+}
+
+void ppush_close(void)
+{
+	unsigned int i;
+
+	if (!push_url)
+		return;
+
+	pworker_stop(&sender);
+
+	disconnect();
+
+	for (i = 0; i < sender.queue.size; i++)
+		pbuf_free(&batches[i]);
+	free(batches);
+	batches = NULL;
+
+	freeaddrinfo(addr);
+	addr = NULL;
+
+	free(push_url);
+	push_url = NULL;
+	free(push_prefix);
+	push_prefix = NULL;
+}
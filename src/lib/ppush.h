@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PPUSH_H
+#define PSENSOR_PPUSH_H
+
+#include <bool.h>
+#include <pbuf.h>
+#include <psensor.h>
+
+/*
+ * Push of the current values of the sensors to a collector.
+ *
+ * At each call of ppush_send() the values are encoded in a batch,
+ * the batches are queued and sent by a dedicated thread with
+ * non-blocking sockets. When the collector is slow or down, the
+ * queue fills up and the new batches are dropped: the monitoring is
+ * never delayed.
+ */
+
+enum ppush_format {
+	/* <prefix>.<id>:<value>|g */
+	PPUSH_FORMAT_STATSD,
+	/* <prefix>.<id> <value> <seconds> */
+	PPUSH_FORMAT_GRAPHITE,
+	/* <prefix>,id=<id>,name=<name>,chip=<chip>,type=<type> ... */
+	PPUSH_FORMAT_INFLUX
+};
+
+/* Returns false if 'str' is not "statsd", "graphite" or "influx". */
+bool ppush_format_from_str(const char *str, enum ppush_format *format);
+
+/*
+ * Appends the current values of 'sensors' to 'b', one line per
+ * sensor with a finite value. The id is the metric name for StatsD and
+ * Graphite, the characters other than alphanumerics, '-' and '_'
+ * are replaced by '_'.
+ */
+void ppush_encode(struct pbuf *b,
+		  enum ppush_format format,
+		  const char *prefix,
+		  struct psensor **sensors);
+
+/*
+ * Starts the push to 'url': udp://HOST[:PORT] or tcp://HOST[:PORT].
+ * The default port is the usual one of the format: 8125 for StatsD,
+ * 2003 for Graphite, 8089 for InfluxDB. 'prefix' is the prefix of
+ * the metric names, or the measurement for InfluxDB.
+ */
+bool ppush_open(const char *url,
+		enum ppush_format format,
+		const char *prefix);
+
+/* Queues a batch of the current values, the sensors are locked. */
+void ppush_send(struct psensor **sensors);
+
+/* Number of batches dropped because the queue was full. */
+unsigned long ppush_get_dropped(void);
+
+/* Sends the queued batches if the collector is reachable. */
+void ppush_close(void);
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <pqueue.h>
+
+unsigned int pqueue_size(unsigned int size)
+{
+	unsigned int n;
+
+	for (n = 1; n < size; n <<= 1)
+		;
+
+	return n;
+}
+
+void pqueue_init(struct pqueue *q, unsigned int size)
+{
+	q->size = pqueue_size(size);
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+}
+
+int pqueue_reserve(struct pqueue *q)
+{
+	unsigned int head, tail;
+
+	tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	/* the slot is free once the consumer is done with it */
+	head = atomic_load_explicit(&q->head, memory_order_acquire);
+
+	if (tail - head == q->size)
+		return -1;
+
+	return tail & (q->size - 1);
+}
+
+void pqueue_push(struct pqueue *q)
+{
+	unsigned int tail;
+
+	tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	/* publishes the content of the slot */
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+}
+
+int pqueue_front(struct pqueue *q)
+{
+	unsigned int head, tail;
+
+	head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+	if (head == tail)
+		return -1;
+
+	return head & (q->size - 1);
+}
+
+void pqueue_pop(struct pqueue *q)
+{
+	unsigned int head;
+
+	head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+}
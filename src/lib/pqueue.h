@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PQUEUE_H
+#define PSENSOR_PQUEUE_H
+
+#include <stdatomic.h>
+
+/*
+ * Lock-free queue between one producer thread and one consumer
+ * thread.
+ *
+ * The queue only manages the indexes of the slots, the elements are
+ * stored by the caller in an array of 'size' elements. Neither side
+ * ever waits for the other one: the producer gets -1 when the queue
+ * is full.
+ */
+struct pqueue {
+	/* power of 2 */
+	unsigned int size;
+	/* counts of the popped and pushed elements, wrap around */
+	atomic_uint head;
+	atomic_uint tail;
+};
+
+/* 'size' is rounded up to a power of 2, see pqueue_size. */
+void pqueue_init(struct pqueue *q, unsigned int size);
+
+unsigned int pqueue_size(unsigned int size);
+
+/*
+ * Producer: returns the index of the slot to fill before pushing it,
+ * or -1 if the queue is full.
+ */
+int pqueue_reserve(struct pqueue *q);
+/* Producer: makes the reserved slot available to the consumer. */
+void pqueue_push(struct pqueue *q);
+
+/* Consumer: returns the index of the oldest slot, or -1 if empty. */
+int pqueue_front(struct pqueue *q);
+/* Consumer: gives the oldest slot back to the producer. */
+void pqueue_pop(struct pqueue *q);
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <plog.h>
+#include <pring.h>
+#include <url.h>
+
+static const char MAGIC[] = { 'P', 'S', 'R', 'G' };
+static const uint32_t RING_VERSION = 1;
+
+static size_t file_size(unsigned int n)
+{
+	return sizeof(struct pring_header) + n * sizeof(struct measure);
+}
+
+/* Returns the header of the mapped file 'path', NULL on failure. */
+static struct pring_header *map(const char *path, int fd, size_t len)
+{
+	void *data;
+
+	data = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		log_err(_("Cannot map %s: %s."), path, strerror(errno));
+		return NULL;
+	}
+
+	return data;
+}
+
+static void set_header(struct pring *r, struct pring_header *h)
+{
+	r->header = h;
+	r->slots = (struct measure *)(h + 1);
+}
+
+static void unmap(struct pring *r)
+{
+	if (r->header)
+		munmap(r->header, file_size(r->header->size));
+
+	r->header = NULL;
+	r->slots = NULL;
+}
+
+static void init_header(struct pring_header *h,
+			const char *id,
+			unsigned int size)
+{
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, MAGIC, sizeof(MAGIC));
+	h->version = RING_VERSION;
+	h->size = size;
+	h->epoch = time(NULL);
+	/* zeroed, remains null terminated */
+	memcpy(h->id, id, strnlen(id, PRING_ID_SIZE - 1));
+}
+
+static bool is_valid(const struct pring_header *h, const char *id, off_t len)
+{
+	return !memcmp(h->magic, MAGIC, sizeof(MAGIC))
+		&& h->version == RING_VERSION
+		&& h->size
+		&& (off_t)file_size(h->size) == len
+		&& !strncmp(h->id, id, PRING_ID_SIZE - 1);
+}
+
+struct pring *pring_open(const char *dir, const char *id, unsigned int size)
+{
+	struct pring_header h, *data;
+	struct pring *r;
+	struct stat st;
+	char *name;
+	int fd, ret;
+
+	name = url_encode(id);
+	if (!name)
+		return NULL;
+
+	r = malloc(sizeof(*r));
+	r->header = NULL;
+
+	ret = asprintf(&r->path, "%s/%s.ring", dir, name);
+	free(name);
+
+	if (ret == -1) {
+		free(r);
+		return NULL;
+	}
+
+	fd = open(r->path, O_RDWR | O_CREAT, 0600);
+	if (fd == -1) {
+		log_err(_("Cannot open %s: %s."), r->path, strerror(errno));
+		pring_close(r);
+		return NULL;
+	}
+
+	if (fstat(fd, &st)
+	    || st.st_size < (off_t)sizeof(h)
+	    || pread(fd, &h, sizeof(h), 0) != sizeof(h)
+	    || !is_valid(&h, id, st.st_size)) {
+		/* new or invalid, the slots are zeroed: without time */
+		init_header(&h, id, size);
+
+		if (ftruncate(fd, 0)
+		    || ftruncate(fd, file_size(size))
+		    || pwrite(fd, &h, sizeof(h), 0) != sizeof(h)) {
+			log_err(_("Cannot write %s: %s."),
+				r->path,
+				strerror(errno));
+			close(fd);
+			pring_close(r);
+			return NULL;
+		}
+	}
+
+	data = map(r->path, fd, file_size(h.size));
+	close(fd);
+
+	if (!data) {
+		pring_close(r);
+		return NULL;
+	}
+
+	set_header(r, data);
+
+	return r;
+}
+
+void pring_close(struct pring *r)
+{
+	unmap(r);
+	free(r->path);
+	free(r);
+}
+
+void pring_read(const struct pring *r, struct measure *dst, unsigned int n)
+{
+	const struct measure *m, *next;
+	uint64_t head, i, size;
+
+	head = __atomic_load_n(&r->header->head, __ATOMIC_ACQUIRE);
+	size = r->header->size;
+	next = NULL;
+
+	/* from the most recent measure */
+	for (i = 0; n && i < size && i < head; i++) {
+		m = &r->slots[(head - 1 - i) % size];
+
+		if (!timerisset(&m->time)
+		    || (next && !timercmp(&m->time, &next->time, <)))
+			continue;
+
+		dst[--n] = *m;
+		next = m;
+	}
+}
+
+void pring_push(struct pring *r, const struct measure *m)
+{
+	uint64_t head;
+
+	head = r->header->head;
+	r->slots[head % r->header->size] = *m;
+
+	/* the slot is written before it is published */
+	__atomic_store_n(&r->header->head, head + 1, __ATOMIC_RELEASE);
+}
+
+bool pring_rewrite(struct pring *r, const struct measure *ms, unsigned int n)
+{
+	struct pring_header h, *data;
+	struct measure *slots;
+	unsigned int i, k;
+	char *tmp;
+	FILE *f;
+	int fd;
+	bool ok;
+
+	if (!n)
+		return false;
+
+	slots = calloc(n, sizeof(struct measure));
+	for (i = 0, k = 0; i < n; i++)
+		if (timerisset(&ms[i].time))
+			slots[k++] = ms[i];
+
+	init_header(&h, r->header->id, n);
+	h.head = k;
+
+	/* the ring is replaced at once, it is never half written */
+	if (asprintf(&tmp, "%s.tmp", r->path) == -1) {
+		free(slots);
+		return false;
+	}
+
+	f = fopen(tmp, "w");
+	ok = f
+		&& fwrite(&h, sizeof(h), 1, f) == 1
+		&& fwrite(slots, sizeof(struct measure), n, f) == n;
+
+	if (f && fclose(f))
+		ok = false;
+
+	free(slots);
+
+	/*
+	 * The new file is mapped before it replaces the ring, which is
+	 * left unchanged on failure.
+	 */
+	data = NULL;
+	if (ok) {
+		fd = open(tmp, O_RDWR);
+		if (fd != -1) {
+			data = map(tmp, fd, file_size(n));
+			close(fd);
+		}
+	}
+
+	if (!data || rename(tmp, r->path)) {
+		log_err(_("Cannot write %s: %s."), tmp, strerror(errno));
+		if (data)
+			munmap(data, file_size(n));
+		unlink(tmp);
+		free(tmp);
+		return false;
+	}
+
+	free(tmp);
+
+	unmap(r);
+	set_header(r, data);
+
+	return true;
+}
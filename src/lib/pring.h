@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PRING_H
+#define PSENSOR_PRING_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <bool.h>
+#include <measure.h>
+
+/*
+ * Persistent ring of the measures of a sensor.
+ *
+ * The ring is a file mapped in memory: a header followed by the
+ * slots of the measures. A measure is written in the slot head % size
+ * and then published by incrementing 'head', so that after a crash of
+ * the process the ring holds either the previous or the new state.
+ * Reading checks that the times of the measures increase, the pages
+ * written back out of order after a system crash only lose measures.
+ *
+ * The file is a local cache in the native byte order.
+ */
+
+#define PRING_ID_SIZE 256
+
+struct pring_header {
+	char magic[4];
+	uint32_t version;
+	/* number of slots */
+	uint32_t size;
+	uint32_t reserved;
+	/* creation time of the content, in seconds since the Epoch */
+	int64_t epoch;
+	/* number of measures written since 'epoch' */
+	uint64_t head;
+	/* id of the sensor, possibly truncated */
+	char id[PRING_ID_SIZE];
+};
+
+struct pring {
+	char *path;
+	struct pring_header *header;
+	struct measure *slots;
+};
+
+/*
+ * Opens the ring of the sensor 'id' in the directory 'dir', or
+ * creates it with 'size' slots. An existing ring keeps its size until
+ * it is rewritten. Returns NULL on failure.
+ */
+struct pring *pring_open(const char *dir, const char *id, unsigned int size);
+void pring_close(struct pring *r);
+
+/*
+ * Copies the 'n' most recent measures to 'dst', oldest first, the
+ * missing ones are left unchanged.
+ */
+void pring_read(const struct pring *r, struct measure *dst, unsigned int n);
+
+void pring_push(struct pring *r, const struct measure *m);
+
+/*
+ * Replaces the content of the ring by the 'n' measures of 'ms',
+ * oldest first, the ring has then 'n' slots. The measures without
+ * time are skipped.
+ */
+bool pring_rewrite(struct pring *r, const struct measure *ms, unsigned int n);
+
+#endif
@@ -23,12 +23,74 @@
 #include <libintl.h>
 #define _(str) gettext(str)
 
+#include <errno.h>
 #include <stdio.h>
+#include <sys/stat.h>
 
 #include <hdd.h>
+#include <pmutex.h>
 #include <psensor.h>
 #include <temperature.h>
 
+static char *history_dir;
+
+/*
+ * Sensors which have a ring, a single one is opened per id: a sensor
+ * found again by its provider gets the ring of its counterpart
+ * restored from the cache, see psensor_adopt. Sensors are created by
+ * the discovery threads.
+ */
+static struct psensor **ring_owners;
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void psensor_set_history_dir(const char *dir)
+{
+	free(history_dir);
+	history_dir = NULL;
+
+	if (!dir)
+		return;
+
+	if (mkdir(dir, 0700) == -1 && errno != EEXIST) {
+		log_err(_("Failed to create the directory %s: %s"),
+			dir,
+			strerror(errno));
+		return;
+	}
+
+	history_dir = strdup(dir);
+}
+
+static void open_ring(struct psensor *s)
+{
+	pmutex_lock(&rings_mutex);
+
+	if (!ring_owners) {
+		ring_owners = malloc(sizeof(struct psensor *));
+		*ring_owners = NULL;
+	}
+
+	if (!psensor_list_get_by_id(ring_owners, s->id)) {
+		s->ring = pring_open(history_dir, s->id, s->values_max_length);
+		if (s->ring) {
+			pring_read(s->ring, s->measures, s->values_max_length);
+			psensor_list_append(&ring_owners, s);
+		}
+	}
+
+	pmutex_unlock(&rings_mutex);
+}
+
+static void close_ring(struct psensor *s)
+{
+	pmutex_lock(&rings_mutex);
+	psensor_list_remove(ring_owners, s);
+	pmutex_unlock(&rings_mutex);
+
+	pring_close(s->ring);
+	s->ring = NULL;
+}
+
 struct psensor *psensor_create(char *id,
 							   char *name,
 							   char *chip,
@@ -61,6 +123,10 @@ struct psensor *psensor_create(char *id,
 	psensor->values_max_length = values_max_length;
 	psensor->measures = measures_double_create(values_max_length);
 
+	psensor->ring = NULL;
+	if (history_dir)
+		open_ring(psensor);
+
 	psensor->alarm_high_threshold = 0;
 	psensor->alarm_low_threshold = 0;
 
@@ -70,6 +136,7 @@ struct psensor *psensor_create(char *id,
 
 	psensor->provider_data = NULL;
 	psensor->provider_data_free_fct = &free;
+	psensor->provider_adopt_fct = NULL;
 
 	return psensor;
 }
@@ -96,6 +163,14 @@ void psensor_values_resize(struct psensor *s, unsigned new_size)
 
 	s->values_max_length = new_size;
 	s->measures = new_ms;
+
+	/* the ring may have more measures than the previous size */
+	if (s->ring) {
+		pring_read(s->ring, new_ms, new_size);
+
+		if (s->ring->header->size != new_size)
+			pring_rewrite(s->ring, new_ms, new_size);
+	}
 }
 
 void psensor_free(struct psensor *s)
@@ -113,6 +188,9 @@ void psensor_free(struct psensor *s)
 
 	measures_free(s->measures);
 
+	if (s->ring)
+		close_ring(s);
+
 	if (s->provider_data && s->provider_data_free_fct)
 		s->provider_data_free_fct(s->provider_data);
 
@@ -273,6 +351,13 @@ void psensor_set_current_measure(struct psensor *s, double v, struct timeval tv)
 	s->measures[s->values_max_length - 1].value = v;
 	s->measures[s->values_max_length - 1].time = tv;
 
+	if (s->ring)
+		pring_push(s->ring, &s->measures[s->values_max_length - 1]);
+
+	/* The value is not available, e.g. a remote server is down. */
+	if (v == UNKNOWN_DOUBLE_VALUE)
+		return;
+
 	if (s->sess_lowest == UNKNOWN_DOUBLE_VALUE || v < s->sess_lowest)
 		s->sess_lowest = v;
 
@@ -293,6 +378,77 @@ void psensor_set_current_measure(struct psensor *s, double v, struct timeval tv)
 	}
 }
 
+static void update_session_bounds(struct psensor *s, double v)
+{
+	if (v == UNKNOWN_DOUBLE_VALUE)
+		return;
+
+	if (s->sess_lowest == UNKNOWN_DOUBLE_VALUE || v < s->sess_lowest)
+		s->sess_lowest = v;
+
+	if (s->sess_highest == UNKNOWN_DOUBLE_VALUE || v > s->sess_highest)
+		s->sess_highest = v;
+}
+
+void psensor_merge_measures(struct psensor *s,
+			    const struct measure *ms,
+			    unsigned int n)
+{
+	struct measure *dst, *e;
+	const struct measure *m, *first, *last;
+	int i, j, k;
+
+	if (!n)
+		return;
+
+	first = &ms[0];
+	last = &ms[n - 1];
+
+	dst = measures_double_create(s->values_max_length);
+
+	/* merges from the most recent measures */
+	i = s->values_max_length - 1;
+	j = n - 1;
+	k = s->values_max_length - 1;
+	while (k >= 0) {
+		e = (i >= 0 && timerisset(&s->measures[i].time))
+			? &s->measures[i] : NULL;
+		m = j >= 0 ? &ms[j] : NULL;
+
+		if (!e && !m)
+			break;
+
+		/* unknown measures covered by the new ones are replaced */
+		if (e
+		    && e->value == UNKNOWN_DOUBLE_VALUE
+		    && !timercmp(&e->time, &first->time, <)
+		    && !timercmp(&e->time, &last->time, >)) {
+			i--;
+			continue;
+		}
+
+		if (e && (!m || timercmp(&e->time, &m->time, >))) {
+			dst[k] = *e;
+			i--;
+		} else {
+			if (e && timercmp(&e->time, &m->time, ==))
+				i--;
+
+			dst[k] = *m;
+			update_session_bounds(s, m->value);
+			j--;
+		}
+
+		k--;
+	}
+
+	measures_free(s->measures);
+	s->measures = dst;
+
+	if (s->ring)
+		pring_rewrite(s->ring, dst, s->values_max_length);
+}
+
 double psensor_get_current_value(const struct psensor *sensor)
 {
 	return sensor->measures[sensor->values_max_length - 1].value;
@@ -395,6 +551,9 @@ double get_max_temp(struct psensor **sensors)
 
 const char *psensor_type_to_str(unsigned int type)
 {
+	if (type & SENSOR_TYPE_PSI)
+		return "Pressure stall";
+
 	if (type & SENSOR_TYPE_NVCTRL)
 	{
 		if (type & SENSOR_TYPE_TEMP)
@@ -427,6 +586,9 @@ const char *psensor_type_to_str(unsigned int type)
 	if ((type & SENSOR_TYPE_CPU_USAGE) == SENSOR_TYPE_CPU_USAGE)
 		return "CPU Usage";
 
+	if (type & SENSOR_TYPE_FREQUENCY)
+		return "Frequency";
+
 	if (type & SENSOR_TYPE_TEMP)
 		return "Temperature";
 
@@ -461,6 +623,10 @@ const char *psensor_type_to_unit_str(unsigned int type, int use_celsius)
 	{
 		return _("%");
 	}
+	else if (type & SENSOR_TYPE_FREQUENCY)
+	{
+		return _("MHz");
+	}
 	return _("N/A");
 }
 
@@ -496,6 +662,53 @@ struct psensor **psensor_list_copy(struct psensor **sensors)
 	return result;
 }
 
+void psensor_list_remove(struct psensor **sensors, struct psensor *sensor)
+{
+	for (; *sensors; sensors++)
+		if (*sensors == sensor)
+			break;
+
+	for (; *sensors; sensors++)
+		*sensors = *(sensors + 1);
+}
+
+void psensor_adopt(struct psensor *dst, struct psensor *src)
+{
+	char *chip;
+
+	chip = dst->chip;
+	dst->chip = src->chip;
+	src->chip = chip;
+
+	dst->type = src->type;
+	dst->min = src->min;
+	dst->max = src->max;
+
+	dst->provider_data = src->provider_data;
+	dst->provider_data_free_fct = src->provider_data_free_fct;
+	dst->provider_adopt_fct = src->provider_adopt_fct;
+#ifdef HAVE_LIBATIADL
+	dst->amd_id = src->amd_id;
+#endif
+	src->provider_data = NULL;
+
+	/* 'src' has no ring when 'dst' has one */
+	if (src->ring && !dst->ring) {
+		pmutex_lock(&rings_mutex);
+		psensor_list_remove(ring_owners, src);
+		psensor_list_append(&ring_owners, dst);
+		pmutex_unlock(&rings_mutex);
+
+		dst->ring = src->ring;
+		src->ring = NULL;
+	}
+
+	if (src->provider_adopt_fct)
+		src->provider_adopt_fct(dst, src);
+
+	psensor_free(src);
+}
+
 char *
 psensor_current_value_to_str(const struct psensor *s, unsigned int use_celsius)
 {
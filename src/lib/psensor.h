@@ -24,12 +24,14 @@
 #include <bool.h>
 #include <measure.h>
 #include <plog.h>
+#include <pring.h>
 
 enum psensor_type {
 	/* type of sensor values */
 	SENSOR_TYPE_TEMP = 0x00001U,
 	SENSOR_TYPE_RPM = 0x00002U,
 	SENSOR_TYPE_PERCENT = 0x00004U,
+	SENSOR_TYPE_FREQUENCY = 0x4000000U,
 
 	/* Whether the sensor is remote */
 	SENSOR_TYPE_REMOTE = 0x00008U,
@@ -42,6 +44,10 @@ enum psensor_type {
 	SENSOR_TYPE_ATASMART = 0x01000U,
 	SENSOR_TYPE_HDDTEMP = 0x02000U,
 	SENSOR_TYPE_UDISKS2 = 0x800000U,
+	SENSOR_TYPE_HWMON = 0x1000000U,
+	SENSOR_TYPE_THERMAL = 0x2000000U,
+	SENSOR_TYPE_CPUSTAT = 0x8000000U,
+	SENSOR_TYPE_PSI = 0x10000000U,
 
 	/* Type of HW component */
 	SENSOR_TYPE_HDD = 0x04000U,
@@ -57,7 +63,20 @@ enum psensor_type {
 
 	/* Combinations */
 	SENSOR_TYPE_HDD_TEMP = (SENSOR_TYPE_HDD | SENSOR_TYPE_TEMP),
-	SENSOR_TYPE_CPU_USAGE = (SENSOR_TYPE_CPU | SENSOR_TYPE_PERCENT)
+	SENSOR_TYPE_CPU_USAGE = (SENSOR_TYPE_CPU | SENSOR_TYPE_PERCENT),
+
+	/* All the libraries, a sensor without them has no provider */
+	SENSOR_TYPE_PROVIDERS = (SENSOR_TYPE_LMSENSOR
+				 | SENSOR_TYPE_NVCTRL
+				 | SENSOR_TYPE_GTOP
+				 | SENSOR_TYPE_ATIADL
+				 | SENSOR_TYPE_ATASMART
+				 | SENSOR_TYPE_HDDTEMP
+				 | SENSOR_TYPE_UDISKS2
+				 | SENSOR_TYPE_HWMON
+				 | SENSOR_TYPE_THERMAL
+				 | SENSOR_TYPE_CPUSTAT
+				 | SENSOR_TYPE_PSI)
 };
 
 struct psensor {
@@ -79,12 +98,19 @@ struct psensor {
 	 * oldest measure.
 	 */
 	struct measure *measures;
+	/* persistent copy of 'measures', see psensor_set_history_dir */
+	struct pring *ring;
 
 	void (*cb_alarm_raised)(struct psensor *, void *);
 	void *cb_alarm_raised_data;
 
 	void *provider_data;
 	void (*provider_data_free_fct)(void *);
+	/*
+	 * Called by psensor_adopt before freeing 'src', for the
+	 * providers which keep references to their sensors.
+	 */
+	void (*provider_adopt_fct)(struct psensor *dst, struct psensor *src);
 	#ifdef HAVE_LIBATIADL
 	/* AMD id for the aticonfig */
 	int amd_id;
@@ -104,6 +130,16 @@ struct psensor {
 };
 //UNPACK_STRUCT()
 
+/*
+ * Keeps the measures of the sensors created afterwards in rings
+ * under 'dir' (see pring.h), so that they are restored by the next
+ * run. 'dir' is created if needed. NULL to stop.
+ *
+ * A ring is used by a single sensor: a sensor created with the id of
+ * a sensor which has a ring gets none, see psensor_adopt.
+ */
+void psensor_set_history_dir(const char *dir);
+
 struct psensor *psensor_create(char *id,
 			       char *name,
 			       char *chip,
@@ -149,10 +185,36 @@ void psensor_list_append(struct psensor ***sensors, struct psensor *sensor);
 
 struct psensor **psensor_list_copy(struct psensor **);
 
+/* Removes a sensor from a list without freeing it. */
+void psensor_list_remove(struct psensor **sensors, struct psensor *sensor);
+
+/*
+ * Gives the provider, the type, the chip and the bounds of 'src' to
+ * 'dst', a sensor with the same id but without provider (e.g.
+ * restored from a cache), and frees 'src'. 'dst' keeps its measures
+ * so that the references to it remain valid, the provider replaces
+ * its own references to 'src'.
+ */
+void psensor_adopt(struct psensor *dst, struct psensor *src);
+
 void psensor_set_current_value(struct psensor *sensor, double value);
 void psensor_set_current_measure(struct psensor *sensor, double value,
 				 struct timeval tv);
 
+/*
+ * Inserts measures in the history of a sensor in one pass, e.g. to
+ * load the history of a remote sensor.
+ *
+ * 'ms' must be sorted from the oldest to the most recent measure. A
+ * measure replaces the existing one with the same time and the
+ * unknown measures within the time range of 'ms'. Only the
+ * 'values_max_length' most recent measures are kept. Alarms are not
+ * raised.
+ */
+void psensor_merge_measures(struct psensor *sensor,
+			    const struct measure *ms,
+			    unsigned int n);
+
 double psensor_get_current_value(const struct psensor *);
 
 struct measure *psensor_get_current_measure(struct psensor *sensor);
@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 
+#include "pjson.h"
 #include "psensor_json.h"
 #include "url.h"
 
@@ -34,110 +35,145 @@
 #define ATT_MEASURE_VALUE "value"
 #define ATT_MEASURE_TIME "time"
 
-static json_object *
-measure_to_json_object(struct measure *m)
+/*
+ * Approximative size of the JSON representation of a measure, used
+ * to size the buffer before serializing a sensor.
+ */
+static const size_t JSON_MEASURE_SIZE = 48;
+
+static void measure_to_json(struct pjson *w, const struct measure *m)
 {
-	json_object *o = json_object_new_object();
-
-	json_object_object_add(o,
-			       ATT_MEASURE_VALUE,
-			       json_object_new_double(m->value));
-	json_object_object_add(o, ATT_MEASURE_TIME,
-			       json_object_new_int((m->time).tv_sec));
-	return o;
+	pjson_object_begin(w);
+
+	pjson_key(w, ATT_MEASURE_VALUE);
+	pjson_double(w, m->value);
+
+	pjson_key(w, ATT_MEASURE_TIME);
+	pjson_int(w, (m->time).tv_sec);
+
+	pjson_object_end(w);
 }
 
-static json_object *
-measures_to_json_object(struct psensor *s)
+static void measures_to_json(struct pjson *w, struct psensor *s)
 {
-	json_object *o;
-	int i;
+	unsigned int i;
 
-	o = json_object_new_array();
+	pjson_array_begin(w);
 
 	for (i = 0; i < s->values_max_length; i++)
 		if (s->measures[i].time.tv_sec)
-			json_object_array_add
-				(o, measure_to_json_object(&s->measures[i]));
+			measure_to_json(w, &s->measures[i]);
+
+	pjson_array_end(w);
+}
+
+static void sensor_to_json(struct pjson *w, struct psensor *s)
+{
+	pbuf_reserve(w->buf, (s->values_max_length + 4) * JSON_MEASURE_SIZE);
+
+	pjson_object_begin(w);
+
+	pjson_key(w, ATT_SENSOR_ID);
+	pjson_string(w, s->id);
+
+	pjson_key(w, ATT_SENSOR_NAME);
+	pjson_string(w, s->name);
+
+	pjson_key(w, ATT_SENSOR_TYPE);
+	pjson_int(w, s->type);
 
+	pjson_key(w, ATT_SENSOR_MIN);
+	pjson_double(w, s->sess_lowest);
 
-	return o;
+	pjson_key(w, ATT_SENSOR_MAX);
+	pjson_double(w, s->sess_highest);
+
+	pjson_key(w, ATT_SENSOR_MEASURES);
+	measures_to_json(w, s);
+
+	pjson_key(w, ATT_SENSOR_LAST_MEASURE);
+	measure_to_json(w, psensor_get_current_measure(s));
+
+	pjson_object_end(w);
 }
 
-static json_object *sensor_to_json(struct psensor *s)
+void sensor_json_append(struct pbuf *b, struct psensor *s)
 {
-	json_object *mo, *obj;
-	struct measure *m;
-
-	obj = json_object_new_object();
-
-	json_object_object_add(obj,
-			       ATT_SENSOR_ID,
-			       json_object_new_string(s->id));
-	json_object_object_add(obj,
-			       ATT_SENSOR_NAME,
-			       json_object_new_string(s->name));
-	json_object_object_add(obj,
-			       ATT_SENSOR_TYPE, json_object_new_int(s->type));
-	json_object_object_add(obj,
-			       ATT_SENSOR_MIN,
-			       json_object_new_double(s->sess_lowest));
-	json_object_object_add(obj,
-			       ATT_SENSOR_MAX,
-			       json_object_new_double(s->sess_highest));
-	json_object_object_add(obj,
-			       ATT_SENSOR_MEASURES,
-			       measures_to_json_object(s));
-
-	m = psensor_get_current_measure(s);
-	mo = json_object_new_object();
-	json_object_object_add(mo,
-			       ATT_MEASURE_VALUE,
-			       json_object_new_double(m->value));
-	json_object_object_add(mo, ATT_MEASURE_TIME,
-			       json_object_new_int((m->time).tv_sec));
-	json_object_object_add(obj, ATT_SENSOR_LAST_MEASURE, mo);
-
-	return obj;
+	struct pjson w;
+
+	pjson_init(&w, b);
+
+	sensor_to_json(&w, s);
 }
 
-char *sensor_to_json_string(struct psensor *s)
+void sensors_json_append(struct pbuf *b, struct psensor **sensors)
 {
-	char *str;
-	json_object *obj = sensor_to_json(s);
+	struct pjson w;
+
+	pjson_init(&w, b);
 
-	str = strdup(json_object_to_json_string(obj));
+	pjson_array_begin(&w);
 
-	json_object_put(obj);
+	if (sensors)
+		for (; *sensors; sensors++)
+			sensor_to_json(&w, *sensors);
 
-	return str;
+	pjson_array_end(&w);
 }
 
-char *sensors_to_json_string(struct psensor **sensors)
+void last_measures_json_append(struct pbuf *b, struct psensor **sensors)
 {
-    // struct psensor **sensors_cur; // Remove this pointer
-	char *str;
-	json_object *obj = json_object_new_array();
+	struct pjson w;
+
+	pjson_init(&w, b);
 
-	if (sensors) {
-        // sensors_cur = sensors; // Not needed
-        size_t i = 0; // Use an index
+	pjson_array_begin(&w);
 
-        // Access via index
-        while (sensors[i] != NULL) {
-            struct psensor *s = sensors[i];
+	if (sensors)
+		for (; *sensors; sensors++) {
+			pjson_object_begin(&w);
 
-			json_object_array_add(obj, sensor_to_json(s));
+			pjson_key(&w, ATT_SENSOR_ID);
+			pjson_string(&w, (*sensors)->id);
 
-            // sensors_cur++; // Remove the unsafe pointer increment
-            i++; // Increment the index instead
+			pjson_key(&w, ATT_SENSOR_LAST_MEASURE);
+			measure_to_json(&w,
+					psensor_get_current_measure(*sensors));
+
+			pjson_object_end(&w);
 		}
-	}
 
-	str = strdup(json_object_to_json_string(obj));
-	json_object_put(obj);
+	pjson_array_end(&w);
+}
 
-	return str;
+char *sensor_to_json_string(struct psensor *s)
+{
+	struct pbuf buf;
+
+	pbuf_init(&buf, 0);
+	sensor_json_append(&buf, s);
+
+	return pbuf_detach(&buf);
+}
+
+char *sensors_to_json_string(struct psensor **sensors)
+{
+	struct pbuf buf;
+
+	pbuf_init(&buf, 0);
+	sensors_json_append(&buf, sensors);
+
+	return pbuf_detach(&buf);
+}
+
+char *last_measures_to_json_string(struct psensor **sensors)
+{
+	struct pbuf buf;
+
+	pbuf_init(&buf, 0);
+	last_measures_json_append(&buf, sensors);
+
+	return pbuf_detach(&buf);
 }
 
 struct psensor *psensor_new_from_json(json_object *o,
@@ -172,3 +208,44 @@ struct psensor *psensor_new_from_json(json_object *o,
 	return s;
 }
 
+
+void psensor_load_json_measures(struct psensor *s, json_object *o)
+{
+	json_object *oms, *om, *ov, *ot;
+	struct measure *ms;
+	size_t i, len;
+	unsigned int n;
+
+	if (!json_object_object_get_ex(o, ATT_SENSOR_MEASURES, &oms)
+	    || !json_object_is_type(oms, json_type_array))
+		return;
+
+	len = json_object_array_length(oms);
+	if (!len)
+		return;
+
+	ms = malloc(len * sizeof(struct measure));
+
+	n = 0;
+	for (i = 0; i < len; i++) {
+		om = json_object_array_get_idx(oms, i);
+
+		if (!json_object_object_get_ex(om, ATT_MEASURE_VALUE, &ov)
+		    || !json_object_object_get_ex(om, ATT_MEASURE_TIME, &ot))
+			continue;
+
+		ms[n].value = json_object_get_double(ov);
+		ms[n].time.tv_sec = json_object_get_int(ot);
+		ms[n].time.tv_usec = 0;
+
+		/* skips the measures which are not in order */
+		if (n && !timercmp(&ms[n - 1].time, &ms[n].time, <))
+			continue;
+
+		n++;
+	}
+
+	psensor_merge_measures(s, ms, n);
+
+	free(ms);
+}
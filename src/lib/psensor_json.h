@@ -27,10 +27,22 @@
 #include <json-c/json.h>
 #endif
 
+#include "pbuf.h"
 #include "psensor.h"
 
+/*
+ * Appends the JSON representation of the sensors to 'b': a caller
+ * answering many requests keeps its buffer and resets it between
+ * them, the _string variants allocate a new one at each call.
+ */
+void sensor_json_append(struct pbuf *b, struct psensor *s);
+void sensors_json_append(struct pbuf *b, struct psensor **sensors);
+/* The id and the last measure of each sensor, without the history. */
+void last_measures_json_append(struct pbuf *b, struct psensor **sensors);
+
 char *sensor_to_json_string(struct psensor *s);
 char *sensors_to_json_string(struct psensor **sensors);
+char *last_measures_to_json_string(struct psensor **sensors);
 
 /*
  * Creates a new allocated psensor corresponding to a given json
@@ -39,4 +51,10 @@ char *sensors_to_json_string(struct psensor **sensors);
 struct psensor *psensor_new_from_json(json_object *o,
 				      const char *sensors_url,
 				      unsigned int values_max_length);
+
+/*
+ * Inserts in the history of a sensor the measures of its JSON
+ * representation.
+ */
+void psensor_load_json_measures(struct psensor *s, json_object *o);
 #endif
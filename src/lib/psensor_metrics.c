@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <psensor_metrics.h>
+
+static void sensor_to_metrics(struct pmetrics *w,
+			      const char *name,
+			      struct psensor *s,
+			      double value)
+{
+	pmetrics_sample_begin(w, name);
+	pmetrics_label(w, "id", s->id);
+	pmetrics_label(w, "name", s->name);
+	pmetrics_label(w, "chip", s->chip);
+	pmetrics_label(w, "type", psensor_type_to_str(s->type));
+	pmetrics_sample_end(w, value);
+}
+
+void psensors_to_metrics(struct pmetrics *w, struct psensor **sensors)
+{
+	struct psensor **cur;
+	struct measure *m;
+
+	pmetrics_family(w,
+			"psensor_sensor_value",
+			"gauge",
+			"Current value of the sensor.");
+
+	for (cur = sensors; *cur; cur++) {
+		m = psensor_get_current_measure(*cur);
+		if (m && m->value != UNKNOWN_DOUBLE_VALUE)
+			sensor_to_metrics(w, "psensor_sensor_value", *cur,
+					  m->value);
+	}
+
+	pmetrics_family(w,
+			"psensor_sensor_last_update_seconds",
+			"gauge",
+			"Time of the current value of the sensor.");
+
+	for (cur = sensors; *cur; cur++) {
+		m = psensor_get_current_measure(*cur);
+		if (m && m->value != UNKNOWN_DOUBLE_VALUE)
+			sensor_to_metrics(w,
+					  "psensor_sensor_last_update_seconds",
+					  *cur,
+					  m->time.tv_sec
+					  + m->time.tv_usec / 1000000.0);
+	}
+}
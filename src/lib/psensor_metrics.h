@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PSENSOR_METRICS_H
+#define PSENSOR_PSENSOR_METRICS_H
+
+#include <pmetrics.h>
+#include <psensor.h>
+
+/*
+ * Writes the families of the current values of the sensors, one
+ * sample per sensor labelled by its id, name, chip and type. The
+ * sensors without value are skipped.
+ */
+void psensors_to_metrics(struct pmetrics *w, struct psensor **sensors);
+
+#endif
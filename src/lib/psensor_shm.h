@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_SHM_H
+#define PSENSOR_SHM_H
+
+/*
+ * Reader of the live values published by psensor and psensor-server
+ * in shared memory.
+ *
+ * This header has no dependency on the rest of psensor, it can be
+ * copied in other projects. A value is read without system call:
+ *
+ *	struct psensor_shm *shm;
+ *	struct psensor_shm_value v;
+ *	int i;
+ *
+ *	shm = psensor_shm_open(NULL);
+ *	i = psensor_shm_find(shm, "lmsensor coretemp-isa-0000 Core 0");
+ *	...
+ *	if (psensor_shm_read(shm, i, &v) && !isnan(v.value))
+ *		printf("%f\n", v.value);
+ *
+ * The segment is a fixed table of entries, each one guarded by a
+ * sequence counter: the writer makes the counter odd, updates the
+ * entry and makes it even again. A reader copies the entry between
+ * two reads of the counter and retries if it changed or was odd, at
+ * most PSENSOR_SHM_READ_ATTEMPTS times: a writer killed in the middle
+ * of an update leaves the counter odd forever.
+ *
+ * The index of a sensor is stable while the writer runs but may
+ * change when it is restarted or when sensors are added: the id of
+ * the entry is returned by psensor_shm_read() so that the caller can
+ * check it and call psensor_shm_find() again. When the writer stops,
+ * 'pid' is set to 0 and the segment is removed: the reader has to
+ * open it again once a new writer has started.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define PSENSOR_SHM_PATH "/dev/shm/psensor"
+
+#define PSENSOR_SHM_MAGIC 0x4d485350U /* "PSHM" */
+#define PSENSOR_SHM_VERSION 1U
+
+#define PSENSOR_SHM_ID_SIZE 128
+#define PSENSOR_SHM_MAX_ENTRIES 256
+
+/* reads of an entry before giving up, see psensor_shm_read() */
+#define PSENSOR_SHM_READ_ATTEMPTS 1000
+
+struct psensor_shm_entry {
+	/* odd while the entry is written */
+	uint32_t seq;
+	/* see enum psensor_type of psensor.h */
+	uint32_t type;
+	/* NaN when the value is unknown */
+	double value;
+	/* time of the measure */
+	int64_t sec;
+	int64_t usec;
+	/* null terminated, possibly truncated */
+	char id[PSENSOR_SHM_ID_SIZE];
+};
+
+struct psensor_shm {
+	uint32_t magic;
+	uint32_t version;
+	/* number of entries in use */
+	uint32_t count;
+	/* pid of the writer, 0 when it has stopped */
+	uint32_t pid;
+	struct psensor_shm_entry entries[PSENSOR_SHM_MAX_ENTRIES];
+};
+
+struct psensor_shm_value {
+	uint32_t type;
+	double value;
+	int64_t sec;
+	int64_t usec;
+	char id[PSENSOR_SHM_ID_SIZE];
+};
+
+/*
+ * Maps the segment 'path' in read only, PSENSOR_SHM_PATH if NULL.
+ * Returns NULL if it does not exist or is not a segment of a
+ * compatible version.
+ */
+static inline struct psensor_shm *psensor_shm_open(const char *path)
+{
+	struct psensor_shm *shm;
+	int fd;
+
+	fd = open(path ? path : PSENSOR_SHM_PATH, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return NULL;
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (shm == MAP_FAILED)
+		return NULL;
+
+	if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE)
+	    != PSENSOR_SHM_MAGIC
+	    || shm->version != PSENSOR_SHM_VERSION) {
+		munmap(shm, sizeof(*shm));
+		return NULL;
+	}
+
+	return shm;
+}
+
+static inline void psensor_shm_close(struct psensor_shm *shm)
+{
+	if (shm)
+		munmap(shm, sizeof(*shm));
+}
+
+static inline unsigned int psensor_shm_count(const struct psensor_shm *shm)
+{
+	unsigned int n;
+
+	n = __atomic_load_n(&shm->count, __ATOMIC_ACQUIRE);
+	if (n > PSENSOR_SHM_MAX_ENTRIES)
+		n = PSENSOR_SHM_MAX_ENTRIES;
+
+	return n;
+}
+
+/*
+ * Copies the entry 'i' to 'v'. Returns 0 if 'i' is not an entry in
+ * use, if the writer has stopped, or if a consistent copy could not
+ * be made in PSENSOR_SHM_READ_ATTEMPTS attempts: the writer died in
+ * the middle of an update, or was preempted in it, the read can be
+ * retried later.
+ */
+static inline int psensor_shm_read(const struct psensor_shm *shm,
+				   int i,
+				   struct psensor_shm_value *v)
+{
+	const struct psensor_shm_entry *e;
+	uint32_t seq;
+	unsigned int attempts;
+
+	if (i < 0 || (unsigned int)i >= psensor_shm_count(shm)
+	    || !__atomic_load_n(&shm->pid, __ATOMIC_ACQUIRE))
+		return 0;
+
+	e = &shm->entries[i];
+
+	for (attempts = 0; attempts < PSENSOR_SHM_READ_ATTEMPTS; attempts++) {
+		seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+
+		v->type = e->type;
+		v->value = e->value;
+		v->sec = e->sec;
+		v->usec = e->usec;
+		memcpy(v->id, e->id, sizeof(v->id));
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&e->seq, __ATOMIC_RELAXED) == seq) {
+			v->id[PSENSOR_SHM_ID_SIZE - 1] = '\0';
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Returns the index of the sensor 'id', -1 if it is not published. */
+static inline int psensor_shm_find(const struct psensor_shm *shm,
+				   const char *id)
+{
+	struct psensor_shm_value v;
+	unsigned int i, n;
+
+	n = psensor_shm_count(shm);
+	for (i = 0; i < n; i++)
+		if (psensor_shm_read(shm, i, &v)
+		    && !strncmp(v.id, id, PSENSOR_SHM_ID_SIZE - 1))
+			return i;
+
+	return -1;
+}
+
+#endif
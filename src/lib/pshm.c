@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <plog.h>
+#include <pshm.h>
+
+static struct psensor_shm *shm;
+static char *shm_path;
+static int shm_fd = -1;
+
+static void cleanup(void)
+{
+	if (shm) {
+		munmap(shm, sizeof(*shm));
+		shm = NULL;
+	}
+
+	if (shm_fd != -1) {
+		close(shm_fd);
+		shm_fd = -1;
+	}
+
+	free(shm_path);
+	shm_path = NULL;
+}
+
+bool pshm_open(const char *path)
+{
+	struct stat st;
+	void *data;
+
+	pshm_close();
+
+	if (!path)
+		path = PSENSOR_SHM_PATH;
+
+	shm_path = strdup(path);
+
+	/* readable by the local agents of the other users */
+	shm_fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+	if (shm_fd == -1) {
+		log_err(_("Cannot open %s: %s."), path, strerror(errno));
+		cleanup();
+		return false;
+	}
+
+	/*
+	 * /dev/shm is writable by everyone: a file planted by another
+	 * user, or a link to a file of root, must not be written.
+	 */
+	if (fstat(shm_fd, &st) == -1
+	    || !S_ISREG(st.st_mode)
+	    || st.st_uid != geteuid()
+	    || st.st_nlink != 1) {
+		log_err(_("%s is not a regular file owned by the user."),
+			path);
+		cleanup();
+		return false;
+	}
+
+	if (flock(shm_fd, LOCK_EX | LOCK_NB) == -1) {
+		log_warn(_("%s is used by another process: %s."),
+			 path,
+			 strerror(errno));
+		cleanup();
+		return false;
+	}
+
+	if (ftruncate(shm_fd, sizeof(*shm)) == -1) {
+		log_err(_("Cannot resize %s: %s."), path, strerror(errno));
+		cleanup();
+		return false;
+	}
+
+	data = mmap(NULL,
+		    sizeof(*shm),
+		    PROT_READ | PROT_WRITE,
+		    MAP_SHARED,
+		    shm_fd,
+		    0);
+	if (data == MAP_FAILED) {
+		log_err(_("Cannot map %s: %s."), path, strerror(errno));
+		cleanup();
+		return false;
+	}
+
+	shm = data;
+
+	/*
+	 * The readers of a previous writer keep their mapping: the
+	 * table is emptied before being reinitialized, entries left
+	 * odd by a crash are reset.
+	 */
+	__atomic_store_n(&shm->count, 0, __ATOMIC_RELEASE);
+	memset(shm->entries, 0, sizeof(shm->entries));
+
+	shm->version = PSENSOR_SHM_VERSION;
+	shm->pid = getpid();
+	__atomic_store_n(&shm->magic, PSENSOR_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	log_info(_("Publishing the sensor values in %s."), path);
+
+	return true;
+}
+
+static void publish(struct psensor_shm_entry *e, struct psensor *s)
+{
+	struct measure *m;
+	uint32_t seq;
+
+	m = &s->measures[s->values_max_length - 1];
+
+	seq = e->seq;
+	__atomic_store_n(&e->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	e->type = s->type;
+	if (m->value == UNKNOWN_DOUBLE_VALUE)
+		e->value = NAN;
+	else
+		e->value = m->value;
+	e->sec = m->time.tv_sec;
+	e->usec = m->time.tv_usec;
+	if (strncmp(e->id, s->id, PSENSOR_SHM_ID_SIZE - 1))
+		strncpy(e->id, s->id, PSENSOR_SHM_ID_SIZE - 1);
+
+	__atomic_store_n(&e->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void pshm_publish(struct psensor **sensors)
+{
+	unsigned int n;
+
+	if (!shm || !sensors)
+		return;
+
+	for (n = 0; *sensors && n < PSENSOR_SHM_MAX_ENTRIES; sensors++, n++)
+		publish(&shm->entries[n], *sensors);
+
+	if (*sensors)
+		log_debug("pshm: only %d sensors are published.", n);
+
+	if (shm->count != n)
+		__atomic_store_n(&shm->count, n, __ATOMIC_RELEASE);
+}
+
+void pshm_close(void)
+{
+	if (shm) {
+		__atomic_store_n(&shm->count, 0, __ATOMIC_RELEASE);
+		shm->pid = 0;
+		/*
+		 * The segment is removed while it is still locked, a
+		 * new writer creates its own.
+		 */
+		unlink(shm_path);
+	}
+
+	cleanup();
+}
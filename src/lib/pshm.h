@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PSHM_H
+#define PSENSOR_PSHM_H
+
+#include <bool.h>
+#include <psensor.h>
+#include <psensor_shm.h>
+
+/*
+ * Publication of the current values of the sensors in shared memory,
+ * see psensor_shm.h for the layout and the reader.
+ *
+ * A single process publishes in a segment: it holds a lock on it
+ * until pshm_close(), another psensor or psensor-server fails to
+ * open it.
+ */
+
+/* Opens the segment 'path', PSENSOR_SHM_PATH if NULL. */
+bool pshm_open(const char *path);
+
+/* Publishes the current value of 'sensors', must be NULL terminated. */
+void pshm_publish(struct psensor **sensors);
+
+void pshm_close(void);
+
+#endif
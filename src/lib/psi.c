@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <pevent.h>
+#include <psi.h>
+
+static const char *PROVIDER_NAME = "psi";
+
+/* unprivileged triggers require a multiple of 2 seconds */
+static const unsigned int TRIGGER_WINDOW_US = 2000000;
+
+enum psi_field {
+	PSI_AVG10,
+	PSI_AVG60,
+	PSI_TOTAL
+};
+
+struct psi_resource {
+	const char *name;
+	unsigned int type;
+
+	/* number of sensors using the resource */
+	int users;
+	int fd;
+	int trigger_fd;
+
+	/* update during which the values below have been read */
+	unsigned int tick;
+	bool valid;
+	double avg10;
+	double avg60;
+	uint64_t total;
+
+	/* previous total to compute the stall during the interval */
+	uint64_t last_total;
+	struct timespec last_time;
+	double total_rate;
+};
+
+struct psi_data {
+	struct psi_resource *resource;
+	enum psi_field field;
+};
+
+static struct psi_resource resources[] = {
+	{"cpu", SENSOR_TYPE_CPU, 0, -1, -1},
+	{"memory", SENSOR_TYPE_MEMORY, 0, -1, -1},
+	{"io", SENSOR_TYPE_HDD, 0, -1, -1}
+};
+
+static const int RESOURCES_LEN = sizeof(resources) / sizeof(resources[0]);
+
+static char *root;
+static unsigned int trigger_stall_ms;
+static unsigned int tick;
+
+void psi_set_root(const char *r)
+{
+	free(root);
+	root = r ? strdup(r) : NULL;
+}
+
+void psi_set_trigger(unsigned int stall_ms)
+{
+	trigger_stall_ms = stall_ms;
+}
+
+static char *get_path(struct psi_resource *r)
+{
+	char *path;
+
+	if (asprintf(&path, "%s/proc/pressure/%s", root ? root : "", r->name)
+	    == -1)
+		return NULL;
+
+	return path;
+}
+
+static bool trigger_cbk(int fd, short revents, void *data)
+{
+	struct psi_resource *r;
+
+	r = data;
+
+	if (revents & POLLERR) {
+		log_err(_("%s: %s: trigger error."), PROVIDER_NAME, r->name);
+		return false;
+	}
+
+	if (revents & POLLPRI) {
+		log_debug("%s: %s: stall", PROVIDER_NAME, r->name);
+		pevent_wakeup();
+	}
+
+	return true;
+}
+
+static void trigger_open(struct psi_resource *r, const char *path)
+{
+	char *trigger;
+	int fd, n;
+
+	fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd == -1) {
+		log_warn(_("%s: %s: cannot register a trigger: %s."),
+			 PROVIDER_NAME, path, strerror(errno));
+		return;
+	}
+
+	n = asprintf(&trigger,
+		     "some %u %u",
+		     trigger_stall_ms * 1000,
+		     TRIGGER_WINDOW_US);
+	if (n == -1) {
+		close(fd);
+		return;
+	}
+
+	/* the trailing NUL is part of the trigger */
+	if (write(fd, trigger, n + 1) == -1) {
+		log_warn(_("%s: %s: cannot register a trigger: %s."),
+			 PROVIDER_NAME, path, strerror(errno));
+		close(fd);
+	} else if (!pevent_add(fd, POLLPRI, trigger_cbk, r)) {
+		close(fd);
+	} else {
+		r->trigger_fd = fd;
+	}
+
+	free(trigger);
+}
+
+static bool resource_open(struct psi_resource *r)
+{
+	char *path;
+
+	if (r->users) {
+		r->users++;
+		return true;
+	}
+
+	path = get_path(r);
+	if (!path)
+		return false;
+
+	r->fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (r->fd == -1) {
+		log_debug("%s: %s: %s", PROVIDER_NAME, path, strerror(errno));
+		free(path);
+		return false;
+	}
+
+	if (trigger_stall_ms)
+		trigger_open(r, path);
+
+	free(path);
+
+	r->users = 1;
+	r->tick = tick - 1;
+	r->valid = false;
+	r->last_time.tv_sec = 0;
+
+	return true;
+}
+
+static void psi_data_free(void *data)
+{
+	struct psi_resource *r;
+
+	r = ((struct psi_data *)data)->resource;
+
+	r->users--;
+	if (!r->users) {
+		if (r->trigger_fd != -1) {
+			pevent_remove(r->trigger_fd);
+			close(r->trigger_fd);
+			r->trigger_fd = -1;
+		}
+
+		close(r->fd);
+		r->fd = -1;
+	}
+
+	free(data);
+}
+
+/* Parses "some avg10=0.12 avg60=0.05 avg300=0.01 total=12345". */
+static bool parse(struct psi_resource *r, const char *buf)
+{
+	char *c, *end;
+
+	if (strncmp(buf, "some ", 5))
+		return false;
+
+	c = strstr(buf, "avg10=");
+	if (!c)
+		return false;
+	r->avg10 = strtod(c + 6, &end);
+
+	c = strstr(end, "avg60=");
+	if (!c)
+		return false;
+	r->avg60 = strtod(c + 6, &end);
+
+	c = strstr(end, "total=");
+	if (!c)
+		return false;
+	r->total = strtoull(c + 6, NULL, 10);
+
+	return true;
+}
+
+static void resource_read(struct psi_resource *r)
+{
+	char buf[256];
+	ssize_t n;
+	struct timespec t;
+	double dt;
+
+	r->tick = tick;
+	r->valid = false;
+
+	n = pread(r->fd, buf, sizeof(buf) - 1, 0);
+	if (n <= 0)
+		return;
+	buf[n] = '\0';
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	if (!parse(r, buf)) {
+		log_err(_("%s: %s: wrong format."), PROVIDER_NAME, r->name);
+		return;
+	}
+
+	r->valid = true;
+
+	/* total is in microseconds */
+	if (r->last_time.tv_sec && r->total >= r->last_total) {
+		dt = (t.tv_sec - r->last_time.tv_sec) * 1000000.0
+			+ (t.tv_nsec - r->last_time.tv_nsec) / 1000.0;
+
+		if (dt > 0) {
+			r->total_rate = 100.0 * (r->total - r->last_total) / dt;
+			if (r->total_rate > 100)
+				r->total_rate = 100;
+		} else {
+			r->total_rate = UNKNOWN_DOUBLE_VALUE;
+		}
+	} else {
+		r->total_rate = UNKNOWN_DOUBLE_VALUE;
+	}
+
+	r->last_total = r->total;
+	r->last_time = t;
+}
+
+static struct psensor *create_sensor(struct psi_resource *r,
+				     enum psi_field field,
+				     unsigned int values_max_length)
+{
+	static const char * const FIELDS[] = {"avg10", "avg60", "total"};
+	char *id, *name;
+	struct psi_data *data;
+	struct psensor *s;
+
+	if (asprintf(&id, "%s %s some %s",
+		     PROVIDER_NAME, r->name, FIELDS[field]) == -1)
+		return NULL;
+
+	switch (field) {
+	case PSI_AVG10:
+		if (asprintf(&name, _("%s pressure (10s)"), r->name) == -1)
+			name = NULL;
+		break;
+	case PSI_AVG60:
+		if (asprintf(&name, _("%s pressure (60s)"), r->name) == -1)
+			name = NULL;
+		break;
+	default:
+		if (asprintf(&name, _("%s pressure"), r->name) == -1)
+			name = NULL;
+	}
+
+	if (!name) {
+		free(id);
+		return NULL;
+	}
+
+	s = psensor_create(id,
+			   name,
+			   strdup(_("Pressure stall")),
+			   SENSOR_TYPE_PSI | SENSOR_TYPE_PERCENT | r->type,
+			   values_max_length);
+
+	data = malloc(sizeof(*data));
+	data->resource = r;
+	data->field = field;
+
+	s->provider_data = data;
+	s->provider_data_free_fct = &psi_data_free;
+
+	return s;
+}
+
+void psi_psensor_list_append(struct psensor ***sensors,
+			     unsigned int values_max_length)
+{
+	struct psi_resource *r;
+	struct psensor *s;
+	int i;
+	enum psi_field f;
+
+	for (i = 0; i < RESOURCES_LEN; i++) {
+		r = &resources[i];
+
+		for (f = PSI_AVG10; f <= PSI_TOTAL; f++) {
+			if (!resource_open(r))
+				break;
+
+			s = create_sensor(r, f, values_max_length);
+			if (!s) {
+				r->users--;
+				continue;
+			}
+
+			psensor_list_append(sensors, s);
+		}
+
+		/* first sample of total */
+		if (r->users)
+			resource_read(r);
+	}
+}
+
+void psi_psensor_list_update(struct psensor **sensors)
+{
+	struct psensor *s;
+	struct psi_data *d;
+	struct psi_resource *r;
+	double v;
+
+	if (!sensors)
+		return;
+
+	tick++;
+
+	for (; *sensors; sensors++) {
+		s = *sensors;
+
+		if (s->type & SENSOR_TYPE_REMOTE
+		    || !(s->type & SENSOR_TYPE_PSI))
+			continue;
+
+		d = s->provider_data;
+		r = d->resource;
+
+		if (r->tick != tick)
+			resource_read(r);
+
+		if (!r->valid)
+			continue;
+
+		switch (d->field) {
+		case PSI_AVG10:
+			v = r->avg10;
+			break;
+		case PSI_AVG60:
+			v = r->avg60;
+			break;
+		default:
+			v = r->total_rate;
+		}
+
+		if (v != UNKNOWN_DOUBLE_VALUE)
+			psensor_set_current_value(s, v);
+	}
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PSI_H
+#define PSENSOR_PSI_H
+
+#include <psensor.h>
+
+/*
+ * Pressure Stall Information of the kernel: share of the time during
+ * which some tasks were stalled on the CPU, the memory or the IO
+ * (/proc/pressure/{cpu,memory,io}).
+ *
+ * The root of /proc can be changed for testing, NULL for /.
+ */
+void psi_set_root(const char *root);
+
+/*
+ * Registers a PSI trigger on each resource which wakes up the update
+ * loop (pevent_wait) when the tasks were stalled more than 'stall_ms'
+ * milliseconds during a 2 seconds window. 0 disables the triggers
+ * (default). Applies to the sensors created afterwards.
+ */
+void psi_set_trigger(unsigned int stall_ms);
+
+void psi_psensor_list_append(struct psensor ***, unsigned int);
+void psi_psensor_list_update(struct psensor **);
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pevent.h>
+#include <psysfs.h>
+
+/* sysfs attributes are at most one page but integers are short */
+#define SYSFS_LONG_LENGTH 32
+#define SYSFS_STR_LENGTH 256
+
+char *sysfs_path_printf(const char *fmt, ...)
+{
+	va_list ap;
+	char *ret;
+
+	va_start(ap, fmt);
+	if (vasprintf(&ret, fmt, ap) == -1)
+		ret = NULL;
+	va_end(ap);
+
+	return ret;
+}
+
+const char *sysfs_basename(const char *path)
+{
+	const char *c;
+
+	c = strrchr(path, '/');
+
+	return c ? c + 1 : path;
+}
+
+static ssize_t read_fd(int fd, char *buf, size_t len)
+{
+	ssize_t n;
+
+	do {
+		n = pread(fd, buf, len - 1, 0);
+	} while (n == -1 && errno == EINTR);
+
+	if (n < 0)
+		return -1;
+
+	buf[n] = '\0';
+
+	while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' '))
+		buf[--n] = '\0';
+
+	return n;
+}
+
+static bool parse_long(const char *str, long *v)
+{
+	char *end;
+
+	errno = 0;
+	*v = strtol(str, &end, 10);
+
+	return !errno && end != str;
+}
+
+int sysfs_open(const char *path)
+{
+	return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+char *sysfs_read_str(const char *path)
+{
+	char buf[SYSFS_STR_LENGTH];
+	int fd;
+	ssize_t n;
+
+	fd = sysfs_open(path);
+	if (fd == -1)
+		return NULL;
+
+	n = read_fd(fd, buf, sizeof(buf));
+
+	close(fd);
+
+	if (n < 0)
+		return NULL;
+
+	return strdup(buf);
+}
+
+bool sysfs_pread_long(int fd, long *v)
+{
+	char buf[SYSFS_LONG_LENGTH];
+
+	if (read_fd(fd, buf, sizeof(buf)) <= 0)
+		return false;
+
+	return parse_long(buf, v);
+}
+
+bool sysfs_read_long(const char *path, long *v)
+{
+	int fd;
+	bool ret;
+
+	fd = sysfs_open(path);
+	if (fd == -1)
+		return false;
+
+	ret = sysfs_pread_long(fd, v);
+
+	close(fd);
+
+	return ret;
+}
+
+static bool alarm_cbk(int fd, short revents, void *data)
+{
+	long v;
+
+	/* reading the attribute acknowledges the notification */
+	if (!sysfs_pread_long(fd, &v))
+		return false;
+
+	if (v)
+		pevent_wakeup();
+
+	return true;
+}
+
+int sysfs_alarm_watch(const char *path)
+{
+	long v;
+	int fd;
+
+	fd = sysfs_open(path);
+	if (fd == -1)
+		return -1;
+
+	/* the notifications are sent only after a first read */
+	if (!sysfs_pread_long(fd, &v)
+	    || !pevent_add(fd, POLLPRI, alarm_cbk, NULL)) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+void sysfs_alarm_unwatch(int fd)
+{
+	if (fd == -1)
+		return;
+
+	pevent_remove(fd);
+	close(fd);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PSYSFS_H
+#define PSENSOR_PSYSFS_H
+
+#include <bool.h>
+
+/*
+ * Helpers to read sysfs attributes. The size of sysfs files is not
+ * their content size, the helpers of io.h cannot be used.
+ */
+
+/*
+ * Returns the content of an attribute without the trailing blanks or
+ * NULL if it cannot be read. The returned string must be freed.
+ */
+char *sysfs_read_str(const char *path);
+
+/*
+ * Returns the allocated result of the printf-like format, NULL on
+ * failure.
+ */
+char *sysfs_path_printf(const char *fmt, ...)
+	__attribute__((format(printf, 1, 2)));
+
+/* Returns the last component of 'path', which is not copied. */
+const char *sysfs_basename(const char *path);
+
+/* Reads an integer attribute, returns false on failure. */
+bool sysfs_read_long(const char *path, long *v);
+
+/*
+ * Opens an attribute to read it several times with sysfs_pread_long,
+ * returns -1 on failure.
+ */
+int sysfs_open(const char *path);
+
+/* Reads an integer attribute from an opened file descriptor. */
+bool sysfs_pread_long(int fd, long *v);
+
+/*
+ * Watches an alarm attribute (e.g. temp1_alarm) that the kernel
+ * notifies with sysfs_notify(): the update loop is woken up by
+ * pevent_wakeup() as soon as the alarm is raised, instead of at the
+ * end of its interval. Returns the file descriptor to give to
+ * sysfs_alarm_unwatch, -1 on failure.
+ */
+int sysfs_alarm_watch(const char *path);
+void sysfs_alarm_unwatch(int fd);
+
+#endif
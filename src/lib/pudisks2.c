@@ -20,79 +20,187 @@
 #include <libintl.h>
 #define _(str) gettext(str)
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
 
 #include <udisks/udisks.h>
 
+#include <hdd.h>
+#include <pmutex.h>
 #include <pudisks2.h>
 #include <temperature.h>
 
 static const char *PROVIDER_NAME = "udisks2";
 
-static GDBusObjectManager *manager;
-
 static const time_t SMART_UPDATE_INTERVAL = 30;
 
+/*
+ * The D-Bus objects are owned by a dedicated thread running this
+ * context: the signals and the replies of the asynchronous calls are
+ * dispatched there, never in the thread updating the sensors.
+ */
+static GMainContext *context;
+static GMainLoop *loop;
+
+/* Kept alive so that the proxies keep receiving the D-Bus signals */
+static UDisksClient *client;
+
+/* Protects the drives list and the temperatures */
+static pthread_mutex_t drives_mutex = PTHREAD_MUTEX_INITIALIZER;
+static GList *drives;
+
 struct udisks_data {
 	char *path;
-	struct timeval last_smart_update;
+	UDisksDriveAta *ata;
+	gulong notify_handler;
+	/* Last temperature in Celsius */
+	double temp;
 };
 
-static void udisks_data_free(void *data)
+/* Called in the context thread. */
+static gboolean udisks_data_free_cbk(gpointer user_data)
 {
 	struct udisks_data *u;
 
-	u = (struct udisks_data *)data;
+	u = user_data;
+
+	pmutex_lock(&drives_mutex);
+	drives = g_list_remove(drives, u);
+	pmutex_unlock(&drives_mutex);
+
+	g_signal_handler_disconnect(u->ata, u->notify_handler);
+	g_object_unref(u->ata);
+
 	free(u->path);
 	free(u);
+
+	return FALSE;
 }
 
-static void smart_update(struct psensor *s, UDisksDriveAta *ata)
+/*
+ * The signal handler may be running in the context thread, the data
+ * are freed there.
+ */
+static void udisks_data_free(void *data)
+{
+	g_main_context_invoke(context, udisks_data_free_cbk, data);
+}
+
+/*
+ * Called in the context thread when UDisks publishes a new value of
+ * the SmartTemperature property.
+ */
+static void
+smart_temperature_changed_cbk(GObject *o, GParamSpec *pspec, gpointer user_data)
 {
-	GVariant *variant;
-	gboolean ret;
-	struct timeval t;
 	struct udisks_data *data;
+	double v;
 
-	data = s->provider_data;
+	data = user_data;
 
-	if (gettimeofday(&t, NULL) != 0) {
-		log_err("%s: %s", PROVIDER_NAME, _("gettimeofday failed."));
-		return;
+	v = kelvin_to_celsius(udisks_drive_ata_get_smart_temperature(data->ata));
+
+	log_functionname("%s: %s %.2f", PROVIDER_NAME, data->path, v);
+
+	pmutex_lock(&drives_mutex);
+	data->temp = v;
+	pmutex_unlock(&drives_mutex);
+}
+
+static void
+smart_update_cbk(GObject *o, GAsyncResult *res, gpointer user_data)
+{
+	GError *err;
+	char *path;
+
+	path = user_data;
+	err = NULL;
+
+	if (!udisks_drive_ata_call_smart_update_finish(UDISKS_DRIVE_ATA(o),
+						       res,
+						       &err)) {
+		log_functionname("%s: SMART update failed for %s: %s",
+				 PROVIDER_NAME,
+				 path,
+				 err->message);
+		g_error_free(err);
 	}
 
-	if (data->last_smart_update.tv_sec
-	    &&
-	    (t.tv_sec - data->last_smart_update.tv_sec < SMART_UPDATE_INTERVAL))
-		return;
+	free(path);
+}
 
-	log_functionname("%s: update SMART data for %s", PROVIDER_NAME, data->path);
+/*
+ * Requests UDisks to refresh the SMART data of the drives, the new
+ * temperatures are then received through smart_temperature_changed_cbk.
+ */
+static gboolean smart_update_timeout_cbk(gpointer user_data)
+{
+	GList *cur;
+	struct udisks_data *data;
+	GVariant *variant;
 
-	variant = g_variant_new_parsed("{'nowakeup': %v}",
-				       g_variant_new_boolean(TRUE));
+	pmutex_lock(&drives_mutex);
 
-	ret = udisks_drive_ata_call_smart_update_sync(ata,
-						      variant,
-						      NULL,
-						      NULL);
+	for (cur = drives; cur; cur = cur->next) {
+		data = cur->data;
 
-	if (!ret) {
-		log_functionname("%s: SMART update failed for %s",
-			PROVIDER_NAME,
-			data->path);
+		log_functionname("%s: update SMART data for %s",
+				 PROVIDER_NAME,
+				 data->path);
+
+		variant = g_variant_new_parsed("{'nowakeup': %v}",
+					       g_variant_new_boolean(TRUE));
+
+		udisks_drive_ata_call_smart_update(data->ata,
+						   variant,
+						   NULL,
+						   smart_update_cbk,
+						   strdup(data->path));
 	}
-	data->last_smart_update = t;
+
+	pmutex_unlock(&drives_mutex);
+
+	return TRUE;
+}
+
+static void *loop_run(void *data)
+{
+	g_main_context_push_thread_default(context);
+
+	g_main_loop_run(loop);
+
+	g_main_context_pop_thread_default(context);
+
+	return NULL;
+}
+
+static void loop_start(void)
+{
+	GSource *source;
+	pthread_t thread;
+
+	source = g_timeout_source_new_seconds(SMART_UPDATE_INTERVAL);
+	g_source_set_callback(source, smart_update_timeout_cbk, NULL, NULL);
+	g_source_attach(source, context);
+	g_source_unref(source);
+
+	loop = g_main_loop_new(context, FALSE);
+
+	if (pthread_create(&thread, NULL, loop_run, NULL)) {
+		log_err(_("%s: failed to create the D-Bus thread."),
+			PROVIDER_NAME);
+		return;
+	}
+
+	pthread_detach(thread);
 }
 
 void udisks2_psensor_list_update(struct psensor **sensors)
 {
 	struct psensor *s;
-	GDBusObject *o;
-	UDisksDriveAta *drive_ata;
-	double v;
 	struct udisks_data *data;
+	double v;
 
 	for (; *sensors; sensors++) {
 		s = *sensors;
@@ -103,28 +211,35 @@ void udisks2_psensor_list_update(struct psensor **sensors)
 		if (s->type & SENSOR_TYPE_UDISKS2) {
 			data = (struct udisks_data *)s->provider_data;
 
-			o = g_dbus_object_manager_get_object(manager,
-							     data->path);
+			pmutex_lock(&drives_mutex);
+			v = data->temp;
+			pmutex_unlock(&drives_mutex);
 
-			if (!o)
-				continue;
+			psensor_set_current_value(s, v);
+		}
+	}
+}
 
-			g_object_get(o, "drive-ata", &drive_ata, NULL);
+/* Whether the block device of a drive is monitored through hwmon */
+static bool is_hwmon_disk(struct psensor **sensors, UDisksDrive *drive)
+{
+	UDisksBlock *block;
+	bool ret;
 
-			smart_update(s, drive_ata);
+	block = udisks_client_get_block_for_drive(client, drive, FALSE);
+	if (!block)
+		return false;
 
-			v = udisks_drive_ata_get_smart_temperature(drive_ata);
+	ret = hwmon_disk_has_device(sensors, udisks_block_get_device(block));
 
-			psensor_set_current_value(s, kelvin_to_celsius(v));
+	g_object_unref(block);
 
-			g_object_unref(G_OBJECT(o));
-		}
-	}
+	return ret;
 }
 
 void udisks2_psensor_list_append(struct psensor ***sensors, unsigned int values_length)
 {
-	UDisksClient *client;
+	GDBusObjectManager *manager;
 	GList *objects, *cur;
 	UDisksDrive *drive;
 	UDisksDriveAta *drive_ata;
@@ -136,10 +251,18 @@ void udisks2_psensor_list_append(struct psensor ***sensors, unsigned int values_
 
 	log_functionname_enter();
 
-	client = udisks_client_new_sync(NULL, NULL);
+	if (!context)
+		context = g_main_context_new();
+
+	/* the proxies will dispatch their signals in 'context' */
+	g_main_context_push_thread_default(context);
+
+	if (!client)
+		client = udisks_client_new_sync(NULL, NULL);
 
 	if (!client) {
 		log_err(_("%s: cannot get the udisks2 client"), PROVIDER_NAME);
+		g_main_context_pop_thread_default(context);
 		log_functionname_exit();
 		return;
 	}
@@ -164,16 +287,28 @@ void udisks2_psensor_list_append(struct psensor ***sensors, unsigned int values_
 
 		if (!drive_ata) {
 			log_functionname("Not an ATA drive: %s", path);
+			g_object_unref(drive);
 			continue;
 		}
 
 		if (!udisks_drive_ata_get_smart_enabled(drive_ata)) {
 			log_functionname("SMART not enabled: %s", path);
+			g_object_unref(drive);
+			g_object_unref(drive_ata);
 			continue;
 		}
 
 		if (!udisks_drive_ata_get_smart_temperature(drive_ata)) {
 			log_functionname("No temperature available: %s", path);
+			g_object_unref(drive);
+			g_object_unref(drive_ata);
+			continue;
+		}
+
+		if (is_hwmon_disk(*sensors, drive)) {
+			log_functionname("Monitored by hwmon: %s", path);
+			g_object_unref(drive);
+			g_object_unref(drive_ata);
 			continue;
 		}
 
@@ -200,17 +335,34 @@ void udisks2_psensor_list_append(struct psensor ***sensors, unsigned int values_
 
 		data = malloc(sizeof(struct udisks_data));
 		data->path = strdup(path);
-		memset(&data->last_smart_update, 0, sizeof(struct timeval));
+		data->ata = drive_ata;
+		data->temp = kelvin_to_celsius
+			(udisks_drive_ata_get_smart_temperature(drive_ata));
+		data->notify_handler
+			= g_signal_connect(drive_ata,
+					   "notify::smart-temperature",
+					   G_CALLBACK(smart_temperature_changed_cbk),
+					   data);
+
+		pmutex_lock(&drives_mutex);
+		drives = g_list_append(drives, data);
+		pmutex_unlock(&drives_mutex);
 
 		s->provider_data = data;
 		s->provider_data_free_fct = &udisks_data_free;
 
 		psensor_list_append(sensors, s);
 
+		g_object_unref(drive);
 		g_object_unref(G_OBJECT(cur->data));
 	}
 
 	g_list_free(objects);
 
+	g_main_context_pop_thread_default(context);
+
+	if (drives && !loop)
+		loop_start();
+
 	log_functionname_exit();
 }
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <pworker.h>
+
+static void *worker_routine(void *data)
+{
+	struct pworker *w;
+
+	w = data;
+
+	do {
+		sem_wait(&w->sem);
+		w->consume(&w->queue);
+	} while (atomic_load(&w->running));
+
+	/* pushed between the last consume and the stop */
+	w->consume(&w->queue);
+
+	return NULL;
+}
+
+void pworker_init(struct pworker *w,
+		  unsigned int size,
+		  void (*consume)(struct pqueue *q))
+{
+	pqueue_init(&w->queue, size);
+	w->consume = consume;
+	sem_init(&w->sem, 0, 0);
+	atomic_init(&w->running, false);
+}
+
+bool pworker_start(struct pworker *w)
+{
+	atomic_store(&w->running, true);
+
+	if (pthread_create(&w->thread, NULL, worker_routine, w)) {
+		atomic_store(&w->running, false);
+		return false;
+	}
+
+	return true;
+}
+
+void pworker_push(struct pworker *w)
+{
+	pqueue_push(&w->queue);
+	sem_post(&w->sem);
+}
+
+void pworker_stop(struct pworker *w)
+{
+	/* the thread empties the queue before leaving */
+	if (atomic_exchange(&w->running, false)) {
+		sem_post(&w->sem);
+		pthread_join(w->thread, NULL);
+	}
+
+	sem_destroy(&w->sem);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_PWORKER_H
+#define PSENSOR_PWORKER_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+#include <bool.h>
+#include <pqueue.h>
+
+/*
+ * Thread consuming a pqueue: the producer pushes the slots with
+ * pworker_push, and 'consume' is called in the thread to pop all
+ * the available ones. The slots are stored by the caller, as for
+ * pqueue.
+ */
+struct pworker {
+	struct pqueue queue;
+	void (*consume)(struct pqueue *q);
+	/* one post per pushed slot, or to stop */
+	sem_t sem;
+	atomic_bool running;
+	pthread_t thread;
+};
+
+/* Initializes the queue of 'size' slots, see pqueue_init. */
+void pworker_init(struct pworker *w,
+		  unsigned int size,
+		  void (*consume)(struct pqueue *q));
+
+/* Creates the thread, returns false on failure. */
+bool pworker_start(struct pworker *w);
+
+/* Producer: makes the reserved slot available to the thread. */
+void pworker_push(struct pworker *w);
+
+/*
+ * Waits for the thread to empty the queue and to exit, then releases
+ * the worker. Can be called if the thread was not started.
+ */
+void pworker_stop(struct pworker *w);
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <scache.h>
+
+/*
+ * Format: a version line followed by one line per sensor:
+ * type (hexadecimal), min, max, id, name and chip separated by tabs.
+ */
+static const char *VERSION_LINE = "V,1";
+
+static bool is_field(const char *str)
+{
+	return str && !strpbrk(str, "\t\n");
+}
+
+bool scache_save(const char *path, struct psensor **sensors)
+{
+	char *tmp;
+	FILE *f;
+	struct psensor *s;
+	bool ret;
+
+	if (asprintf(&tmp, "%s.tmp", path) == -1)
+		return false;
+
+	f = fopen(tmp, "w");
+	if (!f) {
+		log_err(_("Cannot open %s: %s."), tmp, strerror(errno));
+		free(tmp);
+		return false;
+	}
+
+	fprintf(f, "%s\n", VERSION_LINE);
+
+	for (; *sensors; sensors++) {
+		s = *sensors;
+
+		if (!(s->type & SENSOR_TYPE_PROVIDERS)
+		    || s->type & SENSOR_TYPE_REMOTE
+		    || !is_field(s->id)
+		    || !is_field(s->name)
+		    || !is_field(s->chip))
+			continue;
+
+		fprintf(f, "%x\t%.17g\t%.17g\t%s\t%s\t%s\n",
+			s->type, s->min, s->max, s->id, s->name, s->chip);
+	}
+
+	ret = !ferror(f);
+
+	if (fclose(f))
+		ret = false;
+
+	/* replaces the previous cache only when complete */
+	if (ret && rename(tmp, path) == -1)
+		ret = false;
+
+	if (!ret) {
+		log_err(_("Cannot write %s."), path);
+		unlink(tmp);
+	}
+
+	free(tmp);
+
+	return ret;
+}
+
+static struct psensor *parse_line(char *line, unsigned int values_max_length)
+{
+	char *fields[6], *c, *end;
+	unsigned int type;
+	double min, max;
+	struct psensor *s;
+	int i;
+
+	c = line;
+	for (i = 0; i < 6; i++) {
+		fields[i] = c;
+
+		c = strchr(c, i < 5 ? '\t' : '\n');
+		if (c)
+			*c++ = '\0';
+		else if (i < 5)
+			return NULL;
+	}
+
+	type = strtoul(fields[0], &end, 16);
+	if (*end || !(type & SENSOR_TYPE_PROVIDERS))
+		return NULL;
+
+	min = strtod(fields[1], &end);
+	if (*end)
+		return NULL;
+
+	max = strtod(fields[2], &end);
+	if (*end)
+		return NULL;
+
+	s = psensor_create(strdup(fields[3]),
+			   strdup(fields[4]),
+			   strdup(fields[5]),
+			   type & ~SENSOR_TYPE_PROVIDERS,
+			   values_max_length);
+	s->min = min;
+	s->max = max;
+
+	return s;
+}
+
+struct psensor **scache_load(const char *path, unsigned int values_max_length)
+{
+	FILE *f;
+	char *line;
+	size_t n;
+	struct psensor **sensors, *s;
+
+	f = fopen(path, "r");
+	if (!f) {
+		log_debug("scache: %s: %s", path, strerror(errno));
+		return NULL;
+	}
+
+	line = NULL;
+	n = 0;
+
+	if (getline(&line, &n, f) == -1
+	    || strncmp(line, VERSION_LINE, strlen(VERSION_LINE))) {
+		log_warn(_("Ignoring %s, unknown format."), path);
+		free(line);
+		fclose(f);
+		return NULL;
+	}
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	while (getline(&line, &n, f) != -1) {
+		s = parse_line(line, values_max_length);
+
+		if (s && !psensor_list_get_by_id(sensors, s->id))
+			psensor_list_append(&sensors, s);
+		else
+			psensor_free(s);
+	}
+
+	free(line);
+	fclose(f);
+
+	return sensors;
+}
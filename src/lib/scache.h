@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_SCACHE_H
+#define PSENSOR_SCACHE_H
+
+#include <psensor.h>
+
+/*
+ * Cache of the discovered sensors, to show them at startup before
+ * the providers found them again.
+ *
+ * The id of a sensor is its stable key: the providers build it from
+ * the device (chip name, block device, zone, ...).
+ */
+
+/* Saves the sensors which have a provider, returns false on failure. */
+bool scache_save(const char *path, struct psensor **sensors);
+
+/*
+ * Returns the sensors of the cache, without provider until they are
+ * given one by psensor_adopt. NULL if the cache cannot be read.
+ */
+struct psensor **scache_load(const char *path,
+			     unsigned int values_max_length);
+
+#endif
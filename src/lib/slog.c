@@ -27,6 +27,8 @@
 #include <libintl.h>
 #define _(str) gettext(str)
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,40 +41,87 @@
 #include "config.h"
 #include <plog.h>
 #include <pmutex.h>
+#include <pqueue.h>
+#include <pworker.h>
+#include <slogfile.h>
+#include <slogread.h>
 #include "ptime.h"
 #include "slog.h"
 
+/*
+ * The sampling thread copies the values of the sensors into a queue
+ * and the writer thread encodes and writes them, so that a slow
+ * storage never delays the monitoring while the sensors are locked.
+ */
+
+/* A new section of the log or a record of the values. */
+struct slog_item {
+	/* the section, NULL for a record */
+	struct slog_header *header;
+	struct timeval time;
+	double *values;
+	/* number of allocated values */
+	size_t size;
+};
+
+/* records kept when the writer is late, beyond they are dropped */
+static const unsigned int QUEUE_SIZE = 64;
+
 static FILE *file;
-static double *s_last_values;
+/* NULL when the log is not active */
+static char *log_path;
+static enum slog_format format = SLOG_FORMAT_CSV;
+static enum slog_sync sync_policy = SLOG_SYNC_NONE;
+static struct slog_rotation rotation;
 static unsigned int period;
 static struct psensor **s_sensors;
 static pthread_mutex_t *sensors_mutex;
-static pthread_t thread;
-static time_t st;
-static volatile int slog_thread_running = 1;
-
-static const char *DEFAULT_FILENAME = "sensors.log";
-
-static char *time_to_str(time_t *t)
-{
-	struct tm lt;
-	char *str;
-
-	if (!localtime_r(t, &lt))
-		return NULL;
 
-	str = malloc(64);
+/* protected by sensors_mutex */
+static bool header_pending;
 
-	if (strftime(str, 64, "%s", &lt))
-		return str;
+/* sampling thread */
+static pthread_t thread;
+static size_t n_sensors;
+static pthread_mutex_t stop_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+static bool stop_requested;
+
+/* writer thread */
+static struct pworker writer;
+static struct slog_item *items;
+static struct slog_encoder encoder;
+static struct pbuf buf;
+/* sensors of the current section, repeated in each segment */
+static struct slog_header *header;
+/* current segment */
+static off_t seg_size;
+static int seg_day;
+static unsigned int seg_records;
+
+/* compression and retention of the last rotated segment */
+static pthread_t job;
+static bool has_job;
+
+struct slog_job {
+	char *path;
+	char *segment;
+	enum slog_compression compression;
+	unsigned int keep;
+};
 
-	free(str);
-	return NULL;
-}
+static const char *DEFAULT_FILENAME = "sensors.log";
+static const char *DEFAULT_BINARY_FILENAME = "sensors.slog";
 
 static char *get_default_path(void)
 {
 	char *home, *path, *dir;
+	const char *name;
+
+	if (format == SLOG_FORMAT_BINARY)
+		name = DEFAULT_BINARY_FILENAME;
+	else
+		name = DEFAULT_FILENAME;
 
 	home = getenv("HOME");
 
@@ -82,7 +131,7 @@ static char *get_default_path(void)
 			return NULL;
 		mkdir(dir, 0777);
 
-		result = asprintf(&path, "%s/%s", dir, DEFAULT_FILENAME);		
+		result = asprintf(&path, "%s/%s", dir, name);
 		free(dir);
 		if (result == -1 ) 
 			return NULL;
@@ -91,112 +140,374 @@ static char *get_default_path(void)
 	}
 
 	log_warn(_("HOME variable not set."));
-	return strdup(DEFAULT_FILENAME);
+	return strdup(name);
 }
 
-static bool slog_open(const char *path, struct psensor **sensors)
+static void sync_file(void)
 {
-	char *lpath, *t;
+	int ret;
+
+	switch (sync_policy) {
+	case SLOG_SYNC_DATA:
+		ret = fdatasync(fileno(file));
+		break;
+	case SLOG_SYNC_FULL:
+		ret = fsync(fileno(file));
+		break;
+	default:
+		ret = 0;
+	}
 
-	if (file) {
-		log_err(_("Sensor log file already open."));
+	if (ret)
+		log_err(_("Cannot sync the sensor log: %s."), strerror(errno));
+}
+
+static void flush_buf(void)
+{
+	if (!buf.len || !file)
+		return;
+
+	if (buf.err
+	    || fwrite(buf.data, 1, buf.len, file) != buf.len
+	    || fflush(file))
+		log_err(_("Cannot write the sensor log."));
+	else
+		sync_file();
+
+	seg_size += buf.len;
+
+	pbuf_reset(&buf);
+}
+
+static int get_day(time_t t)
+{
+	struct tm tm;
+
+	if (!localtime_r(&t, &tm))
 		return 0;
-	}
 
-	lpath = path ? (char *)path : get_default_path();
+	return tm.tm_year * 366 + tm.tm_yday;
+}
 
-	file = fopen(lpath, "a");
+static void *job_routine(void *data)
+{
+	struct slog_job *j;
 
-	if (!file)
-		log_err(_("Cannot open sensor log file: %s."), lpath);
+	j = data;
 
-	if (!path)
-		free(lpath);
+	slog_segment_archive(j->path, j->segment, j->compression, j->keep);
+
+	free(j->path);
+	free(j->segment);
+	free(j);
+
+	return NULL;
+}
+
+/* Compresses the segment without delaying the next writes. */
+static void start_job(char *segment)
+{
+	struct slog_job *j;
+
+	/* rotations are rare, one job at a time */
+	if (has_job)
+		pthread_join(job, NULL);
+
+	j = malloc(sizeof(*j));
+	j->path = strdup(log_path);
+	j->segment = segment;
+	j->compression = rotation.compression;
+	j->keep = rotation.keep;
+
+	has_job = !pthread_create(&job, NULL, job_routine, j);
+	if (!has_job)
+		job_routine(j);
+}
+
+/* Whether the record must start a new segment. */
+static bool is_rotation_needed(const struct slog_item *it)
+{
+	/* a segment has at least one record */
+	if (!seg_records)
+		return false;
+
+	if (rotation.max_size && seg_size + buf.len >= rotation.max_size)
+		return true;
+
+	return rotation.daily && get_day(it->time.tv_sec) != seg_day;
+}
+
+static void rotate(time_t t)
+{
+	char *segment;
+
+	flush_buf();
+
+	if (file)
+		fclose(file);
+
+	segment = slog_segment_rotate(log_path, t);
 
+	file = fopen(log_path, "a");
 	if (!file)
-		return 0;
+		log_err(_("Cannot open sensor log file: %s."), log_path);
 
-	st = time(NULL);
-	t = time_to_str(&st);
-	fprintf(file, "I,%s,%s\n", t, VERSION);
-	free(t);
+	seg_size = 0;
+	seg_day = get_day(t);
+	seg_records = 0;
 
-	while (*sensors) {
-		fprintf(file, "S,%s,%x\n", (*sensors)->id,  (*sensors)->type);
-		sensors++;
+	if (segment) {
+		log_info(_("Sensor log rotated to %s."), segment);
+		start_job(segment);
 	}
 
-	fflush(file);
+	/* the segment can be read on its own */
+	if (header) {
+		header->start = t;
+		slog_encode_header(&encoder, &buf, header);
+	}
+}
 
-	return 1;
+/* Writes all the queued items at once. */
+static void write_items(struct pqueue *queue)
+{
+	struct slog_item *it;
+	int i;
+
+	while ((i = pqueue_front(queue)) != -1) {
+		it = &items[i];
+
+		if (it->header) {
+			slog_encode_header(&encoder, &buf, it->header);
+
+			if (header) {
+				slog_header_free(header);
+				free(header);
+			}
+			header = it->header;
+			it->header = NULL;
+		} else {
+			if (is_rotation_needed(it))
+				rotate(it->time.tv_sec);
+
+			slog_encode_record(&encoder,
+					   &buf,
+					   &it->time,
+					   it->values);
+			seg_records++;
+		}
+
+		pqueue_pop(queue);
+	}
+
+	flush_buf();
 }
 
-static void slog_write_sensors(struct psensor **sensors)
+static struct slog_header *create_header(struct psensor **sensors)
 {
-	size_t count, i;
-	double v;
-	struct timeval tv;
-	bool first_call;
+	struct slog_header *h;
+	size_t i;
+
+	h = malloc(sizeof(*h));
+	h->start = time(NULL);
+	h->version = strdup(VERSION);
+	h->n = psensor_list_size(sensors);
+	h->ids = malloc(h->n * sizeof(char *));
+	h->types = malloc(h->n * sizeof(unsigned int));
+
+	for (i = 0; i < h->n; i++) {
+		h->ids[i] = strdup(sensors[i]->id);
+		h->types[i] = sensors[i]->type;
+	}
 
-	if (!file) {
-		log_debug(_("Sensor log file not open."));
-		return;
+	return h;
+}
+
+static struct slog_item *reserve(void)
+{
+	int i;
+
+	i = pqueue_reserve(&writer.queue);
+	if (i == -1) {
+		log_warn(_("Sensor log is late, a record is dropped."));
+		return NULL;
 	}
 
-	gettimeofday(&tv, NULL);
+	return &items[i];
+}
+
+/* Copies the current values to the queue, the mutex is locked. */
+static void enqueue_sensors(void)
+{
+	struct slog_item *it;
+	size_t i;
+
+	if (header_pending) {
+		it = reserve();
+		if (!it)
+			return;
 
-	count = psensor_list_size(sensors);
+		it->header = create_header(s_sensors);
+		n_sensors = it->header->n;
+		pworker_push(&writer);
 
-	if (s_last_values) {
-		first_call = 0;
-	} else {
-		first_call = 1;
-		s_last_values = malloc(count * sizeof(double));
+		header_pending = false;
 	}
 
-	fprintf(file, "%ld", (long int)(tv.tv_sec - st));
-	for (i = 0; i < count; i++) {
-		v = psensor_get_current_value(sensors[i]);
+	it = reserve();
+	if (!it)
+		return;
 
-		if (!first_call && s_last_values[i] == v)
-			fputc(',', file);
-		else
-			fprintf(file, ",%.1f", v);
+	it->header = NULL;
+	gettimeofday(&it->time, NULL);
 
-		s_last_values[i] = v;
+	if (it->size < n_sensors) {
+		free(it->values);
+		it->values = malloc(n_sensors * sizeof(double));
+		it->size = n_sensors;
 	}
 
-	fputc('\n', file);
+	for (i = 0; i < n_sensors; i++)
+		it->values[i] = psensor_get_current_value(s_sensors[i]);
 
-	fflush(file);
+	pworker_push(&writer);
 }
 
 static void *slog_routine(void *data)
 {
-	while (slog_thread_running) {
-		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+	struct timespec ts;
+	bool stop;
+
+	do {
 		pmutex_lock(sensors_mutex);
-		slog_write_sensors(s_sensors);
+		enqueue_sensors();
 		pmutex_unlock(sensors_mutex);
-		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-		sleep(period);
-	}
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += period;
+
+		pthread_mutex_lock(&stop_mutex);
+		while (!stop_requested
+		       && pthread_cond_timedwait(&stop_cond,
+						 &stop_mutex,
+						 &ts) != ETIMEDOUT)
+			;
+		stop = stop_requested;
+		pthread_mutex_unlock(&stop_mutex);
+	} while (!stop);
+
 	return NULL;
 }
 
-void slog_close(void)
+/* Whether the content of the file, if any, is in the given format. */
+static bool is_format(FILE *f, enum slog_format fmt)
+{
+	struct slog_decoder d;
+	unsigned char c;
+	bool ret;
+
+	if (fseeko(f, 0, SEEK_SET) || fread(&c, 1, 1, f) != 1)
+		return true;
+
+	slog_decoder_init(&d, &c, 1);
+	ret = d.format == fmt;
+	slog_decoder_free(&d);
+
+	return ret;
+}
+
+static bool slog_open(const char *path)
 {
-	if (file) {
-		slog_thread_running = 0;  // signal to stop thread
-        pthread_join(thread, NULL);  // wait for thread to finish
+	char *lpath;
+	struct stat st;
+
+	if (log_path) {
+		log_err(_("Sensor log file already open."));
+		return 0;
+	}
+
+	lpath = path ? (char *)path : get_default_path();
+
+	file = fopen(lpath, "a+");
 
+	if (!file) {
+		log_err(_("Cannot open sensor log file: %s."), lpath);
+	} else if (!is_format(file, format)) {
+		log_err(_("Sensor log file %s is not in the %s format."),
+			lpath,
+			slog_format_to_str(format));
 		fclose(file);
 		file = NULL;
-		free(s_last_values);
-		s_last_values = NULL;
-	} else {
+	}
+
+	if (!file) {
+		if (!path)
+			free(lpath);
+		return 0;
+	}
+
+	log_path = path ? strdup(path) : lpath;
+
+	if (fstat(fileno(file), &st))
+		st.st_size = 0;
+
+	seg_size = st.st_size;
+	seg_records = st.st_size ? 1 : 0;
+	seg_day = get_day(st.st_size ? st.st_mtime : time(NULL));
+
+	slog_encoder_init(&encoder, format);
+	pbuf_init(&buf, 0);
+
+	pworker_init(&writer, QUEUE_SIZE, write_items);
+	items = calloc(writer.queue.size, sizeof(struct slog_item));
+
+	header_pending = true;
+
+	return 1;
+}
+
+void slog_close(void)
+{
+	unsigned int i;
+
+	if (!log_path) {
 		log_debug(_("Sensor log not open, cannot close."));
+		return;
+	}
+
+	pthread_mutex_lock(&stop_mutex);
+	stop_requested = true;
+	pthread_cond_signal(&stop_cond);
+	pthread_mutex_unlock(&stop_mutex);
+	pthread_join(thread, NULL);
+
+	pworker_stop(&writer);
+
+	if (has_job) {
+		pthread_join(job, NULL);
+		has_job = false;
 	}
+
+	if (file)
+		fclose(file);
+	file = NULL;
+
+	free(log_path);
+	log_path = NULL;
+
+	if (header) {
+		slog_header_free(header);
+		free(header);
+		header = NULL;
+	}
+
+	for (i = 0; i < writer.queue.size; i++)
+		free(items[i].values);
+	free(items);
+	items = NULL;
+
+	slog_encoder_free(&encoder);
+	pbuf_free(&buf);
 }
 
 bool slog_activate(const char *path,
@@ -206,16 +517,128 @@ bool slog_activate(const char *path,
 {
 	bool ret;
 
-	s_sensors = ss;
 	sensors_mutex = mutex;
 	period = p;
+	stop_requested = false;
 
 	pthread_mutex_lock(mutex);
-	ret = slog_open(path, s_sensors);
+	s_sensors = ss;
+	ret = slog_open(path);
 	pthread_mutex_unlock(mutex);
 
-	if (ret)
+	if (ret) {
+		pworker_start(&writer);
 		pthread_create(&thread, NULL, slog_routine, NULL);
+	}
 
 	return ret;
 }
+
+void slog_set_sensors(struct psensor **ss)
+{
+	s_sensors = ss;
+	header_pending = true;
+}
+
+void slog_set_format(enum slog_format fmt)
+{
+	format = fmt;
+}
+
+bool slog_sync_from_str(const char *str, enum slog_sync *policy)
+{
+	if (!strcmp(str, "none"))
+		*policy = SLOG_SYNC_NONE;
+	else if (!strcmp(str, "data"))
+		*policy = SLOG_SYNC_DATA;
+	else if (!strcmp(str, "full"))
+		*policy = SLOG_SYNC_FULL;
+	else
+		return false;
+
+	return true;
+}
+
+void slog_set_sync(enum slog_sync policy)
+{
+	sync_policy = policy;
+}
+
+void slog_set_rotation(const struct slog_rotation *r)
+{
+	rotation = *r;
+}
+
+struct slog_reader *slog_history_open(const char *path, time_t since)
+{
+	struct slog_reader *r;
+	char *lpath;
+
+	lpath = path ? (char *)path : get_default_path();
+	if (!lpath)
+		return NULL;
+
+	r = slog_reader_open(lpath, since);
+	if (!r)
+		log_debug("slog: no history in %s", lpath);
+
+	if (!path)
+		free(lpath);
+
+	return r;
+}
+
+void slog_history_load(struct slog_reader *r,
+		       struct psensor **sensors,
+		       time_t since)
+{
+	struct slog_sample *samples;
+	struct measure *ms;
+	struct psensor **cur;
+	size_t n, i, first;
+	int count;
+
+	count = 0;
+	for (cur = sensors; *cur; cur++) {
+		if ((*cur)->ring)
+			continue;
+
+		samples = slog_reader_query(r, (*cur)->id, since, LONG_MAX, 0,
+					    &n);
+		if (!samples)
+			continue;
+
+		/* only the most recent ones fit in the measures */
+		first = n > (*cur)->values_max_length
+			? n - (*cur)->values_max_length : 0;
+
+		ms = malloc((n - first) * sizeof(struct measure));
+		for (i = first; i < n; i++) {
+			ms[i - first].value = samples[i].value;
+			ms[i - first].time = samples[i].time;
+		}
+
+		psensor_merge_measures(*cur, ms, n - first);
+		count++;
+
+		free(ms);
+		free(samples);
+	}
+
+	log_debug("slog: history of %d sensors loaded", count);
+}
+
+void slog_load_history(const char *path,
+		       struct psensor **sensors,
+		       time_t since)
+{
+	struct slog_reader *r;
+
+	r = slog_history_open(path, since);
+	if (!r)
+		return;
+
+	slog_history_load(r, sensors, since);
+
+	slog_reader_close(r);
+}
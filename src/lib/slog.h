@@ -20,10 +20,92 @@
 #define PSENSOR_SLOG_H
 
 #include <pthread.h>
+#include <sys/types.h>
 
 #include "psensor.h"
+#include "slogfile.h"
+#include "slogfmt.h"
+#include "slogread.h"
 
 bool slog_activate(const char *, struct psensor **, pthread_mutex_t *, unsigned int s);
 void slog_close(void);
 
+/*
+ * Replaces the list of the logged sensors, e.g. when sensors are
+ * added, and starts a new section of the log. Must be called with
+ * the mutex given to slog_activate locked.
+ */
+void slog_set_sensors(struct psensor **);
+
+/*
+ * Format of the log opened by the next slog_activate, CSV by
+ * default. The default file is sensors.log for CSV and sensors.slog
+ * for the binary format.
+ */
+void slog_set_format(enum slog_format);
+
+enum slog_sync {
+	/* the system writes the log to the disk when it wants */
+	SLOG_SYNC_NONE,
+	/* fdatasync() after each write */
+	SLOG_SYNC_DATA,
+	/* fsync() after each write */
+	SLOG_SYNC_FULL
+};
+
+/* Returns false if 'str' is not "none", "data" or "full". */
+bool slog_sync_from_str(const char *str, enum slog_sync *policy);
+
+/*
+ * Sync policy of the next slog_activate. The writes are done by a
+ * dedicated thread, the sync only delays the log.
+ */
+void slog_set_sync(enum slog_sync policy);
+
+struct slog_rotation {
+	/* in bytes, 0 for no rotation on the size */
+	off_t max_size;
+	/* rotation when the day changes */
+	bool daily;
+	/* number of kept segments, 0 to keep all */
+	unsigned int keep;
+	/* compression of the segments, done in the background */
+	enum slog_compression compression;
+};
+
+/*
+ * Merges the values logged since 'since' into the measures of the
+ * sensors with the same id, e.g. to show the history of the previous
+ * run at startup. 'path' is the log as given to slog_activate, NULL
+ * for the default one of the format set by slog_set_format. Must be
+ * called with the sensors locked if they are already monitored.
+ *
+ * The sensors with a persistent ring are skipped, they already have
+ * their history.
+ */
+void slog_load_history(const char *path,
+		       struct psensor **sensors,
+		       time_t since);
+
+/*
+ * The two halves of slog_load_history, for callers which load the
+ * history of several lists of sensors: building the index of a large
+ * log takes seconds, it is better done once. slog_history_open
+ * returns NULL when there is no log, the reader is released with
+ * slog_reader_close. slog_history_load has the same requirements as
+ * slog_load_history; a reader must not be used by two threads at
+ * the same time.
+ */
+struct slog_reader *slog_history_open(const char *path, time_t since);
+
+void slog_history_load(struct slog_reader *r,
+		       struct psensor **sensors,
+		       time_t since);
+
+/*
+ * Rotation of the log opened by the next slog_activate, none by
+ * default. See slogfile.h for the names of the segments.
+ */
+void slog_set_rotation(const struct slog_rotation *r);
+
 #endif
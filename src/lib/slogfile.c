@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <ctype.h>
+#include <errno.h>
+#include <libgen.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <io.h>
+#include <plog.h>
+#include <slogfile.h>
+
+extern char **environ;
+
+bool slog_compression_from_str(const char *str, enum slog_compression *c)
+{
+	if (!strcmp(str, "none"))
+		*c = SLOG_COMPRESSION_NONE;
+	else if (!strcmp(str, "gzip"))
+		*c = SLOG_COMPRESSION_GZIP;
+	else if (!strcmp(str, "zstd"))
+		*c = SLOG_COMPRESSION_ZSTD;
+	else
+		return false;
+
+	return true;
+}
+
+/* Name of a segment: PATH.YYYYMMDD-HHMMSS[-N][.gz|.zst] */
+struct segment {
+	char *path;
+	/* YYYYMMDD-HHMMSS */
+	const char *stamp;
+	/* rank of the rotation in the second of the stamp */
+	unsigned long n;
+};
+
+static const size_t STAMP_LENGTH = 15;
+
+/*
+ * Orders by time, the names cannot be compared as strings: "-1"
+ * sorts before ".gz" and "-10" before "-2".
+ */
+static int cmp_segments(const void *a, const void *b)
+{
+	const struct segment *s1, *s2;
+	int ret;
+
+	s1 = a;
+	s2 = b;
+
+	ret = strncmp(s1->stamp, s2->stamp, STAMP_LENGTH);
+	if (ret)
+		return ret;
+
+	if (s1->n != s2->n)
+		return s1->n < s2->n ? -1 : 1;
+
+	return strcmp(s1->path, s2->path);
+}
+
+static void sort_segments(char **paths, size_t n, size_t base_len)
+{
+	struct segment *segments;
+	const char *name;
+	size_t i;
+
+	segments = malloc(n * sizeof(*segments));
+
+	for (i = 0; i < n; i++) {
+		name = strrchr(paths[i], '/');
+		name = name ? name + 1 : paths[i];
+
+		segments[i].path = paths[i];
+		segments[i].stamp = name + base_len + 1;
+		segments[i].n = 0;
+
+		if (strlen(segments[i].stamp) > STAMP_LENGTH
+		    && segments[i].stamp[STAMP_LENGTH] == '-')
+			segments[i].n = strtoul(segments[i].stamp
+						+ STAMP_LENGTH + 1,
+						NULL,
+						10);
+	}
+
+	qsort(segments, n, sizeof(*segments), cmp_segments);
+
+	for (i = 0; i < n; i++)
+		paths[i] = segments[i].path;
+
+	free(segments);
+}
+
+char **slog_segments_list(const char *path)
+{
+	char *tmp, *dir, *base, **entries, **cur, **segments, *name;
+	size_t len, n;
+
+	tmp = strdup(path);
+	dir = strdup(dirname(tmp));
+	free(tmp);
+
+	tmp = strdup(path);
+	base = strdup(basename(tmp));
+	free(tmp);
+
+	entries = dir_list(dir, NULL);
+
+	free(dir);
+
+	if (!entries) {
+		free(base);
+		return NULL;
+	}
+
+	len = strlen(base);
+	n = 0;
+	segments = entries;
+
+	for (cur = entries; *cur; cur++) {
+		name = strrchr(*cur, '/');
+		name = name ? name + 1 : *cur;
+
+		/* PATH.YYYYMMDD... */
+		if (!strncmp(name, base, len)
+		    && name[len] == '.'
+		    && isdigit(name[len + 1]))
+			segments[n++] = *cur;
+		else
+			free(*cur);
+	}
+	segments[n] = NULL;
+
+	free(base);
+
+	if (!n) {
+		free(segments);
+		return NULL;
+	}
+
+	sort_segments(segments, n, len);
+
+	return segments;
+}
+
+char *slog_index_path(const char *path)
+{
+	const char *name;
+	char *p;
+	int ret;
+
+	name = strrchr(path, '/');
+
+	/* hidden, it must not be taken for a segment */
+	if (name)
+		ret = asprintf(&p, "%.*s/.%s.idx",
+			       (int)(name - path), path, name + 1);
+	else
+		ret = asprintf(&p, ".%s.idx", path);
+
+	return ret == -1 ? NULL : p;
+}
+
+static void remove_index(const char *path)
+{
+	char *idx;
+
+	idx = slog_index_path(path);
+	if (idx) {
+		unlink(idx);
+		free(idx);
+	}
+}
+
+static const char *EXTENSIONS[] = { "", ".gz", ".zst" };
+
+static bool segment_exists(const char *segment)
+{
+	char *p;
+	bool ret;
+	int i;
+
+	ret = false;
+	for (i = 0; !ret && i < 3; i++) {
+		if (asprintf(&p, "%s%s", segment, EXTENSIONS[i]) == -1)
+			return true;
+
+		ret = !access(p, F_OK);
+		free(p);
+	}
+
+	return ret;
+}
+
+char *slog_segment_rotate(const char *path, time_t t)
+{
+	struct tm tm;
+	char stamp[32], *segment, *idx, *seg_idx;
+	int i, ret;
+
+	if (!localtime_r(&t, &tm)
+	    || !strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm))
+		return NULL;
+
+	/* several rotations in the same second */
+	for (i = 0; ; i++) {
+		if (i)
+			ret = asprintf(&segment, "%s.%s-%d", path, stamp, i);
+		else
+			ret = asprintf(&segment, "%s.%s", path, stamp);
+
+		if (ret == -1)
+			return NULL;
+
+		if (!segment_exists(segment))
+			break;
+
+		free(segment);
+	}
+
+	if (rename(path, segment)) {
+		log_err(_("Cannot rename %s: %s."), path, strerror(errno));
+		free(segment);
+		return NULL;
+	}
+
+	/* same file, its index stays valid */
+	idx = slog_index_path(path);
+	seg_idx = slog_index_path(segment);
+	if (idx && seg_idx)
+		rename(idx, seg_idx);
+	free(idx);
+	free(seg_idx);
+
+	return segment;
+}
+
+static void compress(const char *segment, enum slog_compression c)
+{
+	char *argv[6];
+	pid_t pid;
+	int status, ret;
+
+	if (c == SLOG_COMPRESSION_GZIP) {
+		argv[0] = "gzip";
+		argv[1] = "-q";
+		argv[2] = "-f";
+		argv[3] = (char *)segment;
+		argv[4] = NULL;
+	} else {
+		argv[0] = "zstd";
+		argv[1] = "-q";
+		argv[2] = "-f";
+		argv[3] = "--rm";
+		argv[4] = (char *)segment;
+		argv[5] = NULL;
+	}
+
+	ret = posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ);
+	if (ret) {
+		log_err(_("Cannot run %s: %s."), argv[0], strerror(ret));
+		return;
+	}
+
+	if (waitpid(pid, &status, 0) == -1
+	    || !WIFEXITED(status)
+	    || WEXITSTATUS(status))
+		log_err(_("Failed to compress %s."), segment);
+	else
+		log_debug("slog: %s compressed", segment);
+}
+
+void slog_segment_archive(const char *path,
+			  const char *segment,
+			  enum slog_compression c,
+			  unsigned int keep)
+{
+	char **segments, **cur;
+	size_t n;
+
+	if (c != SLOG_COMPRESSION_NONE) {
+		compress(segment, c);
+		remove_index(segment);
+	}
+
+	if (!keep)
+		return;
+
+	segments = slog_segments_list(path);
+	if (!segments)
+		return;
+
+	for (n = 0; segments[n]; n++)
+		;
+
+	for (cur = segments; n > keep; cur++, n--) {
+		log_info(_("Removing sensor log %s."), *cur);
+
+		if (unlink(*cur))
+			log_err(_("Cannot remove %s: %s."),
+				*cur,
+				strerror(errno));
+
+		remove_index(*cur);
+	}
+
+	paths_free(segments);
+}
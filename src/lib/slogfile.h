@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_SLOGFILE_H
+#define PSENSOR_SLOGFILE_H
+
+#include <time.h>
+
+#include <bool.h>
+
+/*
+ * Segments of a rotated sensor log.
+ *
+ * When the log PATH is rotated, it is renamed PATH.YYYYMMDD-HHMMSS
+ * (local time of the rotation), with the suffix -N for the N-th
+ * other rotation in the same second, and possibly compressed to
+ * PATH.YYYYMMDD-HHMMSS[-N].gz or .zst. Each segment starts with a
+ * header, it can be read on its own.
+ */
+
+enum slog_compression {
+	SLOG_COMPRESSION_NONE,
+	SLOG_COMPRESSION_GZIP,
+	SLOG_COMPRESSION_ZSTD
+};
+
+/* Returns false if 'str' is not "none", "gzip" or "zstd". */
+bool slog_compression_from_str(const char *str, enum slog_compression *c);
+
+/*
+ * Returns the null-terminated list of the rotated segments of the
+ * log 'path', oldest first, or NULL if there is none. To be freed
+ * with paths_free.
+ */
+char **slog_segments_list(const char *path);
+
+/*
+ * Returns the path of the index of the log or segment 'path', see
+ * slogread.h. To be freed.
+ */
+char *slog_index_path(const char *path);
+
+/*
+ * Renames the log 'path' to a new segment and returns the path of
+ * the segment, or NULL on failure.
+ */
+char *slog_segment_rotate(const char *path, time_t t);
+
+/*
+ * Compresses 'segment' with the gzip or zstd command, then removes
+ * the oldest segments of 'path' to keep at most 'keep' of them (0
+ * keeps all) and their index. Blocks until done.
+ */
+void slog_segment_archive(const char *path,
+			  const char *segment,
+			  enum slog_compression c,
+			  unsigned int keep);
+
+#endif
@@ -0,0 +1,695 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <measure.h>
+#include <slogfmt.h>
+
+static const unsigned char MAGIC[] = { 0x89, 'P', 'S', 'L' };
+static const unsigned char BINARY_VERSION = 1;
+static const unsigned char RECORD_TAG = 'R';
+
+/* beyond, thousandths of the values are not exact doubles */
+static const double MAX_MILLI_VALUE = 1e12;
+
+static const size_t CONVERT_BUFFER_SIZE = 1 << 16;
+
+enum read_status {
+	READ_OK,
+	READ_TRUNCATED,
+	READ_INVALID
+};
+
+bool slog_format_from_str(const char *str, enum slog_format *format)
+{
+	if (!strcmp(str, "csv"))
+		*format = SLOG_FORMAT_CSV;
+	else if (!strcmp(str, "binary"))
+		*format = SLOG_FORMAT_BINARY;
+	else
+		return false;
+
+	return true;
+}
+
+const char *slog_format_to_str(enum slog_format format)
+{
+	return format == SLOG_FORMAT_BINARY ? "binary" : "csv";
+}
+
+void slog_header_free(struct slog_header *h)
+{
+	size_t i;
+
+	for (i = 0; i < h->n; i++)
+		free(h->ids[i]);
+	free(h->ids);
+	free(h->types);
+	free(h->version);
+
+	memset(h, 0, sizeof(*h));
+}
+
+static uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* Returns whether 'v' is exactly a whole number of thousandths. */
+static bool to_milli(double v, int64_t *m)
+{
+	double r;
+
+	if (!(fabs(v) < MAX_MILLI_VALUE))
+		return false;
+
+	r = round(v * 1000);
+	if (r / 1000 != v)
+		return false;
+
+	*m = (int64_t)r;
+
+	return true;
+}
+
+/* Reference of the delta of the next value of a sensor. */
+static int64_t milli_base(double v)
+{
+	int64_t m;
+
+	return to_milli(v, &m) ? m : 0;
+}
+
+static int64_t timeval_to_ms(const struct timeval *t)
+{
+	return (int64_t)t->tv_sec * 1000 + t->tv_usec / 1000;
+}
+
+static void put_varint(struct pbuf *b, uint64_t v)
+{
+	while (v >= 0x80) {
+		pbuf_append_char(b, (char)(v | 0x80));
+		v >>= 7;
+	}
+	pbuf_append_char(b, (char)v);
+}
+
+static void put_str(struct pbuf *b, const char *s)
+{
+	size_t n;
+
+	n = strlen(s);
+	put_varint(b, n);
+	pbuf_append(b, s, n);
+}
+
+static void put_double(struct pbuf *b, double v)
+{
+	unsigned char bytes[8];
+	uint64_t u;
+	int i;
+
+	memcpy(&u, &v, sizeof(u));
+	for (i = 0; i < 8; i++) {
+		bytes[i] = u & 0xff;
+		u >>= 8;
+	}
+
+	pbuf_append(b, (char *)bytes, 8);
+}
+
+void slog_encoder_init(struct slog_encoder *e, enum slog_format format)
+{
+	memset(e, 0, sizeof(*e));
+	e->format = format;
+}
+
+void slog_encoder_free(struct slog_encoder *e)
+{
+	free(e->last);
+	e->last = NULL;
+}
+
+void slog_encode_header(struct slog_encoder *e,
+			struct pbuf *b,
+			const struct slog_header *h)
+{
+	size_t i;
+
+	free(e->last);
+	e->last = NULL;
+	e->n = h->n;
+	e->start = h->start;
+	e->last_ms = (int64_t)h->start * 1000;
+
+	if (e->format == SLOG_FORMAT_CSV) {
+		pbuf_printf(b, "I,%ld,%s\n", (long)h->start, h->version);
+
+		for (i = 0; i < h->n; i++)
+			pbuf_printf(b, "S,%s,%x\n", h->ids[i], h->types[i]);
+
+		return;
+	}
+
+	pbuf_append(b, (const char *)MAGIC, sizeof(MAGIC));
+	pbuf_append_char(b, BINARY_VERSION);
+	put_varint(b, (uint64_t)h->start);
+	put_str(b, h->version);
+	put_varint(b, h->n);
+
+	for (i = 0; i < h->n; i++) {
+		put_varint(b, h->types[i]);
+		put_str(b, h->ids[i]);
+	}
+}
+
+static bool is_changed(const struct slog_encoder *e, size_t i, double v)
+{
+	return !e->last || memcmp(&e->last[i], &v, sizeof(v));
+}
+
+static void encode_csv_record(struct slog_encoder *e,
+			      struct pbuf *b,
+			      const struct timeval *t,
+			      const double *values)
+{
+	size_t i;
+
+	pbuf_printf(b, "%ld", (long)(t->tv_sec - e->start));
+
+	for (i = 0; i < e->n; i++)
+		if (is_changed(e, i, values[i]))
+			pbuf_printf(b, ",%.1f", values[i]);
+		else
+			pbuf_append_char(b, ',');
+
+	pbuf_append_char(b, '\n');
+}
+
+static void encode_binary_record(struct slog_encoder *e,
+				 struct pbuf *b,
+				 const struct timeval *t,
+				 const double *values)
+{
+	size_t i, bitmap, nbytes;
+	int64_t ms, m;
+	double v;
+
+	ms = timeval_to_ms(t);
+
+	pbuf_append_char(b, RECORD_TAG);
+	put_varint(b, zigzag(ms - e->last_ms));
+	e->last_ms = ms;
+
+	nbytes = (e->n + 7) / 8;
+	if (!pbuf_reserve(b, nbytes))
+		return;
+
+	bitmap = b->len;
+	memset(b->data + bitmap, 0, nbytes);
+	b->len += nbytes;
+
+	for (i = 0; i < e->n; i++) {
+		v = values[i];
+
+		if (!is_changed(e, i, v))
+			continue;
+
+		b->data[bitmap + i / 8] |= 1 << (i % 8);
+
+		if (to_milli(v, &m)) {
+			m -= e->last ? milli_base(e->last[i]) : 0;
+			put_varint(b, zigzag(m) << 1);
+		} else {
+			put_varint(b, 1);
+			put_double(b, v);
+		}
+	}
+}
+
+void slog_encode_record(struct slog_encoder *e,
+			struct pbuf *b,
+			const struct timeval *t,
+			const double *values)
+{
+	if (e->format == SLOG_FORMAT_CSV)
+		encode_csv_record(e, b, t, values);
+	else
+		encode_binary_record(e, b, t, values);
+
+	if (!e->last)
+		e->last = malloc(e->n * sizeof(double));
+
+	memcpy(e->last, values, e->n * sizeof(double));
+}
+
+void slog_decoder_init(struct slog_decoder *d, const void *data, size_t len)
+{
+	memset(d, 0, sizeof(*d));
+
+	d->data = data;
+	d->len = len;
+
+	if (len && d->data[0] == MAGIC[0])
+		d->format = SLOG_FORMAT_BINARY;
+	else
+		d->format = SLOG_FORMAT_CSV;
+}
+
+void slog_decoder_free(struct slog_decoder *d)
+{
+	slog_header_free(&d->header);
+	free(d->values);
+	free(d->next);
+	d->values = NULL;
+	d->next = NULL;
+}
+
+/* Allocates the values of a new section, all unknown. */
+static void start_section(struct slog_decoder *d)
+{
+	size_t i;
+
+	free(d->values);
+	free(d->next);
+	d->values = malloc(d->header.n * sizeof(double));
+	d->next = malloc(d->header.n * sizeof(double));
+	for (i = 0; i < d->header.n; i++)
+		d->values[i] = UNKNOWN_DOUBLE_VALUE;
+
+	d->last_ms = (int64_t)d->header.start * 1000;
+}
+
+static enum read_status get_varint(const struct slog_decoder *d,
+				   size_t *pos,
+				   uint64_t *v)
+{
+	unsigned int shift;
+	unsigned char c;
+
+	*v = 0;
+	for (shift = 0; shift < 64; shift += 7) {
+		if (*pos >= d->len)
+			return READ_TRUNCATED;
+
+		c = d->data[(*pos)++];
+		*v |= (uint64_t)(c & 0x7f) << shift;
+
+		if (!(c & 0x80))
+			return READ_OK;
+	}
+
+	return READ_INVALID;
+}
+
+static enum read_status get_str(const struct slog_decoder *d,
+				size_t *pos,
+				char **s)
+{
+	enum read_status ret;
+	uint64_t n;
+
+	ret = get_varint(d, pos, &n);
+	if (ret != READ_OK)
+		return ret;
+
+	if (n > d->len - *pos)
+		return READ_TRUNCATED;
+
+	*s = strndup((const char *)d->data + *pos, n);
+	*pos += n;
+
+	return READ_OK;
+}
+
+static enum read_status get_double(const struct slog_decoder *d,
+				   size_t *pos,
+				   double *v)
+{
+	uint64_t u;
+	int i;
+
+	if (d->len - *pos < 8)
+		return READ_TRUNCATED;
+
+	u = 0;
+	for (i = 7; i >= 0; i--)
+		u = (u << 8) | d->data[*pos + i];
+	*pos += 8;
+
+	memcpy(v, &u, sizeof(u));
+
+	return READ_OK;
+}
+
+static enum slog_entry to_entry(enum read_status s)
+{
+	/* an entry being written ends the log */
+	return s == READ_TRUNCATED ? SLOG_ENTRY_END : SLOG_ENTRY_ERROR;
+}
+
+static enum slog_entry decode_binary_header(struct slog_decoder *d)
+{
+	struct slog_header h;
+	enum read_status ret;
+	uint64_t v, n;
+	size_t pos, i;
+
+	pos = d->pos;
+
+	if (d->len - pos < sizeof(MAGIC) + 1)
+		return SLOG_ENTRY_END;
+
+	if (memcmp(d->data + pos, MAGIC, sizeof(MAGIC))
+	    || d->data[pos + sizeof(MAGIC)] != BINARY_VERSION)
+		return SLOG_ENTRY_ERROR;
+
+	pos += sizeof(MAGIC) + 1;
+
+	memset(&h, 0, sizeof(h));
+
+	ret = get_varint(d, &pos, &v);
+	if (ret != READ_OK)
+		return to_entry(ret);
+	h.start = v;
+
+	ret = get_str(d, &pos, &h.version);
+	if (ret == READ_OK)
+		ret = get_varint(d, &pos, &n);
+	if (ret != READ_OK) {
+		slog_header_free(&h);
+		return to_entry(ret);
+	}
+
+	/* each sensor takes at least 2 bytes */
+	if (n > (d->len - pos) / 2) {
+		slog_header_free(&h);
+		return SLOG_ENTRY_END;
+	}
+
+	h.ids = calloc(n, sizeof(char *));
+	h.types = calloc(n, sizeof(unsigned int));
+
+	for (i = 0; i < n; i++) {
+		h.n = i;
+
+		ret = get_varint(d, &pos, &v);
+		if (ret == READ_OK) {
+			h.types[i] = v;
+			ret = get_str(d, &pos, &h.ids[i]);
+		}
+
+		if (ret != READ_OK) {
+			slog_header_free(&h);
+			return to_entry(ret);
+		}
+	}
+	h.n = i;
+
+	slog_header_free(&d->header);
+	d->header = h;
+	d->pos = pos;
+
+	start_section(d);
+
+	return SLOG_ENTRY_HEADER;
+}
+
+static enum slog_entry decode_binary_record(struct slog_decoder *d)
+{
+	enum read_status ret;
+	const unsigned char *bitmap;
+	size_t pos, i, nbytes;
+	uint64_t v;
+	int64_t ms;
+	double *values;
+
+	if (!d->values)
+		return SLOG_ENTRY_ERROR;
+
+	pos = d->pos + 1;
+
+	ret = get_varint(d, &pos, &v);
+	if (ret != READ_OK)
+		return to_entry(ret);
+	ms = d->last_ms + unzigzag(v);
+
+	nbytes = (d->header.n + 7) / 8;
+	if (d->len - pos < nbytes)
+		return SLOG_ENTRY_END;
+
+	bitmap = d->data + pos;
+	pos += nbytes;
+
+	/* the values are applied only once the record is complete */
+	values = d->next;
+	memcpy(values, d->values, d->header.n * sizeof(double));
+
+	for (i = 0; i < d->header.n; i++) {
+		if (!(bitmap[i / 8] & (1 << (i % 8))))
+			continue;
+
+		ret = get_varint(d, &pos, &v);
+		if (ret == READ_OK) {
+			if (v == 1)
+				ret = get_double(d, &pos, &values[i]);
+			else if (v & 1)
+				ret = READ_INVALID;
+			else
+				values[i] = (double)(milli_base(values[i])
+						     + unzigzag(v >> 1)) / 1000;
+		}
+
+		if (ret != READ_OK)
+			return to_entry(ret);
+	}
+
+	d->next = d->values;
+	d->values = values;
+
+	d->last_ms = ms;
+	d->time.tv_sec = ms / 1000;
+	d->time.tv_usec = (ms % 1000) * 1000;
+	d->pos = pos;
+
+	return SLOG_ENTRY_RECORD;
+}
+
+static enum slog_entry decode_binary(struct slog_decoder *d)
+{
+	if (d->pos >= d->len)
+		return SLOG_ENTRY_END;
+
+	if (d->data[d->pos] == MAGIC[0])
+		return decode_binary_header(d);
+
+	if (d->data[d->pos] == RECORD_TAG)
+		return decode_binary_record(d);
+
+	return SLOG_ENTRY_ERROR;
+}
+
+/*
+ * Returns the length of the line at 'pos' without its '\n', or -1
+ * if the line is not complete.
+ */
+static ssize_t line_len(const struct slog_decoder *d, size_t pos)
+{
+	const unsigned char *nl;
+
+	nl = memchr(d->data + pos, '\n', d->len - pos);
+	if (!nl)
+		return -1;
+
+	return nl - (d->data + pos);
+}
+
+static enum slog_entry decode_csv_header(struct slog_decoder *d)
+{
+	struct slog_header h;
+	const char *line, *comma;
+	char *end;
+	ssize_t len;
+	size_t pos;
+
+	memset(&h, 0, sizeof(h));
+
+	pos = d->pos;
+	line = (const char *)d->data + pos;
+	len = line_len(d, pos);
+
+	/* I,start,version */
+	h.start = strtol(line + 2, &end, 10);
+	if (end == line + 2 || *end != ',')
+		return SLOG_ENTRY_ERROR;
+	h.version = strndup(end + 1, line + len - end - 1);
+
+	pos += len + 1;
+
+	/* S,id,type */
+	while (pos < d->len && d->data[pos] == 'S') {
+		line = (const char *)d->data + pos;
+		len = line_len(d, pos);
+		if (len == -1)
+			break;
+
+		comma = memrchr(line, ',', len);
+		if (len < 2 || line[1] != ',' || comma == line + 1) {
+			slog_header_free(&h);
+			return SLOG_ENTRY_ERROR;
+		}
+
+		h.ids = realloc(h.ids, (h.n + 1) * sizeof(char *));
+		h.types = realloc(h.types, (h.n + 1) * sizeof(unsigned int));
+
+		h.ids[h.n] = strndup(line + 2, comma - line - 2);
+		h.types[h.n] = strtoul(comma + 1, NULL, 16);
+		h.n++;
+
+		pos += len + 1;
+	}
+
+	slog_header_free(&d->header);
+	d->header = h;
+	d->pos = pos;
+
+	start_section(d);
+
+	return SLOG_ENTRY_HEADER;
+}
+
+static enum slog_entry decode_csv_record(struct slog_decoder *d, ssize_t len)
+{
+	const char *c, *eol;
+	char *end;
+	long t;
+	size_t i;
+	double v;
+
+	if (!d->values)
+		return SLOG_ENTRY_ERROR;
+
+	c = (const char *)d->data + d->pos;
+	eol = c + len;
+
+	t = strtol(c, &end, 10);
+	if (end == c || (*end != ',' && end != eol))
+		return SLOG_ENTRY_ERROR;
+	c = end;
+
+	for (i = 0; i < d->header.n && c < eol; i++) {
+		/* skips the ',' */
+		c++;
+
+		if (c == eol || *c == ',')
+			continue;
+
+		v = strtod(c, &end);
+		if (end == c || (*end != ',' && end != eol))
+			return SLOG_ENTRY_ERROR;
+
+		d->values[i] = v;
+		c = end;
+	}
+
+	d->time.tv_sec = d->header.start + t;
+	d->time.tv_usec = 0;
+	d->pos += len + 1;
+
+	return SLOG_ENTRY_RECORD;
+}
+
+static enum slog_entry decode_csv(struct slog_decoder *d)
+{
+	ssize_t len;
+
+	if (d->pos >= d->len)
+		return SLOG_ENTRY_END;
+
+	len = line_len(d, d->pos);
+	if (len == -1)
+		return SLOG_ENTRY_END;
+
+	if (len >= 2 && !memcmp(d->data + d->pos, "I,", 2))
+		return decode_csv_header(d);
+
+	return decode_csv_record(d, len);
+}
+
+enum slog_entry slog_decoder_next(struct slog_decoder *d)
+{
+	if (d->format == SLOG_FORMAT_BINARY)
+		return decode_binary(d);
+	else
+		return decode_csv(d);
+}
+
+static bool flush(struct pbuf *b, FILE *f)
+{
+	bool ret;
+
+	ret = !b->err && fwrite(b->data, 1, b->len, f) == b->len;
+
+	pbuf_reset(b);
+
+	return ret;
+}
+
+bool slog_convert(struct slog_decoder *d, enum slog_format format, FILE *f)
+{
+	struct slog_encoder e;
+	struct pbuf b;
+	enum slog_entry entry;
+	bool ret;
+
+	slog_encoder_init(&e, format);
+	pbuf_init(&b, CONVERT_BUFFER_SIZE);
+
+	ret = true;
+	while (ret) {
+		entry = slog_decoder_next(d);
+
+		if (entry == SLOG_ENTRY_HEADER)
+			slog_encode_header(&e, &b, &d->header);
+		else if (entry == SLOG_ENTRY_RECORD)
+			slog_encode_record(&e, &b, &d->time, d->values);
+		else
+			break;
+
+		if (b.len >= CONVERT_BUFFER_SIZE)
+			ret = flush(&b, f);
+	}
+
+	if (ret)
+		ret = flush(&b, f) && entry == SLOG_ENTRY_END;
+
+	pbuf_free(&b);
+	slog_encoder_free(&e);
+
+	return ret;
+}
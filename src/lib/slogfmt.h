@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_SLOGFMT_H
+#define PSENSOR_SLOGFMT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <bool.h>
+#include <pbuf.h>
+
+/*
+ * Encoding and decoding of the sensor log.
+ *
+ * A log is a sequence of sections: a header giving the ordered list
+ * of the logged sensors followed by the records of their values.
+ *
+ * CSV: the historical text format, see description.txt of
+ * psensor-server.
+ *
+ * Binary:
+ *  header: 0x89 'P' 'S' 'L', format version (1 byte), start time,
+ *	    psensor version, number of sensors and for each sensor its
+ *	    type and its id.
+ *  record: 'R', time elapsed since the previous record (or the start
+ *	    of the section) in milliseconds (signed), a bitmap of the
+ *	    changed values (1 bit per sensor, lowest bit first) and the
+ *	    changed values.
+ *
+ * Integers are LEB128 varints, signed ones are zigzag encoded, and
+ * strings are prefixed by their length. A value is the varint
+ * 'zigzag(delta) << 1' where delta is the difference, in thousandths,
+ * from the previous value of the sensor, or the varint 1 followed by
+ * the 8 bytes of the double (little endian) when the value is not a
+ * whole number of thousandths. Values are therefore not rounded.
+ */
+
+enum slog_format {
+	SLOG_FORMAT_CSV,
+	SLOG_FORMAT_BINARY
+};
+
+/* Returns false if 'str' is not "csv" or "binary". */
+bool slog_format_from_str(const char *str, enum slog_format *format);
+const char *slog_format_to_str(enum slog_format format);
+
+struct slog_header {
+	time_t start;
+	char *version;
+	size_t n;
+	char **ids;
+	unsigned int *types;
+};
+
+/* Frees the content of 'h'. */
+void slog_header_free(struct slog_header *h);
+
+struct slog_encoder {
+	enum slog_format format;
+	size_t n;
+	time_t start;
+	/* time of the previous record, in milliseconds */
+	int64_t last_ms;
+	/* values of the previous record, NULL before the first one */
+	double *last;
+};
+
+void slog_encoder_init(struct slog_encoder *e, enum slog_format format);
+void slog_encoder_free(struct slog_encoder *e);
+
+/* Appends the header of a new section to 'b'. */
+void slog_encode_header(struct slog_encoder *e,
+			struct pbuf *b,
+			const struct slog_header *h);
+
+/* Appends a record of the 'n' values of the section to 'b'. */
+void slog_encode_record(struct slog_encoder *e,
+			struct pbuf *b,
+			const struct timeval *t,
+			const double *values);
+
+enum slog_entry {
+	SLOG_ENTRY_END,
+	SLOG_ENTRY_HEADER,
+	SLOG_ENTRY_RECORD,
+	/* invalid or truncated content, the decoding cannot continue */
+	SLOG_ENTRY_ERROR
+};
+
+struct slog_decoder {
+	enum slog_format format;
+	const unsigned char *data;
+	size_t len;
+	/* offset of the next entry */
+	size_t pos;
+
+	/* header of the current section */
+	struct slog_header header;
+	/* values and time of the current record */
+	double *values;
+	struct timeval time;
+
+	/* time of the current record, in milliseconds */
+	int64_t last_ms;
+	/* values of the record being decoded */
+	double *next;
+};
+
+/*
+ * Decodes the log in memory 'data' (e.g. a mapped file), its format
+ * is detected from the first byte. 'data' must stay valid until the
+ * decoder is freed.
+ */
+void slog_decoder_init(struct slog_decoder *d, const void *data, size_t len);
+void slog_decoder_free(struct slog_decoder *d);
+
+/*
+ * Decodes the next entry. After SLOG_ENTRY_HEADER 'header' describes
+ * the new section, after SLOG_ENTRY_RECORD 'time' and 'values' are
+ * the ones of the record, unchanged values included.
+ */
+enum slog_entry slog_decoder_next(struct slog_decoder *d);
+
+/*
+ * Writes the remaining entries of 'd' to 'f' in the given format.
+ * Returns false if the content is invalid or cannot be written.
+ */
+bool slog_convert(struct slog_decoder *d, enum slog_format format, FILE *f);
+
+#endif
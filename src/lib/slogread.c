@@ -0,0 +1,653 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <io.h>
+#include <measure.h>
+#include <plog.h>
+#include <slogfile.h>
+#include <slogfmt.h>
+#include <slogread.h>
+
+static const char INDEX_MAGIC[] = { 'P', 'S', 'L', 'I' };
+static const uint32_t INDEX_VERSION = 1;
+
+/*
+ * An index is a local cache of the reader, it is written in the
+ * native byte order: this header followed by the entries (their
+ * fields up to 'values' then the 'n' values).
+ */
+struct index_header {
+	char magic[4];
+	uint32_t version;
+	/* identity of the indexed segment */
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t end;
+	int64_t first_ms;
+	int64_t last_ms;
+	uint64_t count;
+};
+
+#define ENTRY_FIELDS_SIZE offsetof(struct slog_index_entry, values)
+
+struct query {
+	const char *id;
+	/* range and period of the query, in ms */
+	int64_t t1;
+	int64_t t2;
+	int64_t step;
+
+	struct slog_sample *samples;
+	size_t n;
+	size_t size;
+
+	/* values of the current period */
+	int64_t period;
+	size_t count;
+	double sum;
+	double min;
+	double max;
+};
+
+static int64_t timeval_to_ms(const struct timeval *t)
+{
+	return (int64_t)t->tv_sec * 1000 + t->tv_usec / 1000;
+}
+
+/* Converts the time of a query, the log has no record before 1970. */
+static int64_t time_to_ms(time_t t)
+{
+	if (t < 0)
+		return 0;
+
+	if (t >= INT64_MAX / 1000)
+		return (INT64_MAX / 1000 - 1) * 1000;
+
+	return (int64_t)t * 1000;
+}
+
+static void index_free(struct slog_segment *s)
+{
+	size_t i;
+
+	for (i = 0; i < s->index_n; i++)
+		free(s->index[i].values);
+	free(s->index);
+
+	s->index = NULL;
+	s->index_n = 0;
+	s->end = 0;
+	s->first_ms = INT64_MAX;
+	s->last_ms = INT64_MIN;
+}
+
+static void index_add(struct slog_segment *s,
+		      const struct slog_decoder *d,
+		      uint64_t header_pos,
+		      int64_t ms)
+{
+	struct slog_index_entry *e;
+
+	s->index = realloc(s->index, (s->index_n + 1) * sizeof(*e));
+
+	e = &s->index[s->index_n++];
+	e->pos = d->pos;
+	e->header_pos = header_pos;
+	e->ms = ms;
+	e->n = d->header.n;
+	e->values = malloc(e->n * sizeof(double));
+	if (e->n)
+		memcpy(e->values, d->values, e->n * sizeof(double));
+}
+
+/* Restores the state of the decoder saved in 'e'. */
+static bool restore(struct slog_decoder *d, const struct slog_index_entry *e)
+{
+	d->pos = e->header_pos;
+
+	if (e->pos > d->len
+	    || slog_decoder_next(d) != SLOG_ENTRY_HEADER
+	    || d->header.n != e->n)
+		return false;
+
+	if (e->n)
+		memcpy(d->values, e->values, e->n * sizeof(double));
+
+	d->last_ms = e->ms;
+	d->time.tv_sec = e->ms / 1000;
+	d->time.tv_usec = (e->ms % 1000) * 1000;
+	d->pos = e->pos;
+
+	return true;
+}
+
+/* Decodes the entries of the segment which are not yet indexed. */
+static void index_build(struct slog_segment *s)
+{
+	struct slog_decoder d;
+	struct slog_index_entry *last;
+	enum slog_entry entry;
+	uint64_t header_pos, entry_pos, last_pos;
+	int64_t ms;
+
+	slog_decoder_init(&d, s->data, s->len);
+	header_pos = 0;
+
+	if (s->index_n) {
+		last = &s->index[s->index_n - 1];
+
+		if (restore(&d, last)) {
+			header_pos = last->header_pos;
+		} else {
+			log_debug("slog: invalid index of %s", s->path);
+
+			index_free(s);
+			slog_decoder_free(&d);
+			slog_decoder_init(&d, s->data, s->len);
+		}
+	}
+
+	last_pos = d.pos;
+
+	for (;;) {
+		entry_pos = d.pos;
+		entry = slog_decoder_next(&d);
+
+		if (entry == SLOG_ENTRY_HEADER) {
+			header_pos = entry_pos;
+			index_add(s, &d, header_pos,
+				  (int64_t)d.header.start * 1000);
+			last_pos = d.pos;
+		} else if (entry == SLOG_ENTRY_RECORD) {
+			ms = timeval_to_ms(&d.time);
+
+			if (ms < s->first_ms)
+				s->first_ms = ms;
+			if (ms > s->last_ms)
+				s->last_ms = ms;
+
+			if (d.pos - last_pos >= SLOG_INDEX_STEP) {
+				index_add(s, &d, header_pos, ms);
+				last_pos = d.pos;
+			}
+		} else {
+			if (entry == SLOG_ENTRY_ERROR)
+				log_warn(_("Invalid sensor log %s at offset "
+					   "%zu."),
+					 s->path,
+					 d.pos);
+			break;
+		}
+	}
+
+	s->end = d.pos;
+
+	slog_decoder_free(&d);
+}
+
+static bool index_load(struct slog_segment *s, const struct stat *st)
+{
+	struct index_header h;
+	struct slog_index_entry *e;
+	char *path;
+	FILE *f;
+	uint64_t i;
+	bool ok;
+
+	path = slog_index_path(s->path);
+	f = path ? fopen(path, "r") : NULL;
+	free(path);
+
+	if (!f)
+		return false;
+
+	/* an entry takes at least one byte of the segment */
+	ok = fread(&h, sizeof(h), 1, f) == 1
+		&& !memcmp(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC))
+		&& h.version == INDEX_VERSION
+		&& h.dev == (uint64_t)st->st_dev
+		&& h.ino == (uint64_t)st->st_ino
+		&& h.end <= s->len
+		&& h.count <= h.end;
+
+	if (ok) {
+		s->index = calloc(h.count, sizeof(*e));
+		s->index_n = h.count;
+	}
+
+	for (i = 0; ok && i < h.count; i++) {
+		e = &s->index[i];
+
+		ok = fread(e, ENTRY_FIELDS_SIZE, 1, f) == 1
+			&& e->pos <= h.end
+			&& e->header_pos < e->pos
+			&& e->n <= e->pos;
+
+		if (ok) {
+			e->values = malloc(e->n * sizeof(double));
+			ok = fread(e->values, sizeof(double), e->n, f) == e->n;
+		} else {
+			e->values = NULL;
+		}
+	}
+
+	fclose(f);
+
+	if (!ok) {
+		index_free(s);
+		return false;
+	}
+
+	s->end = h.end;
+	s->first_ms = h.first_ms;
+	s->last_ms = h.last_ms;
+
+	return true;
+}
+
+static void index_save(const struct slog_segment *s, const struct stat *st)
+{
+	struct index_header h;
+	const struct slog_index_entry *e;
+	char *path, *tmp;
+	FILE *f;
+	size_t i;
+	bool ok;
+
+	path = slog_index_path(s->path);
+	if (!path)
+		return;
+
+	if (asprintf(&tmp, "%s.%d", path, getpid()) == -1) {
+		free(path);
+		return;
+	}
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	h.version = INDEX_VERSION;
+	h.dev = st->st_dev;
+	h.ino = st->st_ino;
+	h.end = s->end;
+	h.first_ms = s->first_ms;
+	h.last_ms = s->last_ms;
+	h.count = s->index_n;
+
+	/* the directory of the log may be read-only */
+	f = fopen(tmp, "w");
+	if (f) {
+		ok = fwrite(&h, sizeof(h), 1, f) == 1;
+
+		for (i = 0; ok && i < s->index_n; i++) {
+			e = &s->index[i];
+			ok = fwrite(e, ENTRY_FIELDS_SIZE, 1, f) == 1
+				&& fwrite(e->values,
+					  sizeof(double),
+					  e->n,
+					  f) == e->n;
+		}
+
+		if (fclose(f))
+			ok = false;
+
+		if (ok && !rename(tmp, path))
+			log_debug("slog: %s saved", path);
+		else
+			unlink(tmp);
+	} else {
+		log_debug("slog: cannot save %s: %s", path, strerror(errno));
+	}
+
+	free(tmp);
+	free(path);
+}
+
+static bool segment_open(struct slog_segment *s, const char *path)
+{
+	struct stat st;
+	uint64_t end;
+	size_t n;
+	void *data;
+	int fd;
+
+	memset(s, 0, sizeof(*s));
+	s->first_ms = INT64_MAX;
+	s->last_ms = INT64_MIN;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		if (errno != ENOENT)
+			log_err(_("Cannot open %s: %s."),
+				path,
+				strerror(errno));
+		return false;
+	}
+
+	if (fstat(fd, &st)) {
+		close(fd);
+		return false;
+	}
+
+	s->len = st.st_size;
+
+	if (s->len) {
+		data = mmap(NULL, s->len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data == MAP_FAILED) {
+			log_err(_("Cannot map %s: %s."), path, strerror(errno));
+			close(fd);
+			return false;
+		}
+
+		s->data = data;
+	}
+
+	close(fd);
+
+	s->path = strdup(path);
+
+	index_load(s, &st);
+
+	end = s->end;
+	n = s->index_n;
+
+	index_build(s);
+
+	if (s->end != end || s->index_n != n)
+		index_save(s, &st);
+
+	return true;
+}
+
+static void segment_close(struct slog_segment *s)
+{
+	index_free(s);
+
+	if (s->data)
+		munmap((void *)s->data, s->len);
+
+	free(s->path);
+}
+
+static bool is_compressed(const char *path)
+{
+	const char *ext;
+
+	ext = strrchr(path, '.');
+
+	return ext && (!strcmp(ext, ".gz") || !strcmp(ext, ".zst"));
+}
+
+static void reader_add(struct slog_reader *r, const char *path)
+{
+	if (is_compressed(path)) {
+		log_warn(_("%s is compressed, it is ignored."), path);
+		return;
+	}
+
+	if (segment_open(&r->segments[r->n], path))
+		r->n++;
+}
+
+static int cmp_segments(const void *a, const void *b)
+{
+	const struct slog_segment *s1, *s2;
+
+	s1 = a;
+	s2 = b;
+
+	if (s1->first_ms < s2->first_ms)
+		return -1;
+	if (s1->first_ms > s2->first_ms)
+		return 1;
+	return 0;
+}
+
+struct slog_reader *slog_reader_open(const char *path, time_t since)
+{
+	struct slog_reader *r;
+	char **segments;
+	size_t n, i;
+	int64_t since_ms;
+
+	since_ms = time_to_ms(since);
+	segments = slog_segments_list(path);
+
+	n = 0;
+	while (segments && segments[n])
+		n++;
+
+	r = malloc(sizeof(*r));
+	r->segments = malloc((n + 1) * sizeof(struct slog_segment));
+	r->n = 0;
+
+	reader_add(r, path);
+
+	/* from the most recent, until one starts before 'since' */
+	for (i = n; i > 0; i--) {
+		if (r->n && r->segments[r->n - 1].first_ms <= since_ms)
+			break;
+
+		reader_add(r, segments[i - 1]);
+	}
+
+	if (segments)
+		paths_free(segments);
+
+	if (!r->n) {
+		slog_reader_close(r);
+		return NULL;
+	}
+
+	/* segments without record are the last ones */
+	qsort(r->segments, r->n, sizeof(struct slog_segment), cmp_segments);
+
+	return r;
+}
+
+void slog_reader_close(struct slog_reader *r)
+{
+	size_t i;
+
+	for (i = 0; i < r->n; i++)
+		segment_close(&r->segments[i]);
+
+	free(r->segments);
+	free(r);
+}
+
+static void add_sample(struct query *q,
+		       int64_t ms,
+		       double v,
+		       double min,
+		       double max)
+{
+	struct slog_sample *s;
+
+	if (q->n == q->size) {
+		q->size = q->size ? 2 * q->size : 64;
+		q->samples = realloc(q->samples, q->size * sizeof(*s));
+	}
+
+	s = &q->samples[q->n++];
+	s->time.tv_sec = ms / 1000;
+	s->time.tv_usec = (ms % 1000) * 1000;
+	s->value = v;
+	s->min = min;
+	s->max = max;
+}
+
+static void flush_period(struct query *q)
+{
+	if (q->count)
+		add_sample(q,
+			   q->t1 + q->period * q->step,
+			   q->sum / q->count,
+			   q->min,
+			   q->max);
+
+	q->count = 0;
+}
+
+static void add_value(struct query *q, int64_t ms, double v)
+{
+	int64_t period;
+
+	if (!q->step) {
+		add_sample(q, ms, v, v, v);
+		return;
+	}
+
+	period = (ms - q->t1) / q->step;
+
+	if (q->count && period != q->period)
+		flush_period(q);
+
+	if (!q->count) {
+		q->period = period;
+		q->sum = 0;
+		q->min = v;
+		q->max = v;
+	}
+
+	q->sum += v;
+	if (v < q->min)
+		q->min = v;
+	if (v > q->max)
+		q->max = v;
+	q->count++;
+}
+
+static ssize_t find_column(const struct slog_header *h, const char *id)
+{
+	size_t i;
+
+	for (i = 0; i < h->n; i++)
+		if (!strcmp(h->ids[i], id))
+			return i;
+
+	return -1;
+}
+
+/* Returns the last entry of the index before 'ms', or -1. */
+static ssize_t index_lookup(const struct slog_segment *s, int64_t ms)
+{
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = s->index_n;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (s->index[mid].ms < ms)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (ssize_t)lo - 1;
+}
+
+static void query_segment(struct query *q, const struct slog_segment *s)
+{
+	struct slog_decoder d;
+	enum slog_entry entry;
+	ssize_t i, col;
+	int64_t ms;
+
+	if (s->first_ms > q->t2 || s->last_ms < q->t1)
+		return;
+
+	/* the entries beyond 'end' were not complete when indexed */
+	slog_decoder_init(&d, s->data, s->end);
+	col = -1;
+
+	i = index_lookup(s, q->t1);
+	if (i >= 0) {
+		if (!restore(&d, &s->index[i])) {
+			slog_decoder_free(&d);
+			return;
+		}
+
+		col = find_column(&d.header, q->id);
+	}
+
+	for (;;) {
+		entry = slog_decoder_next(&d);
+
+		if (entry == SLOG_ENTRY_HEADER) {
+			col = find_column(&d.header, q->id);
+		} else if (entry == SLOG_ENTRY_RECORD) {
+			ms = timeval_to_ms(&d.time);
+
+			if (ms > q->t2)
+				break;
+
+			if (ms >= q->t1
+			    && col != -1
+			    && d.values[col] != UNKNOWN_DOUBLE_VALUE)
+				add_value(q, ms, d.values[col]);
+		} else {
+			break;
+		}
+	}
+
+	slog_decoder_free(&d);
+}
+
+struct slog_sample *slog_reader_query(struct slog_reader *r,
+				      const char *id,
+				      time_t t1,
+				      time_t t2,
+				      unsigned int step,
+				      size_t *n)
+{
+	struct query q;
+	size_t i;
+
+	memset(&q, 0, sizeof(q));
+	q.id = id;
+	q.t1 = time_to_ms(t1);
+	q.t2 = time_to_ms(t2) + 999;
+	q.step = (int64_t)step * 1000;
+
+	for (i = 0; i < r->n; i++)
+		query_segment(&q, &r->segments[i]);
+
+	flush_period(&q);
+
+	*n = q.n;
+
+	return q.samples;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_SLOGREAD_H
+#define PSENSOR_SLOGREAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+
+/*
+ * Reader of the sensor log and of its rotated segments.
+ *
+ * The segments are mapped in memory. On the first read a segment is
+ * decoded once to build a sparse index: every SLOG_INDEX_STEP bytes
+ * and at each header, the state of the decoder is saved. The index is
+ * written to slog_index_path(segment) and reloaded by the next
+ * readers as long as the segment is the same file and has not
+ * shrunk, only the appended records are decoded again.
+ *
+ * A time range query looks up the index with a binary search and
+ * decodes sequentially from the nearest state, it therefore expects
+ * the records to be in chronological order, as written by psensor.
+ *
+ * Compressed segments cannot be mapped and are ignored.
+ */
+
+#define SLOG_INDEX_STEP (256 * 1024)
+
+/* State of the decoder after the entry ending at 'pos'. */
+struct slog_index_entry {
+	uint64_t pos;
+	/* offset of the header of the section */
+	uint64_t header_pos;
+	/* time of the last record or start of the section, in ms */
+	int64_t ms;
+	/* values of the last record, 'n' of the section */
+	uint64_t n;
+	double *values;
+};
+
+struct slog_segment {
+	char *path;
+	const unsigned char *data;
+	size_t len;
+
+	struct slog_index_entry *index;
+	size_t index_n;
+	/* offset of the end of the last decoded entry */
+	uint64_t end;
+	/* time of the first and last records, in ms */
+	int64_t first_ms;
+	int64_t last_ms;
+};
+
+struct slog_reader {
+	/* ordered by time */
+	struct slog_segment *segments;
+	size_t n;
+};
+
+struct slog_sample {
+	struct timeval time;
+	/* mean, min and max of the values of the sample */
+	double value;
+	double min;
+	double max;
+};
+
+/*
+ * Opens the log 'path' and its rotated segments, except the ones
+ * which end before 'since' (0 for all). Returns NULL if none of them
+ * can be read.
+ */
+struct slog_reader *slog_reader_open(const char *path, time_t since);
+void slog_reader_close(struct slog_reader *r);
+
+/*
+ * Returns the values of the sensor 'id' logged between 't1' and 't2'
+ * (seconds since the Epoch, both included) and sets '*n' to their
+ * number. Unknown values are skipped.
+ *
+ * If 'step' is not 0, the values are downsampled to one sample per
+ * 'step' seconds from 't1', the time of a sample is the beginning of
+ * its period.
+ *
+ * To be freed, NULL when there is no value.
+ */
+struct slog_sample *slog_reader_query(struct slog_reader *r,
+				      const char *id,
+				      time_t t1,
+				      time_t t2,
+				      unsigned int step,
+				      size_t *n);
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _GNU_SOURCE
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <io.h>
+#include <psysfs.h>
+#include <thermal.h>
+
+static const char *PROVIDER_NAME = "thermal";
+
+static const char *DEFAULT_SYSFS_ROOT = "/sys";
+
+static char *sysfs_root;
+
+void thermal_set_sysfs_root(const char *root)
+{
+	free(sysfs_root);
+	sysfs_root = root ? strdup(root) : NULL;
+}
+
+static void thermal_data_free(void *data)
+{
+	close(*(int *)data);
+	free(data);
+}
+
+static int filter_zone(const char *path)
+{
+	return !strncmp(sysfs_basename(path), "thermal_zone", 12);
+}
+
+/*
+ * Returns the lowest trip point at which the zone is considered too
+ * hot (passive cooling, hot or critical), UNKNOWN_DOUBLE_VALUE if
+ * there is none. Active trip points only drive the fans.
+ */
+static double get_max(const char *zone)
+{
+	char *path, *type;
+	long v;
+	int i;
+	double max;
+
+	max = UNKNOWN_DOUBLE_VALUE;
+
+	for (i = 0;; i++) {
+		path = sysfs_path_printf("%s/trip_point_%d_type", zone, i);
+		type = sysfs_read_str(path);
+		free(path);
+
+		if (!type)
+			break;
+
+		if (!strcmp(type, "passive")
+		    || !strcmp(type, "hot")
+		    || !strcmp(type, "critical")) {
+			path = sysfs_path_printf("%s/trip_point_%d_temp",
+						 zone,
+						 i);
+
+			if (sysfs_read_long(path, &v)
+			    && v > 0
+			    && (max == UNKNOWN_DOUBLE_VALUE || v / 1000.0 < max))
+				max = v / 1000.0;
+
+			free(path);
+		}
+
+		free(type);
+	}
+
+	return max;
+}
+
+/*
+ * Whether lm-sensors already reports the zones of a type: the
+ * thermal core registers a hwmon device named after the type with
+ * '-' replaced by '_'.
+ */
+static bool is_lmsensor_chip(struct psensor **sensors, const char *type)
+{
+	char *prefix, *c;
+	size_t n;
+	bool ret;
+
+	prefix = sysfs_path_printf("lmsensor %s-", type);
+	for (c = prefix + 9; *c; c++)
+		if (*c == '-' && c[1])
+			*c = '_';
+
+	n = strlen(prefix);
+
+	ret = false;
+	for (; *sensors; sensors++)
+		if ((*sensors)->type & SENSOR_TYPE_LMSENSOR
+		    && !strncmp((*sensors)->id, prefix, n)) {
+			ret = true;
+			break;
+		}
+
+	free(prefix);
+
+	return ret;
+}
+
+static struct psensor *create_sensor(const char *zone,
+				     unsigned int values_max_length)
+{
+	struct psensor *s;
+	char *path, *type, *id;
+	int fd, *data;
+	long v;
+
+	path = sysfs_path_printf("%s/type", zone);
+	type = sysfs_read_str(path);
+	free(path);
+
+	if (!type)
+		return NULL;
+
+	path = sysfs_path_printf("%s/temp", zone);
+	fd = sysfs_open(path);
+	free(path);
+
+	/* disabled zones cannot be read */
+	if (fd == -1 || !sysfs_pread_long(fd, &v)) {
+		log_functionname("%s: %s cannot be read.", PROVIDER_NAME, zone);
+		if (fd != -1)
+			close(fd);
+		free(type);
+		return NULL;
+	}
+
+	id = sysfs_path_printf("%s %s", PROVIDER_NAME, sysfs_basename(zone));
+
+	s = psensor_create(id,
+			   type,
+			   strdup(_("Thermal zone")),
+			   SENSOR_TYPE_THERMAL | SENSOR_TYPE_TEMP,
+			   values_max_length);
+
+	s->max = get_max(zone);
+
+	data = malloc(sizeof(int));
+	*data = fd;
+
+	s->provider_data = data;
+	s->provider_data_free_fct = &thermal_data_free;
+
+	return s;
+}
+
+void thermal_psensor_list_append(struct psensor ***sensors,
+				 unsigned int values_max_length)
+{
+	char *dir, **paths, **cur;
+	struct psensor *s;
+
+	dir = sysfs_path_printf("%s/class/thermal",
+			  sysfs_root ? sysfs_root : DEFAULT_SYSFS_ROOT);
+
+	paths = dir_list(dir, filter_zone);
+	free(dir);
+
+	if (!paths)
+		return;
+
+	for (cur = paths; *cur; cur++) {
+		s = create_sensor(*cur, values_max_length);
+		if (!s)
+			continue;
+
+		if (is_lmsensor_chip(*sensors, s->name)) {
+			log_functionname("%s: %s reported by lm-sensors.",
+					 PROVIDER_NAME,
+					 *cur);
+			psensor_free(s);
+			continue;
+		}
+
+		psensor_list_append(sensors, s);
+	}
+
+	paths_free(paths);
+}
+
+void thermal_psensor_list_update(struct psensor **sensors)
+{
+	struct psensor *s;
+	long v;
+
+	if (!sensors)
+		return;
+
+	for (; *sensors; sensors++) {
+		s = *sensors;
+
+		if (s->type & SENSOR_TYPE_REMOTE
+		    || !(s->type & SENSOR_TYPE_THERMAL))
+			continue;
+
+		if (sysfs_pread_long(*(int *)s->provider_data, &v))
+			psensor_set_current_value(s, v / 1000.0);
+	}
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef PSENSOR_THERMAL_H
+#define PSENSOR_THERMAL_H
+
+#include <psensor.h>
+
+/*
+ * Temperatures of the thermal zones of the kernel
+ * (/sys/class/thermal/thermal_zone*). The trip points define the
+ * maximum of the sensors and therefore their default alarm threshold.
+ *
+ * The sysfs root can be changed for testing, NULL for /sys.
+ */
+void thermal_set_sysfs_root(const char *root);
+
+void thermal_psensor_list_append(struct psensor ***, unsigned int);
+void thermal_psensor_list_update(struct psensor **);
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2010-2016 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#define _LARGEFILE_SOURCE 1
+#include "config.h"
+
+#include <locale.h>
+#include <libintl.h>
+#define _(str) gettext(str)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <plog.h>
+#include <slogfmt.h>
+#include <slogread.h>
+
+static const char *program_name;
+
+static struct option long_options[] = {
+	{"version", no_argument, NULL, 'v'},
+	{"help", no_argument, NULL, 'h'},
+	{"debug", required_argument, NULL, 'd'},
+	{"format", required_argument, NULL, 'f'},
+	{"start", required_argument, NULL, 's'},
+	{"end", required_argument, NULL, 'e'},
+	{"interval", required_argument, NULL, 'i'},
+	{NULL, 0, NULL, 0}
+};
+
+static void print_version(void)
+{
+	printf("psensor-log %s\n", VERSION);
+	printf(_("Copyright (C) %s jeanfi@gmail.com\n"
+		 "License GPLv2: GNU GPL version 2 or later "
+		 "<http://www.gnu.org/licenses/old-licenses/gpl-2.0.html>\n"
+		 "This is free software: you are free to change and redistribute it.\n"
+		 "There is NO WARRANTY, to the extent permitted by law.\n"),
+	       "2010-2016");
+}
+
+static void print_help(void)
+{
+	printf(_("Usage: %s [OPTION]... COMMAND [ARG]...\n"), program_name);
+
+	puts(_("psensor-log reads the sensor logs of psensor and "
+	       "psensor-server."));
+
+	puts("");
+	puts(_("Commands:"));
+	puts(_("  convert IN OUT	convert the log IN to OUT, '-' is the "
+	       "standard output"));
+	puts(_("  query LOG ID		print the values of the sensor ID from "
+	       "LOG and its\n"
+	       "			rotated segments, one 'TIME,VALUE' line"
+	       " per record"));
+
+	puts("");
+	puts("Options:");
+	puts(_("  -h, --help		display this help and exit\n"
+	       "  -v, --version		display version information and exit"));
+
+	puts("");
+	puts(_("  -f, --format=FORMAT	format of the output: csv or binary,\n"
+	       "			by default the other format than the input"));
+	puts(_("  -s, --start=TIME	query the values from TIME, in "
+	       "seconds since the\n"
+	       "			Epoch"));
+	puts(_("  -e, --end=TIME	query the values until TIME"));
+	puts(_("  -i, --interval=S	query one 'TIME,MEAN,MIN,MAX' line "
+	       "per S seconds"));
+	puts(_("  -d, --debug=LEVEL     "
+	       "set the debug level, integer between 0 and 3"));
+
+	puts("");
+	printf(_("Report bugs to: %s\n"), PACKAGE_BUGREPORT);
+	printf(_("%s home page: <%s>\n"), PACKAGE_NAME, PACKAGE_URL);
+}
+
+/* Maps the whole file, the log may be bigger than the memory. */
+static void *map_file(const char *path, size_t *len)
+{
+	struct stat st;
+	void *data;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		fprintf(stderr, _("Cannot open %s: %s\n"), path,
+			strerror(errno));
+		return NULL;
+	}
+
+	if (fstat(fd, &st)) {
+		close(fd);
+		return NULL;
+	}
+
+	*len = st.st_size;
+
+	if (*len)
+		data = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+	else
+		data = NULL;
+
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		fprintf(stderr, _("Cannot map %s: %s\n"), path,
+			strerror(errno));
+		return NULL;
+	}
+
+	if (data)
+		madvise(data, *len, MADV_SEQUENTIAL);
+
+	return data;
+}
+
+static int convert(const char *in,
+		   const char *out,
+		   bool has_format,
+		   enum slog_format format)
+{
+	struct slog_decoder d;
+	void *data;
+	size_t len;
+	FILE *f;
+	bool ok;
+
+	len = 0;
+	data = map_file(in, &len);
+	if (!data && len)
+		return EXIT_FAILURE;
+
+	slog_decoder_init(&d, data, len);
+
+	if (!has_format)
+		format = d.format == SLOG_FORMAT_CSV
+			? SLOG_FORMAT_BINARY : SLOG_FORMAT_CSV;
+
+	if (!strcmp(out, "-"))
+		f = stdout;
+	else
+		f = fopen(out, "w");
+
+	if (!f) {
+		fprintf(stderr, _("Cannot open %s: %s\n"), out,
+			strerror(errno));
+		ok = false;
+	} else {
+		ok = slog_convert(&d, format, f);
+
+		if (!ok)
+			fprintf(stderr,
+				_("Failed to convert %s at offset %zu.\n"),
+				in,
+				d.pos);
+
+		if ((f != stdout && fclose(f)) || (f == stdout && fflush(f)))
+			ok = false;
+	}
+
+	slog_decoder_free(&d);
+
+	if (data)
+		munmap(data, len);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int query(const char *log,
+		 const char *id,
+		 time_t start,
+		 time_t end,
+		 unsigned int interval)
+{
+	struct slog_reader *r;
+	struct slog_sample *samples, *s;
+	size_t n, i;
+
+	r = slog_reader_open(log, start);
+	if (!r) {
+		fprintf(stderr, _("Cannot read %s.\n"), log);
+		return EXIT_FAILURE;
+	}
+
+	samples = slog_reader_query(r, id, start, end, interval, &n);
+
+	for (i = 0; i < n; i++) {
+		s = &samples[i];
+
+		printf("%ld.%03ld,%.15g",
+		       (long)s->time.tv_sec,
+		       (long)s->time.tv_usec / 1000,
+		       s->value);
+
+		if (interval)
+			printf(",%.15g,%.15g", s->min, s->max);
+
+		putchar('\n');
+	}
+
+	free(samples);
+	slog_reader_close(r);
+
+	return fflush(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	int optc, cmdok, opti;
+	bool has_format;
+	enum slog_format format;
+	const char *cmd;
+	time_t start, end;
+	unsigned int interval;
+
+	program_name = argv[0];
+
+	setlocale(LC_ALL, "");
+
+#if ENABLE_NLS
+	bindtextdomain(PACKAGE, LOCALEDIR);
+	textdomain(PACKAGE);
+#endif
+
+	cmdok = 1;
+	has_format = false;
+	format = SLOG_FORMAT_CSV;
+	start = 0;
+	end = LONG_MAX;
+	interval = 0;
+
+	while ((optc = getopt_long(argc,
+				   argv,
+				   "vhd:f:s:e:i:",
+				   long_options,
+				   &opti)) != -1) {
+		switch (optc) {
+		case 'h':
+			print_help();
+			exit(EXIT_SUCCESS);
+		case 'v':
+			print_version();
+			exit(EXIT_SUCCESS);
+		case 'd':
+			log_level = atoi(optarg);
+			break;
+		case 'f':
+			has_format = true;
+			if (!slog_format_from_str(optarg, &format))
+				cmdok = 0;
+			break;
+		case 's':
+			start = atol(optarg);
+			break;
+		case 'e':
+			end = atol(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		default:
+			cmdok = 0;
+			break;
+		}
+	}
+
+	cmd = optind < argc ? argv[optind] : NULL;
+
+	if (cmdok && cmd && !strcmp(cmd, "convert") && argc - optind == 3)
+		return convert(argv[optind + 1],
+			       argv[optind + 2],
+			       has_format,
+			       format);
+
+	if (cmdok && cmd && !strcmp(cmd, "query") && argc - optind == 3)
+		return query(argv[optind + 1],
+			     argv[optind + 2],
+			     start,
+			     end,
+			     interval);
+
+	fprintf(stderr, _("Try `%s --help' for more information.\n"),
+		program_name);
+
+	return EXIT_FAILURE;
+}
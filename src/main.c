@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -34,17 +35,25 @@
 
 #include <amd.h>
 #include <cfg.h>
+#include <cpustat.h>
 #include <graph.h>
 #include <hdd.h>
+#include <io.h>
 #include <lmsensor.h>
 #include <notify_cmd.h>
+#include <pdiscovery.h>
+#include <pevent.h>
 #include <nvidia.h>
 #include <pgtop2.h>
 #include <pmutex.h>
 #include <psensor.h>
+#include <pshm.h>
+#include <psi.h>
 #include <pudisks2.h>
 #include <rsensor.h>
+#include <scache.h>
 #include <slog.h>
+#include <thermal.h>
 #include <ui.h>
 #include <ui_appindicator.h>
 #include <ui_color.h>
@@ -57,6 +66,13 @@
 
 static const char *program_name;
 
+static const unsigned int MEASURES_LEN = 600;
+
+/* sensors of the cache not yet found again by their provider */
+static struct psensor **cached_sensors;
+/* sensors of the cache not found, removed from the list of the UI */
+static struct psensor **stale_sensors;
+
 static void print_version(void)
 {
 	printf("psensor %s\n", VERSION);
@@ -85,7 +101,8 @@ static void print_help(void)
 
 	puts(_(
 "  -u, --url=URL       the URL of the psensor-server,\n"
-"                      example: http://hostname:3131"));
+"                      example: http://hostname:3131\n"
+"                      can be repeated to monitor several servers"));
 	puts(_(
 "  -n, --new-instance  force the creation of a new Psensor application"));
 	puts("");
@@ -118,6 +135,82 @@ update_psensor_values_size(struct psensor **sensors, struct config *cfg)
 	}
 }
 
+/*
+ * The sensor log read for the history of the sensors. Opened at
+ * startup and shared with the discovery threads until the end of the
+ * discovery: building its index takes seconds for a large log, it is
+ * done once and never in the main loop. NULL when the log is
+ * disabled or empty.
+ */
+static struct slog_reader *history;
+static time_t history_since;
+static unsigned int history_values_len;
+static pthread_mutex_t history_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Must be called before the discovery threads are started. */
+static void open_history(struct config *cfg)
+{
+	if (!cfg->slog_enabled)
+		return;
+
+	history_since = time(NULL) - cfg->graph_monitoring_duration * 60;
+	history_values_len = cfg->sensor_values_max_length;
+
+	slog_set_format(config_get_slog_format());
+	history = slog_history_open(NULL, history_since);
+}
+
+static void close_history(void)
+{
+	pmutex_lock(&history_mutex);
+
+	if (history) {
+		slog_reader_close(history);
+		history = NULL;
+	}
+
+	pmutex_unlock(&history_mutex);
+}
+
+/*
+ * Fills the measures of the sensors with the values logged during
+ * the last graph-monitoring-duration, so that the graphs do not start
+ * empty. Called at startup and by the discovery threads for the
+ * sensors they found, before they are monitored.
+ */
+static void load_history(struct psensor **sensors)
+{
+	struct psensor **cur;
+
+	pmutex_lock(&history_mutex);
+
+	if (history) {
+		for (cur = sensors; *cur; cur++)
+			if ((*cur)->values_max_length != history_values_len)
+				psensor_values_resize(*cur,
+						      history_values_len);
+
+		slog_history_load(history, sensors, history_since);
+	}
+
+	pmutex_unlock(&history_mutex);
+}
+
+/* Keeps the measures in ~/.psensor/history across the restarts. */
+static void set_history_dir(void)
+{
+	const char *dir;
+	char *path;
+
+	dir = get_psensor_user_dir();
+	if (!dir)
+		return;
+
+	path = path_append(dir, "history");
+	psensor_set_history_dir(path);
+	free(path);
+}
+
 static void *update_measures(void *data)
 {
 	struct psensor **sensors;
@@ -129,6 +222,13 @@ static void *update_measures(void *data)
 	cfg = ui->config;
 
 	while (1) {
+		/*
+		 * Network requests are done before taking the mutex so
+		 * that a slow server does not block the UI.
+		 */
+		rsensor_fetch();
+		hddtemp_fetch();
+
 		pmutex_lock(&ui->sensors_mutex);
 
 		sensors = ui->sensors;
@@ -138,22 +238,29 @@ static void *update_measures(void *data)
 		update_psensor_values_size(sensors, cfg);
 
 		lmsensor_psensor_list_update(sensors);
+		hwmon_disk_psensor_list_update(sensors);
+		thermal_psensor_list_update(sensors);
 
 		remote_psensor_list_update(sensors);
 		nvidia_psensor_list_update(sensors);
 		amd_psensor_list_update(sensors);
 		udisks2_psensor_list_update(sensors);
 		gtop2_psensor_list_update(sensors);
+		cpustat_psensor_list_update(sensors);
+		psi_psensor_list_update(sensors);
 		atasmart_psensor_list_update(sensors);
 		hddtemp_psensor_list_update(sensors);
 
+		pshm_publish(sensors);
+
 		//psensor_log_measures(sensors);
 
 		period = cfg->sensor_update_interval;
 
 		pmutex_unlock(&ui->sensors_mutex);
 
-		sleep(period);
+		/* providers can request an update before the period */
+		pevent_wait(period * 1000);
 	}
 }
 
@@ -357,10 +464,17 @@ static void cleanup(struct ui_psensor *ui)
 	nvidia_cleanup();
 	amd_cleanup();
 	rsensor_cleanup();
+	pshm_close();
+	close_history();
 
 	psensor_list_free(ui->sensors);
 	ui->sensors = NULL;
 
+	free(cached_sensors);
+	cached_sensors = NULL;
+	psensor_list_free(stale_sensors);
+	stale_sensors = NULL;
+
 	ui_appindicator_cleanup();
 
 	ui_status_cleanup();
@@ -376,20 +490,345 @@ static void cleanup(struct ui_psensor *ui)
 	log_debug("Cleanup done, closing log");
 }
 
+/* Appends an URL to a null-terminated list of URLs. */
+static char **urls_add(char **urls, const char *url)
+{
+	size_t n;
+
+	n = 0;
+	if (urls)
+		while (urls[n])
+			n++;
+
+	urls = realloc(urls, (n + 2) * sizeof(char *));
+	urls[n] = strdup(url);
+	urls[n + 1] = NULL;
+
+	return urls;
+}
+
+static void urls_free(char **urls)
+{
+	char **cur;
+
+	if (!urls)
+		return;
+
+	for (cur = urls; *cur; cur++)
+		free(*cur);
+
+	free(urls);
+}
+
+struct discovery_result {
+	struct ui_psensor *ui;
+	struct psensor **sensors;
+};
+
+/*
+ * Adds the sensors found by a provider, or gives them to their
+ * counterpart restored from the cache. Runs in the main loop.
+ */
+static gboolean merge_sensors(gpointer data)
+{
+	struct discovery_result *r;
+	struct ui_psensor *ui;
+	struct psensor **cur, *s;
+
+	r = data;
+	ui = r->ui;
+
+	pmutex_lock(&ui->sensors_mutex);
+
+	/* NULL when quitting */
+	if (!ui->sensors) {
+		psensor_list_free(r->sensors);
+		pmutex_unlock(&ui->sensors_mutex);
+		free(r);
+		return FALSE;
+	}
+
+	for (cur = r->sensors; *cur; cur++) {
+		s = NULL;
+		if (cached_sensors)
+			s = psensor_list_get_by_id(cached_sensors, (*cur)->id);
+
+		if (s) {
+			psensor_list_remove(cached_sensors, s);
+			psensor_adopt(s, *cur);
+			*cur = s;
+		} else {
+			psensor_list_append(&ui->sensors, *cur);
+		}
+	}
+
+	associate_preferences(r->sensors);
+	associate_cb_alarm_raised(r->sensors, ui);
+
+	slog_set_sensors(ui->sensors);
+
+	ui_sensorlist_update(ui, 1);
+	ui_appindicator_update_menu(ui);
+
+	pmutex_unlock(&ui->sensors_mutex);
+
+	free(r->sensors);
+	free(r);
+
+	return FALSE;
+}
+
+/*
+ * Runs in the thread of the provider: the history is loaded here, the
+ * sensors are not monitored yet and the main loop does not wait for
+ * the log. The providers only update the sensors of ui->sensors, see
+ * hddtemp_psensor_list_update, so no update writes to them
+ * meanwhile. Wasted for the sensors restored from the cache, which got
+ * theirs at startup, but they are not known before merge_sensors.
+ *
+ * Also called by the update thread with the sensors of a remote
+ * server reachable after the startup, their history comes from the
+ * server and the log is closed.
+ */
+static void
+discovery_cbk(const char *name, struct psensor **sensors, void *data)
+{
+	struct discovery_result *r;
+
+	if (!*sensors) {
+		free(sensors);
+		return;
+	}
+
+	load_history(sensors);
+
+	r = malloc(sizeof(struct discovery_result));
+	r->ui = data;
+	r->sensors = sensors;
+
+	g_idle_add(merge_sensors, r);
+}
+
+static char *get_cache_path(void)
+{
+	const char *dir;
+	char *path;
+
+	dir = get_psensor_user_dir();
+
+	if (!dir || asprintf(&path, "%s/%s", dir, "sensors.cache") == -1)
+		return NULL;
+
+	return path;
+}
+
+/*
+ * Removes the sensors of the cache which have not been found again
+ * and saves the new cache. Runs in the main loop.
+ */
+static gboolean end_discovery(gpointer data)
+{
+	struct ui_psensor *ui;
+	struct psensor **cur;
+	char *path;
+
+	ui = data;
+
+	close_history();
+
+	pmutex_lock(&ui->sensors_mutex);
+
+	if (!ui->sensors) {
+		pmutex_unlock(&ui->sensors_mutex);
+		return FALSE;
+	}
+
+	if (cached_sensors && *cached_sensors) {
+		if (!stale_sensors) {
+			stale_sensors = malloc(sizeof(struct psensor *));
+			*stale_sensors = NULL;
+		}
+
+		/* not freed, the UI may still reference them */
+		for (cur = cached_sensors; *cur; cur++) {
+			log_info(_("Sensor %s not found anymore."),
+				 (*cur)->id);
+			psensor_list_remove(ui->sensors, *cur);
+			psensor_list_append(&stale_sensors, *cur);
+		}
+
+		slog_set_sensors(ui->sensors);
+
+		ui_sensorlist_update(ui, 1);
+		ui_appindicator_update_menu(ui);
+	}
+
+	free(cached_sensors);
+	cached_sensors = NULL;
+
+	path = get_cache_path();
+	if (path) {
+		scache_save(path, ui->sensors);
+		free(path);
+	}
+
+	pmutex_unlock(&ui->sensors_mutex);
+
+	return FALSE;
+}
+
+static void discovery_done_cbk(void *data)
+{
+	g_idle_add(end_discovery, data);
+}
+
+/*
+ * Adds the sensors of the previous run to the list of the UI until
+ * their provider finds them again.
+ */
+static void restore_cached_sensors(struct ui_psensor *ui)
+{
+	struct psensor **sensors, **cur;
+	char *path;
+
+	path = get_cache_path();
+	if (!path)
+		return;
+
+	sensors = scache_load(path, MEASURES_LEN);
+	free(path);
+
+	if (!sensors)
+		return;
+
+	cached_sensors = malloc(sizeof(struct psensor *));
+	*cached_sensors = NULL;
+
+	for (cur = sensors; *cur; cur++) {
+		/* already found, e.g. the hwmon disks */
+		if (psensor_list_get_by_id(ui->sensors, (*cur)->id)) {
+			psensor_free(*cur);
+			continue;
+		}
+
+		psensor_list_append(&cached_sensors, *cur);
+		psensor_list_append(&ui->sensors, *cur);
+	}
+
+	free(sensors);
+
+	associate_preferences(cached_sensors);
+
+	log_debug("%zu sensors restored from the cache.",
+		  psensor_list_size(cached_sensors));
+}
+
+static void add_provider(struct pdiscovery_provider *providers,
+			 int *n,
+			 const char *name,
+			 pdiscovery_fct append,
+			 unsigned int deadline_ms)
+{
+	providers[*n].name = name;
+	providers[*n].append = append;
+	providers[*n].append_after = NULL;
+	providers[*n].deadline_ms = deadline_ms;
+
+	(*n)++;
+}
+
+/*
+ * Starts the discovery of the local sensors in the background, the
+ * sensors are added to the list of the UI as the providers finish.
+ */
+static void discover_sensors(struct ui_psensor *ui, unsigned int measures_len)
+{
+	struct pdiscovery_provider providers[10];
+	char *host;
+	int n;
+
+	n = 0;
+
+	if (config_is_lmsensor_enabled()) {
+		add_provider(providers, &n, "lmsensor",
+			     lmsensor_psensor_list_append, 1000);
+
+		/* after lm-sensors which may already report the zones */
+		if (config_is_thermal_enabled())
+			providers[n - 1].append_after
+				= thermal_psensor_list_append;
+	} else if (config_is_thermal_enabled()) {
+		add_provider(providers, &n, "thermal",
+			     thermal_psensor_list_append, 1000);
+	}
+
+	if (config_is_hddtemp_enabled()) {
+		host = config_get_hddtemp_host();
+		hddtemp_set_server(host, config_get_hddtemp_port(), 0);
+		free(host);
+
+		add_provider(providers, &n, "hddtemp",
+			     hddtemp_psensor_list_append, 3000);
+	}
+
+	if (config_is_libatasmart_enabled())
+		add_provider(providers, &n, "atasmart",
+			     atasmart_psensor_list_append, 5000);
+
+	if (config_is_nvctrl_enabled())
+		add_provider(providers, &n, "nvctrl",
+			     nvidia_psensor_list_append, 2000);
+
+	if (config_is_atiadlsdk_enabled())
+		add_provider(providers, &n, "atiadlsdk",
+			     amd_psensor_list_append, 2000);
+
+	if (config_is_gtop2_enabled())
+		add_provider(providers, &n, "gtop2",
+			     gtop2_psensor_list_append, 1000);
+
+	if (config_is_cpustat_enabled())
+		add_provider(providers, &n, "cpustat",
+			     cpustat_psensor_list_append, 1000);
+
+	if (config_is_psi_enabled()) {
+		psi_set_trigger(config_get_psi_trigger());
+		add_provider(providers, &n, "psi",
+			     psi_psensor_list_append, 1000);
+	}
+
+	if (config_is_udisks2_enabled())
+		add_provider(providers, &n, "udisks2",
+			     udisks2_psensor_list_append, 5000);
+
+	pdiscovery_start(providers,
+			 n,
+			 ui->sensors,
+			 measures_len,
+			 discovery_cbk,
+			 discovery_done_cbk,
+			 ui);
+}
+
 /*
  * Creates the list of sensors.
  *
- * 'url': remote psensor server url, null for local monitoring.
+ * 'urls': null-terminated list of the remote psensor server urls,
+ * null for local monitoring. The local sensors are discovered in the
+ * background, only the hwmon disks are returned because the other
+ * providers skip them.
  */
-static struct psensor **create_sensors_list(const char *url)
+static struct psensor **create_sensors_list(char **urls,
+					    unsigned int measures_len)
 {
-	const unsigned int measures_len = 600;
 	struct psensor **sensors;
 
-	if (url) {
+	if (urls) {
 		if (rsensor_is_supported()) {
-			rsensor_init();
-			sensors = get_remote_sensors(url, measures_len);
+			rsensor_init(config_get_remote_connect_timeout(),
+				     config_get_remote_timeout());
+			sensors = get_remote_sensors((const char **)urls,
+						     measures_len);
 		} else {
 			log_err(_("Psensor has not been compiled with remote "
 				  "sensor support."));
@@ -399,26 +838,8 @@ static struct psensor **create_sensors_list(const char *url)
 		sensors = malloc(sizeof(struct psensor *));
 		*sensors = NULL;
 
-		if (config_is_lmsensor_enabled())
-			lmsensor_psensor_list_append(&sensors, measures_len);
-
-		if (config_is_hddtemp_enabled())
-			hddtemp_psensor_list_append(&sensors, measures_len);
-
-		if (config_is_libatasmart_enabled())
-			atasmart_psensor_list_append(&sensors, measures_len);
-
-		if (config_is_nvctrl_enabled())
-			nvidia_psensor_list_append(&sensors, measures_len);
-
-		if (config_is_atiadlsdk_enabled())
-			amd_psensor_list_append(&sensors, measures_len);
-
-		if (config_is_gtop2_enabled())
-			gtop2_psensor_list_append(&sensors, measures_len);
-
-		if (config_is_udisks2_enabled())
-			udisks2_psensor_list_append(&sensors, measures_len);
+		if (config_is_hwmon_disk_enabled())
+			hwmon_disk_psensor_list_append(&sensors, measures_len);
 	}
 
 	associate_preferences(sensors);
@@ -431,7 +852,7 @@ int main(int argc, char **argv)
 	struct ui_psensor ui;
 	pthread_t thread;
 	int optc, cmdok, opti, new_instance, ret;
-	char *url = NULL;
+	char **urls = NULL;
 	GApplication *app;
 
 	// cpu_set_t mask;
@@ -466,21 +887,16 @@ int main(int argc, char **argv)
 				   &opti)) != -1) {
 		switch (optc) {
 		case 'u':
-			if (optarg) {
-				if (url)
-					free(url);
-				url = strdup(optarg);
-			}
+			if (optarg)
+				urls = urls_add(urls, optarg);
 			break;
 		case 'h':
 			print_help();
-			if (url)
-				free(url);
+			urls_free(urls);
 			exit(EXIT_SUCCESS);
 		case 'v':
 			print_version();
-			if (url)
-				free(url);
+			urls_free(urls);
 			exit(EXIT_SUCCESS);
 		case 'd':
 			log_level = atoi(optarg);
@@ -498,8 +914,7 @@ int main(int argc, char **argv)
 	if (!cmdok || optind != argc) {
 		fprintf(stderr, _("Try `%s --help' for more information.\n"),
 			program_name);
-		if (url)
-			free(url);
+		urls_free(urls);
 		exit(EXIT_FAILURE);
 	}
 
@@ -512,8 +927,7 @@ int main(int argc, char **argv)
 	if (!new_instance && g_application_get_is_remote(app)) {
 		g_application_activate(app);
 		log_warn(_("A Psensor instance already exists."));
-		if (url)
-			free(url);
+		urls_free(urls);
 		exit(EXIT_SUCCESS);
 	}
 
@@ -535,14 +949,35 @@ int main(int argc, char **argv)
 
 	ui.config = config_load();
 
-	ui.sensors = create_sensors_list(url);
+	if (config_is_history_persistent())
+		set_history_dir();
+
+	if (config_is_shm_enabled())
+		pshm_open(NULL);
+
+	open_history(ui.config);
+
+	ui.sensors = create_sensors_list(urls, MEASURES_LEN);
+
+	if (!urls) {
+		discover_sensors(&ui, MEASURES_LEN);
+		restore_cached_sensors(&ui);
+	}
+
 	associate_cb_alarm_raised(ui.sensors, &ui);
 
+	load_history(ui.sensors);
+
+	/* else closed at the end of the discovery */
+	if (urls)
+		close_history();
+
+	/* for the servers which are not reachable yet */
+	if (urls)
+		rsensor_set_sensors_cbk(discovery_cbk, &ui);
+
 	if (ui.config->slog_enabled)
-		slog_activate(NULL,
-			      ui.sensors,
-			      &ui.sensors_mutex,
-			      config_get_slog_interval());
+		ui_slog_activate(&ui);
 
 	// ui_status_init(&ui);
 	// ui_status_set_visible(1);
@@ -593,8 +1028,7 @@ int main(int argc, char **argv)
 
 	g_object_unref(app);
 
-	if (url)
-		free(url);
+	urls_free(urls);
 
 	return 0;
 }
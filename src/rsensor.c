@@ -23,9 +23,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
+#include <time.h>
 
 #include <curl/curl.h>
 
+#include <pindex.h>
+#include <pmutex.h>
 #include <psensor_json.h>
 #include <rsensor.h>
 #include <server/server.h>
@@ -36,13 +40,113 @@ struct ucontent {
 	size_t len;
 };
 
-static CURL *curl;
+/* A remote psensor-server. */
+struct rserver {
+	/* Host name (and port) of the server, used as chip name */
+	char *host;
+	/* <server url>/api/1.1/sensors */
+	char *sensors_url;
+	/* <server url>/api/1.1/last_measures */
+	char *measures_url;
+	/*
+	 * Whether the server does not provide the last measures
+	 * resource, the full list of sensors is then retrieved.
+	 */
+	bool legacy;
+	/*
+	 * Whether the sensors of the server have been created, they are
+	 * created from its first successful response which may come
+	 * after the startup.
+	 */
+	bool created;
+	/* Associates the ids of the server to the local sensors */
+	struct pindex index;
+	/*
+	 * The same sensors for rsensor_get_status, protected by
+	 * status_mutex: the lookups of the index sort it.
+	 */
+	struct psensor **sensors;
+
+	/*
+	 * Each server has its own handle which is kept between the
+	 * updates so that the connection is reused.
+	 */
+	CURL *curl;
+	/* URL of the running request */
+	const char *url;
+	struct ucontent chunk;
+	/* HTTP response code of the last request, 0 if it failed */
+	long code;
+	json_object *response;
+	/* Whether a request has been done during the last fetch */
+	bool fetched;
+
+	/* Timeouts of the requests in milliseconds */
+	long connect_timeout;
+	long timeout;
+
+	enum rserver_state state;
+	/* Number of consecutive failed requests */
+	unsigned int failures;
+	/* Monotonic time (ms) before which no request is done */
+	long long next_attempt;
+	/*
+	 * Whether the history of the sensors must be retrieved to fill
+	 * the gap after a failure.
+	 */
+	bool backfill;
+};
+
+static CURLM *multi;
+
+/* Null-terminated list of the servers */
+static struct rserver **servers;
+
+/*
+ * Protects the servers against a cleanup while a fetch is running
+ * outside of the sensors mutex.
+ */
+static pthread_mutex_t servers_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Protects 'servers' and the state of the servers for
+ * rsensor_get_status, which is called by the UI and must not wait
+ * for a running fetch. Taken after servers_mutex.
+ */
+static pthread_mutex_t status_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static const char *PROVIDER_NAME = "rsensor";
 
-static const char *get_url(struct psensor *s)
+/* Length of the measures of the sensors created after the startup */
+static int values_len;
+
+/* Receives the sensors of the servers not reachable at the startup */
+static pdiscovery_cbk sensors_cbk;
+static void *sensors_cbk_data;
+
+/* Default timeouts of the requests in milliseconds */
+static long connect_timeout = 2000;
+static long request_timeout = 4000;
+
+/* Bounds of the delay between two attempts on a failing server (ms) */
+static const long long BACKOFF_MIN = 1000;
+static const long long BACKOFF_MAX = 60000;
+
+/*
+ * Number of consecutive failures after which the sensors of a server
+ * are marked as stale.
+ */
+static const unsigned int FAILURES_MAX = 3;
+
+static unsigned int jitter_seed;
+
+static long long get_monotonic_time(void)
 {
-	return (char *)s->provider_data;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
 static size_t cbk_curl(void *buffer, size_t size, size_t nmemb, void *userp)
@@ -54,7 +158,7 @@ static size_t cbk_curl(void *buffer, size_t size, size_t nmemb, void *userp)
 	mem = (struct ucontent *)userp;
 
 	char *tmp_char = realloc(mem->data, mem->len + realsize + 1);
-    if (!tmp_char) {
+	if (!tmp_char) {
 		log_err(_("%s: Not enough memory for CURL data"), PROVIDER_NAME);
 		return 0;
 	}
@@ -67,149 +171,648 @@ static size_t cbk_curl(void *buffer, size_t size, size_t nmemb, void *userp)
 	return realsize;
 }
 
-static char *create_api_1_1_sensors_url(const char *base_url)
+static char *create_api_1_1_url(const char *base_url, const char *path)
 {
 	char *nurl, *ret;
 	size_t n;
 
 	nurl = url_normalize(base_url);
-	n = strlen(nurl) + strlen(URL_BASE_API_1_1_SENSORS) + 1;
+	n = strlen(nurl) + strlen(path) + 1;
 	ret = malloc(n);
 
 	strcpy(ret, nurl);
-	strcat(ret, URL_BASE_API_1_1_SENSORS);
+	strcat(ret, path);
 
 	free(nurl);
 
 	return ret;
 }
 
-void rsensor_init(void)
+/* Returns the host part of an URL: http://host:port/path */
+static char *get_host(const char *url)
 {
-	curl = curl_easy_init();
+	const char *start, *end;
+	char *host;
+
+	start = strstr(url, "://");
+	start = start ? start + 3 : url;
+
+	end = strchr(start, '/');
+	if (!end)
+		end = start + strlen(start);
+
+	host = malloc(end - start + 1);
+	memcpy(host, start, end - start);
+	host[end - start] = '\0';
+
+	return host;
 }
 
-void rsensor_cleanup(void)
+static struct rserver *rserver_new(const char *url)
 {
-	curl_easy_cleanup(curl);
+	struct rserver *srv;
+
+	srv = malloc(sizeof(struct rserver));
+
+	srv->host = get_host(url);
+	srv->sensors_url = create_api_1_1_url(url, URL_BASE_API_1_1_SENSORS);
+	srv->measures_url = create_api_1_1_url(url,
+					       URL_API_1_1_LAST_MEASURES);
+	srv->legacy = false;
+	srv->created = false;
+	pindex_init(&srv->index);
+	srv->sensors = malloc(sizeof(struct psensor *));
+	*srv->sensors = NULL;
+
+	srv->url = NULL;
+	srv->chunk.data = NULL;
+	srv->chunk.len = 0;
+	srv->code = 0;
+	srv->response = NULL;
+	srv->fetched = false;
+
+	srv->connect_timeout = connect_timeout;
+	srv->timeout = request_timeout;
+
+	srv->state = RSERVER_UP;
+	srv->failures = 0;
+	srv->next_attempt = 0;
+	srv->backfill = false;
+
+	srv->curl = curl_easy_init();
+	if (srv->curl) {
+		curl_easy_setopt(srv->curl, CURLOPT_VERBOSE, 0L);
+		curl_easy_setopt(srv->curl, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(srv->curl, CURLOPT_WRITEFUNCTION, cbk_curl);
+		curl_easy_setopt(srv->curl, CURLOPT_WRITEDATA, &srv->chunk);
+		curl_easy_setopt(srv->curl, CURLOPT_PRIVATE, srv);
+		curl_easy_setopt(srv->curl,
+				 CURLOPT_CONNECTTIMEOUT_MS,
+				 srv->connect_timeout);
+		curl_easy_setopt(srv->curl, CURLOPT_TIMEOUT_MS, srv->timeout);
+	}
+
+	return srv;
 }
 
-static json_object *get_json_object(const char *url)
+static void rserver_free(struct rserver *srv)
 {
-	struct ucontent chunk;
-	json_object *obj;
+	if (srv->curl)
+		curl_easy_cleanup(srv->curl);
+
+	if (srv->response)
+		json_object_put(srv->response);
+
+	free(srv->chunk.data);
+	free(srv->host);
+	free(srv->sensors_url);
+	free(srv->measures_url);
+	pindex_cleanup(&srv->index);
+	free(srv->sensors);
+
+	free(srv);
+}
+
+void rsensor_init(long connect_tmo, long tmo)
+{
+	if (connect_tmo > 0)
+		connect_timeout = connect_tmo;
+	if (tmo > 0)
+		request_timeout = tmo;
+
+	jitter_seed = time(NULL);
+
+	curl_global_init(CURL_GLOBAL_ALL);
+	multi = curl_multi_init();
+}
+
+void rsensor_cleanup(void)
+{
+	struct rserver **cur;
+
+	pmutex_lock(&servers_mutex);
+	pmutex_lock(&status_mutex);
+
+	if (servers) {
+		for (cur = servers; *cur; cur++)
+			rserver_free(*cur);
+
+		free(servers);
+		servers = NULL;
+	}
+
+	pmutex_unlock(&status_mutex);
+
+	if (multi) {
+		curl_multi_cleanup(multi);
+		multi = NULL;
+	}
 
-	obj = NULL;
+	pmutex_unlock(&servers_mutex);
 
-	if (!curl)
-		return NULL;
+	curl_global_cleanup();
+}
+
+static bool request_start(struct rserver *srv, const char *url)
+{
+	CURLMcode ret;
 
-	chunk.data = malloc(1);
-	chunk.len = 0;
+	if (!srv->curl)
+		return false;
 
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_VERBOSE, 0);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, cbk_curl);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+	srv->url = url;
+	srv->code = 0;
+	srv->chunk.len = 0;
+
+	curl_easy_setopt(srv->curl, CURLOPT_URL, url);
 
 	log_functionname("%s: HTTP request %s", PROVIDER_NAME, url);
 
-	if (curl_easy_perform(curl) == CURLE_OK)
-		obj = json_tokener_parse(chunk.data);
-	else
-		log_err(_("%s: Fail to connect to: %s"), PROVIDER_NAME, url);
+	ret = curl_multi_add_handle(multi, srv->curl);
+	if (ret != CURLM_OK) {
+		log_err(_("%s: cannot start the request %s: %s"),
+			PROVIDER_NAME,
+			url,
+			curl_multi_strerror(ret));
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Called when the request of a server is completed, returns whether
+ * a new request has been started for this server.
+ */
+static bool request_done(struct rserver *srv, CURLcode result)
+{
+	curl_multi_remove_handle(multi, srv->curl);
+
+	if (result != CURLE_OK) {
+		log_err(_("%s: Fail to connect to: %s: %s"),
+			PROVIDER_NAME,
+			srv->url,
+			curl_easy_strerror(result));
+		return false;
+	}
+
+	curl_easy_getinfo(srv->curl, CURLINFO_RESPONSE_CODE, &srv->code);
+
+	if (srv->code == 200) {
+		if (srv->chunk.len)
+			srv->response = json_tokener_parse(srv->chunk.data);
+
+		if (!srv->response)
+			log_err(_("%s: Invalid content: %s"),
+				PROVIDER_NAME,
+				srv->url);
+
+		return false;
+	}
 
-	free(chunk.data);
+	if (srv->code == 404 && srv->url == srv->measures_url) {
+		log_warn(_("%s: %s not supported by the server, using %s."),
+			 PROVIDER_NAME,
+			 srv->measures_url,
+			 srv->sensors_url);
 
-	return obj;
+		srv->legacy = true;
+
+		return request_start(srv, srv->sensors_url);
+	}
+
+	log_err(_("%s: HTTP error %ld: %s"), PROVIDER_NAME, srv->code, srv->url);
+
+	return false;
 }
 
-struct psensor **get_remote_sensors(const char *server_url,
-				    int values_max_length)
+/*
+ * Performs the requests of all the servers in parallel, the
+ * duration is bounded by the slowest server.
+ *
+ * 'sensors_list' indicates whether the full list of sensors is
+ * requested rather than the last measures. Servers which are waiting
+ * for their next attempt after a failure are skipped.
+ */
+static void perform(bool sensors_list)
 {
-	struct psensor **sensors, *s;
-	char *url;
-	json_object *obj;
-	size_t i, n;
+	struct rserver **cur, *srv;
+	int running, pending, n;
+	CURLMsg *msg;
+	const char *url;
+	long long now;
 
-	sensors = NULL;
+	now = get_monotonic_time();
 
-	url = create_api_1_1_sensors_url(server_url);
+	pending = 0;
+	for (cur = servers; *cur; cur++) {
+		srv = *cur;
 
-	obj = get_json_object(url);
+		if (srv->response) {
+			json_object_put(srv->response);
+			srv->response = NULL;
+		}
 
-	if (obj) {
-		n = json_object_array_length(obj);
-		sensors = malloc((n + 1) * sizeof(struct psensor *));
+		srv->fetched = false;
 
-		for (i = 0; i < n; i++) {
-			s = psensor_new_from_json
-				(json_object_array_get_idx(obj, i),
-				 url,
-				 values_max_length);
-			sensors[i] = s;
+		if (!sensors_list && now < srv->next_attempt) {
+			log_debug("%s: %s: next attempt in %lldms",
+				  PROVIDER_NAME,
+				  srv->host,
+				  srv->next_attempt - now);
+			continue;
 		}
 
-		sensors[n] = NULL;
+		if (sensors_list
+		    || srv->legacy
+		    || srv->backfill
+		    || !srv->created)
+			url = srv->sensors_url;
+		else
+			url = srv->measures_url;
+
+		srv->fetched = true;
 
-		json_object_put(obj);
-	} else {
-		log_err(_("%s: Invalid content: %s"), PROVIDER_NAME, url);
+		if (request_start(srv, url))
+			pending++;
 	}
 
-	free(url);
+	while (pending) {
+		curl_multi_perform(multi, &running);
+
+		while ((msg = curl_multi_info_read(multi, &n))) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
 
-	if (!sensors) {
-		sensors = malloc(sizeof(struct psensor *));
-		*sensors = NULL;
+			curl_easy_getinfo(msg->easy_handle,
+					  CURLINFO_PRIVATE,
+					  (char **)&srv);
+
+			if (!request_done(srv, msg->data.result))
+				pending--;
+		}
+
+		if (pending)
+			curl_multi_wait(multi, NULL, 0, 1000, NULL);
+	}
+}
+
+static void servers_create(const char **urls)
+{
+	struct rserver **list;
+	size_t n;
+
+	for (n = 0; urls[n]; n++)
+		;
+
+	list = malloc((n + 1) * sizeof(struct rserver *));
+
+	for (n = 0; urls[n]; n++)
+		list[n] = rserver_new(urls[n]);
+
+	list[n] = NULL;
+
+	pmutex_lock(&status_mutex);
+	servers = list;
+	pmutex_unlock(&status_mutex);
+}
+
+static bool rserver_has_response(struct rserver *srv)
+{
+	return srv->response
+		&& json_object_is_type(srv->response, json_type_array);
+}
+
+/*
+ * Creates the sensors of a server from its full list of sensors, their
+ * history is loaded from the measures of the response.
+ */
+static void add_server_sensors(struct psensor ***sensors, struct rserver *srv)
+{
+	json_object *o, *oid;
+	struct psensor *s;
+	size_t i, n;
+
+	srv->created = true;
+
+	n = json_object_array_length(srv->response);
+	for (i = 0; i < n; i++) {
+		o = json_object_array_get_idx(srv->response, i);
+
+		s = psensor_new_from_json(o, srv->sensors_url, values_len);
+		if (!s)
+			continue;
+
+		s->chip = strdup(srv->host);
+
+		psensor_load_json_measures(s, o);
+
+		if (json_object_object_get_ex(o, "id", &oid))
+			pindex_add(&srv->index,
+				   json_object_get_string(oid),
+				   s);
+
+		psensor_list_append(sensors, s);
+
+		pmutex_lock(&status_mutex);
+		psensor_list_append(&srv->sensors, s);
+		pmutex_unlock(&status_mutex);
+	}
+}
+
+/*
+ * Updates the local sensor corresponding to a JSON object containing
+ * the id and the last measure of a remote sensor.
+ *
+ * 'backfill' indicates that the object is the full representation of
+ * the sensor and that its history is merged.
+ */
+static void
+remote_psensor_update(struct rserver *srv, json_object *obj, bool backfill)
+{
+	json_object *oid, *om, *ov, *ot;
+	struct psensor *s;
+	struct timeval tv;
+
+	if (!json_object_object_get_ex(obj, "id", &oid))
+		return;
+
+	s = pindex_get(&srv->index, json_object_get_string(oid));
+	if (!s)
+		return;
+
+	if (backfill) {
+		psensor_load_json_measures(s, obj);
+		return;
+	}
+
+	if (!json_object_object_get_ex(obj, "last_measure", &om))
+		return;
+
+	if (!json_object_object_get_ex(om, "value", &ov)
+	    || !json_object_object_get_ex(om, "time", &ot))
+		return;
+
+	tv.tv_sec = json_object_get_int(ot);
+	tv.tv_usec = 0;
+
+	psensor_set_current_measure(s, json_object_get_double(ov), tv);
+}
+
+/* Adds an unknown measure to the sensors of a server. */
+static void rserver_mark_stale(struct rserver *srv)
+{
+	struct timeval tv;
+	size_t i;
+
+	gettimeofday(&tv, NULL);
+
+	for (i = 0; i < srv->index.n; i++)
+		psensor_set_current_measure(srv->index.entries[i].data,
+					    UNKNOWN_DOUBLE_VALUE,
+					    tv);
+}
+
+static void rserver_succeeded(struct rserver *srv)
+{
+	if (srv->state != RSERVER_UP)
+		log_warn(_("%s: %s is reachable again after %u failure(s)."),
+			 PROVIDER_NAME,
+			 srv->host,
+			 srv->failures);
+
+	pmutex_lock(&status_mutex);
+	srv->state = RSERVER_UP;
+	srv->failures = 0;
+	srv->next_attempt = 0;
+	pmutex_unlock(&status_mutex);
+
+	srv->backfill = false;
+}
+
+/*
+ * Delays the next attempt with an exponential backoff, a random
+ * jitter avoids that the failing servers are retried in lockstep.
+ */
+static void rserver_failed(struct rserver *srv)
+{
+	long long delay;
+	unsigned int shift;
+
+	srv->failures++;
+
+	shift = srv->failures - 1;
+	if (shift > 16)
+		shift = 16;
+
+	delay = BACKOFF_MIN << shift;
+	if (delay > BACKOFF_MAX)
+		delay = BACKOFF_MAX;
+	delay = delay / 2 + rand_r(&jitter_seed) % (delay / 2 + 1);
+
+	srv->backfill = true;
+
+	if (srv->failures >= FAILURES_MAX && srv->state != RSERVER_DOWN)
+		log_warn(_("%s: %s is not reachable, its sensors are "
+			   "marked as stale."),
+			 PROVIDER_NAME,
+			 srv->host);
+
+	pmutex_lock(&status_mutex);
+	srv->next_attempt = get_monotonic_time() + delay;
+	if (srv->failures >= FAILURES_MAX)
+		srv->state = RSERVER_DOWN;
+	else
+		srv->state = RSERVER_BACKOFF;
+	pmutex_unlock(&status_mutex);
+
+	log_warn(_("%s: %s: %u failure(s), next attempt in %lldms."),
+		 PROVIDER_NAME,
+		 srv->host,
+		 srv->failures,
+		 delay);
+}
+
+struct psensor **get_remote_sensors(const char **urls,
+				    int values_max_length)
+{
+	struct psensor **sensors;
+	struct rserver **cur, *srv;
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	if (!multi || servers)
+		return sensors;
+
+	values_len = values_max_length;
+
+	servers_create(urls);
+
+	perform(true);
+
+	/* the others are retried by the updates with a backoff */
+	for (cur = servers; *cur; cur++) {
+		srv = *cur;
+
+		srv->fetched = false;
+
+		if (rserver_has_response(srv)) {
+			add_server_sensors(&sensors, srv);
+		} else {
+			log_err(_("%s: Invalid content: %s"),
+				PROVIDER_NAME,
+				srv->sensors_url);
+			rserver_failed(srv);
+		}
 	}
 
 	return sensors;
 }
 
-static void remote_psensor_update(struct psensor *s)
+void rsensor_set_sensors_cbk(pdiscovery_cbk cbk, void *data)
+{
+	pmutex_lock(&servers_mutex);
+
+	sensors_cbk = cbk;
+	sensors_cbk_data = data;
+
+	pmutex_unlock(&servers_mutex);
+}
+
+void rsensor_fetch(void)
+{
+	pmutex_lock(&servers_mutex);
+
+	if (servers)
+		perform(false);
+
+	pmutex_unlock(&servers_mutex);
+}
+
+void remote_psensor_list_update(struct psensor **sensors)
 {
-	json_object *obj;
+	struct rserver **cur, *srv;
+	struct psensor **created;
+	pdiscovery_cbk cbk;
+	void *cbk_data;
+	size_t i, n;
+	bool backfill;
 
-	obj = get_json_object(get_url(s));
+	pmutex_lock(&servers_mutex);
 
-	if (obj) {
-		json_object *om;
+	if (!servers) {
+		pmutex_unlock(&servers_mutex);
+		return;
+	}
+
+	created = malloc(sizeof(struct psensor *));
+	*created = NULL;
 
-		json_object_object_get_ex(obj, "last_measure", &om);
+	for (cur = servers; *cur; cur++) {
+		srv = *cur;
 
-		if (obj) {
-			json_object *ov, *ot;
-			struct timeval tv;
+		if (!srv->fetched) {
+			if (srv->state == RSERVER_DOWN)
+				rserver_mark_stale(srv);
+			continue;
+		}
 
-			json_object_object_get_ex(om, "value", &ov);
-			json_object_object_get_ex(om, "time", &ot);
+		srv->fetched = false;
 
-			tv.tv_sec = json_object_get_int(ot);
-			tv.tv_usec = 0;
+		if (!rserver_has_response(srv)) {
+			rserver_failed(srv);
+			if (srv->state == RSERVER_DOWN)
+				rserver_mark_stale(srv);
+			continue;
+		}
 
-			psensor_set_current_measure
-			    (s, json_object_get_double(ov), tv);
+		backfill = srv->backfill;
+		if (backfill)
+			log_debug("%s: %s: loading the history.",
+				  PROVIDER_NAME,
+				  srv->host);
+
+		rserver_succeeded(srv);
+
+		if (srv->created) {
+			n = json_object_array_length(srv->response);
+			for (i = 0; i < n; i++)
+				remote_psensor_update
+					(srv,
+					 json_object_array_get_idx
+						(srv->response, i),
+					 backfill);
+		} else if (sensors_cbk) {
+			log_info(_("%s: %s: creating the sensors."),
+				 PROVIDER_NAME,
+				 srv->host);
+			add_server_sensors(&created, srv);
 		}
 
-		json_object_put(obj);
-	} else {
-		log_err(_("%s: Invalid JSON: %s"), PROVIDER_NAME, get_url(s));
+		json_object_put(srv->response);
+		srv->response = NULL;
 	}
 
+	cbk = sensors_cbk;
+	cbk_data = sensors_cbk_data;
+
+	pmutex_unlock(&servers_mutex);
+
+	/*
+	 * Updated from the next fetch, they are monitored once the
+	 * callback has added them to 'sensors'.
+	 */
+	if (cbk && *created)
+		cbk(PROVIDER_NAME, created, cbk_data);
+	else
+		free(created);
 }
 
-void remote_psensor_list_update(struct psensor **sensors)
+/* Whether 's' is one of the sensors of 'srv', under status_mutex. */
+static bool rserver_has_sensor(struct rserver *srv, struct psensor *s)
 {
 	struct psensor **cur;
 
-	cur = sensors;
-	while (*cur) {
-		struct psensor *s = *cur;
+	for (cur = srv->sensors; *cur; cur++)
+		if (*cur == s)
+			return true;
 
-		if (s->type & SENSOR_TYPE_REMOTE)
-			remote_psensor_update(s);
+	return false;
+}
 
-		cur++;
+bool rsensor_get_status(struct psensor *s, struct rserver_status *status)
+{
+	struct rserver **cur, *srv;
+	long long now;
+	bool ret;
+
+	pmutex_lock(&status_mutex);
+
+	ret = false;
+	for (cur = servers; cur && *cur; cur++) {
+		srv = *cur;
+
+		if (!rserver_has_sensor(srv, s))
+			continue;
+
+		now = get_monotonic_time();
+
+		status->host = srv->host;
+		status->state = srv->state;
+		status->failures = srv->failures;
+
+		if (srv->next_attempt > now)
+			status->retry_delay
+				= (srv->next_attempt - now + 999) / 1000;
+		else
+			status->retry_delay = 0;
+
+		ret = true;
+		break;
 	}
+
+	pmutex_unlock(&status_mutex);
+
+	return ret;
 }
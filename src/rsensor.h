@@ -19,15 +19,64 @@
 #ifndef PSENSOR_RSENSOR_H
 #define PSENSOR_RSENSOR_H
 
+#include <pdiscovery.h>
 #include <psensor.h>
 
+enum rserver_state {
+	/* The last request succeeded */
+	RSERVER_UP,
+	/* The last requests failed, the next one is delayed */
+	RSERVER_BACKOFF,
+	/* Too many failures, the sensors of the server are stale */
+	RSERVER_DOWN
+};
+
+struct rserver_status {
+	/* Host name of the server */
+	const char *host;
+	enum rserver_state state;
+	/* Number of consecutive failed requests */
+	unsigned int failures;
+	/* Seconds before the next attempt, 0 if it is not delayed */
+	unsigned int retry_delay;
+};
+
 #if defined(HAVE_REMOTE_SUPPORT) && HAVE_REMOTE_SUPPORT
 
 static inline bool rsensor_is_supported(void) { return true; }
 
-struct psensor **get_remote_sensors(const char *, int);
+/*
+ * Returns the sensors of the psensor-servers of a null-terminated
+ * list of URLs. The sensors of a server which cannot be reached are
+ * created by the first update which succeeds and given to the
+ * callback of rsensor_set_sensors_cbk.
+ */
+struct psensor **get_remote_sensors(const char **, int);
+
+/*
+ * Sets the callback receiving the sensors created after the startup,
+ * it is called by remote_psensor_list_update.
+ */
+void rsensor_set_sensors_cbk(pdiscovery_cbk, void *data);
+
+/*
+ * Retrieves the last measures of the servers. It does not access the
+ * sensors and can be called without holding the sensors mutex, the
+ * measures are applied by remote_psensor_list_update.
+ */
+void rsensor_fetch(void);
 void remote_psensor_list_update(struct psensor **);
-void rsensor_init(void);
+
+/*
+ * Returns the status of the server of the remote sensor 's', false
+ * if it is not a remote sensor. It does not wait for a running fetch
+ * and can be called from the UI. The host name remains valid until
+ * rsensor_cleanup.
+ */
+bool rsensor_get_status(struct psensor *s, struct rserver_status *);
+
+/* Connection and total timeouts of the requests in milliseconds */
+void rsensor_init(long, long);
 void rsensor_cleanup(void);
 
 #else
@@ -35,9 +84,14 @@ void rsensor_cleanup(void);
 static inline bool rsensor_is_supported(void) { return false; }
 
 static inline struct psensor **
-get_remote_sensors(const char *url, int n) { return NULL; }
+get_remote_sensors(const char **urls, int n) { return NULL; }
+static inline void rsensor_set_sensors_cbk(pdiscovery_cbk cbk, void *data) {}
+static inline void rsensor_fetch(void) {}
 static inline void remote_psensor_list_update(struct psensor **s) {}
-static inline void rsensor_init(void) {}
+static inline bool
+rsensor_get_status(struct psensor *s, struct rserver_status *st)
+{ return false; }
+static inline void rsensor_init(long connect_timeout, long timeout) {}
 static inline void rsensor_cleanup(void) {}
 
 #endif
@@ -31,6 +31,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/select.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <getopt.h>
 #include <stdint.h>
@@ -43,14 +44,22 @@
 #include <pgtop2.h>
 #endif
 
+#include <cpustat.h>
 #include <hdd.h>
 #include <lmsensor.h>
+#include <pevent.h>
 #include <plog.h>
+#include <pmetrics.h>
 #include "psensor_json.h"
+#include <psensor_metrics.h>
 #include <pmutex.h>
+#include <ppush.h>
+#include <pshm.h>
+#include <psi.h>
 #include "url.h"
 #include "server.h"
 #include "slog.h"
+#include <thermal.h>
 
 static const char *DEFAULT_LOG_FILE = "/var/log/psensor-server.log";
 
@@ -73,6 +82,17 @@ static struct option long_options[] = {
 	{"log-file", required_argument, NULL, 'l'},
 	{"sensor-log-file", required_argument, NULL, 0},
 	{"sensor-log-interval", required_argument, NULL, 0},
+	{"sensor-log-format", required_argument, NULL, 0},
+	{"sensor-log-sync", required_argument, NULL, 0},
+	{"sensor-log-max-size", required_argument, NULL, 0},
+	{"sensor-log-daily", no_argument, NULL, 0},
+	{"sensor-log-keep", required_argument, NULL, 0},
+	{"sensor-log-compress", required_argument, NULL, 0},
+	{"history-dir", required_argument, NULL, 0},
+	{"shm", optional_argument, NULL, 0},
+	{"push", required_argument, NULL, 0},
+	{"push-format", required_argument, NULL, 0},
+	{"push-prefix", required_argument, NULL, 0},
 	{NULL, 0, NULL, 0}
 };
 
@@ -80,6 +100,20 @@ static struct server_data server_data;
 
 static pthread_mutex_t mutex;
 
+/*
+ * The page of the metrics is written after each update in
+ * 'metrics_next' which is then swapped with 'metrics'. A scrape only
+ * copies 'metrics' under 'metrics_mutex', it does not wait for the
+ * update of the sensors.
+ */
+static struct pbuf metrics_bufs[2];
+static struct pbuf *metrics = &metrics_bufs[0];
+static struct pbuf *metrics_next = &metrics_bufs[1];
+static pthread_mutex_t metrics_mutex;
+
+/* page of the API, reused by the requests which hold 'mutex' */
+static struct pbuf api_page;
+
 static int server_stop_requested;
 
 static void print_version(void)
@@ -116,6 +150,33 @@ static void print_help(void)
 	puts(_("  --sensor-log-file=PATH set the sensor log file to PATH"));
 	puts(_("  --sensor-log-interval=S "
 	       "set the sensor log interval to S (seconds)"));
+	puts(_("  --sensor-log-format=FORMAT "
+	       "set the sensor log format to csv or binary"));
+	puts(_("  --sensor-log-sync=POLICY "
+	       "sync the sensor log after each write: none, data\n"
+	       "			(fdatasync) or full (fsync)"));
+	puts(_("  --sensor-log-max-size=MB "
+	       "rotate the sensor log when it reaches MB megabytes"));
+	puts(_("  --sensor-log-daily     rotate the sensor log every day"));
+	puts(_("  --sensor-log-keep=N    "
+	       "keep N rotated sensor logs (default 10, 0 for all)"));
+	puts(_("  --sensor-log-compress=METHOD "
+	       "compress the rotated sensor logs: gzip\n"
+	       "			(default), zstd or none"));
+	puts(_("  --history-dir=DIR      "
+	       "keep the measures in DIR across the restarts"));
+	puts(_("  --shm[=PATH]           "
+	       "publish the current values in shared memory\n"
+	       "			(default: /dev/shm/psensor)"));
+	puts(_("  --push=URL             "
+	       "push the values at each update to URL:\n"
+	       "			udp://HOST[:PORT] or tcp://HOST[:PORT]"));
+	puts(_("  --push-format=FORMAT   "
+	       "format of the push: statsd (default),\n"
+	       "			graphite or influx"));
+	puts(_("  --push-prefix=PREFIX   "
+	       "prefix of the pushed metrics\n"
+	       "			(default: psensor)"));
 
 	puts("");
 	printf(_("Report bugs to: %s\n"), PACKAGE_BUGREPORT);
@@ -158,20 +219,67 @@ file_reader(void *cls, uint64_t pos, char *buf, int max)
 	return fread(buf, 1, max, file);
 }
 
+/* Must be called with the sensors locked. */
+static void metrics_update(void)
+{
+	struct pmetrics w;
+	struct pbuf *tmp;
+
+	pbuf_reset(metrics_next);
+	pmetrics_init(&w, metrics_next);
+
+	psensors_to_metrics(&w, server_data.sensors);
+#ifdef HAVE_GTOP
+	sysinfo_to_metrics(&w, &server_data.psysinfo);
+#endif
+
+	/* the previous page is kept */
+	if (metrics_next->err)
+		return;
+
+	pmutex_lock(&metrics_mutex);
+	tmp = metrics;
+	metrics = metrics_next;
+	metrics_next = tmp;
+	pmutex_unlock(&metrics_mutex);
+}
+
+static struct MHD_Response *create_response_metrics(unsigned int *rp_code)
+{
+	struct MHD_Response *resp;
+
+	pmutex_lock(&metrics_mutex);
+	resp = MHD_create_response_from_buffer(metrics->len,
+					       metrics->data,
+					       MHD_RESPMEM_MUST_COPY);
+	pmutex_unlock(&metrics_mutex);
+
+	MHD_add_response_header(resp,
+				MHD_HTTP_HEADER_CONTENT_TYPE,
+				PMETRICS_CONTENT_TYPE);
+
+	*rp_code = MHD_HTTP_OK;
+
+	return resp;
+}
+
 static struct MHD_Response *
 create_response_api(const char *nurl, const char *method, unsigned int *rp_code)
 {
 	struct MHD_Response *resp;
 	struct psensor *s;
-	char *page = NULL;
+
+	pbuf_reset(&api_page);
 
 	if (!strcmp(nurl, URL_BASE_API_1_1_SENSORS))  {
-		page = sensors_to_json_string(server_data.sensors);
+		sensors_json_append(&api_page, server_data.sensors);
+	} else if (!strcmp(nurl, URL_API_1_1_LAST_MEASURES)) {
+		last_measures_json_append(&api_page, server_data.sensors);
 #ifdef HAVE_GTOP
 	} else if (!strcmp(nurl, URL_API_1_1_SYSINFO)) {
-		page = sysinfo_to_json_string(&server_data.psysinfo);
+		sysinfo_json_append(&api_page, &server_data.psysinfo);
 	} else if (!strcmp(nurl, URL_API_1_1_CPU_USAGE)) {
-		page = sensor_to_json_string(server_data.cpu_usage);
+		sensor_json_append(&api_page, server_data.cpu_usage);
 #endif
 	} else if (!strncmp(nurl, URL_BASE_API_1_1_SENSORS,
 			    strlen(URL_BASE_API_1_1_SENSORS))
@@ -182,20 +290,22 @@ create_response_api(const char *nurl, const char *method, unsigned int *rp_code)
 		s = psensor_list_get_by_id(server_data.sensors, sid);
 
 		if (s)
-			page = sensor_to_json_string(s);
+			sensor_json_append(&api_page, s);
 
 	} else if (!strcmp(nurl, URL_API_1_1_SERVER_STOP)) {
 
 		server_stop_requested = 1;
-		page = strdup(HTML_STOP_REQUESTED);
+		pevent_wakeup();
+		pbuf_append_str(&api_page, HTML_STOP_REQUESTED);
 	}
 
-	if (page) {
+	if (api_page.len && !api_page.err) {
 		*rp_code = MHD_HTTP_OK;
 
-		resp = MHD_create_response_from_buffer(strlen(page),
-						       page,
-						       MHD_RESPMEM_MUST_FREE);
+		/* copied, the page is reused once 'mutex' is released */
+		resp = MHD_create_response_from_buffer(api_page.len,
+						       api_page.data,
+						       MHD_RESPMEM_MUST_COPY);
 
 		MHD_add_response_header(resp, MHD_HTTP_HEADER_CONTENT_TYPE,
 					"application/json");
@@ -340,9 +450,13 @@ static enum MHD_Result cbk_http_request(void *cls,
 
 	nurl = url_normalize(url);
 
-	pmutex_lock(&mutex);
-	response = create_response(nurl, method, &resp_code);
-	pmutex_unlock(&mutex);
+	if (!strcmp(nurl, URL_METRICS)) {
+		response = create_response_metrics(&resp_code);
+	} else {
+		pmutex_lock(&mutex);
+		response = create_response(nurl, method, &resp_code);
+		pmutex_unlock(&mutex);
+	}
 
 	ret = MHD_queue_response(connection, resp_code, response);
 	MHD_destroy_response(response);
@@ -357,6 +471,12 @@ int main(int argc, char *argv[])
 	struct MHD_Daemon *d;
 	int port, opti, optc, cmdok, ret, slog_interval;
 	char *log_file, *slog_file;
+	enum slog_format slog_format;
+	enum slog_sync slog_sync;
+	struct slog_rotation slog_rotation;
+	const char *oname, *history_dir, *shm_path, *push_url, *push_prefix;
+	enum ppush_format push_format;
+	bool shm;
 
 	program_name = argv[0];
 
@@ -374,6 +494,18 @@ int main(int argc, char *argv[])
 	log_file = NULL;
 	slog_file = NULL;
 	slog_interval = 300;
+	slog_format = SLOG_FORMAT_CSV;
+	slog_sync = SLOG_SYNC_NONE;
+	history_dir = NULL;
+	shm = false;
+	shm_path = NULL;
+	push_url = NULL;
+	push_format = PPUSH_FORMAT_STATSD;
+	push_prefix = NULL;
+	slog_rotation.max_size = 0;
+	slog_rotation.daily = false;
+	slog_rotation.keep = 10;
+	slog_rotation.compression = SLOG_COMPRESSION_GZIP;
 	port = DEFAULT_PORT;
 	cmdok = 1;
 
@@ -411,6 +543,42 @@ int main(int argc, char *argv[])
 			else if (!strcmp(long_options[opti].name,
 					 "sensor-log-interval"))
 				slog_interval = atoi(optarg);
+			else if (!strcmp(long_options[opti].name,
+					 "sensor-log-format")
+				 && !slog_format_from_str(optarg,
+							  &slog_format))
+				cmdok = 0;
+			else if (!strcmp(long_options[opti].name,
+					 "sensor-log-sync")
+				 && !slog_sync_from_str(optarg, &slog_sync))
+				cmdok = 0;
+
+			oname = long_options[opti].name;
+			if (!strcmp(oname, "sensor-log-max-size"))
+				slog_rotation.max_size
+					= (off_t)atoi(optarg) * 1024 * 1024;
+			else if (!strcmp(oname, "sensor-log-daily"))
+				slog_rotation.daily = true;
+			else if (!strcmp(oname, "sensor-log-keep"))
+				slog_rotation.keep = atoi(optarg);
+			else if (!strcmp(oname, "sensor-log-compress")
+				 && !slog_compression_from_str
+					(optarg, &slog_rotation.compression))
+				cmdok = 0;
+			else if (!strcmp(oname, "history-dir"))
+				history_dir = optarg;
+			else if (!strcmp(oname, "shm")) {
+				shm = true;
+				shm_path = optarg;
+			} else if (!strcmp(oname, "push")) {
+				push_url = optarg;
+			} else if (!strcmp(oname, "push-format")) {
+				if (!ppush_format_from_str(optarg,
+							   &push_format))
+					cmdok = 0;
+			} else if (!strcmp(oname, "push-prefix")) {
+				push_prefix = optarg;
+			}
 			break;
 		default:
 			cmdok = 0;
@@ -437,13 +605,25 @@ int main(int argc, char *argv[])
 		log_file = strdup(DEFAULT_LOG_FILE);
 
 	pmutex_init(&mutex);
+	pmutex_init(&metrics_mutex);
 
 	log_open(log_file);
 
+	if (history_dir)
+		psensor_set_history_dir(history_dir);
+
+	hwmon_disk_psensor_list_append(&server_data.sensors, 600);
+
 	hddtemp_psensor_list_append(&server_data.sensors, 600);
 
 	lmsensor_psensor_list_append(&server_data.sensors, 600);
 
+	thermal_psensor_list_append(&server_data.sensors, 600);
+
+	cpustat_psensor_list_append(&server_data.sensors, 600);
+
+	psi_psensor_list_append(&server_data.sensors, 600);
+
 #ifdef HAVE_GTOP
 	server_data.cpu_usage = create_cpu_usage_sensor(600);
 #endif
@@ -451,6 +631,17 @@ int main(int argc, char *argv[])
 	if (!server_data.sensors || !*server_data.sensors)
 		log_err(_("No sensors detected."));
 
+	/*
+	 * The API serves the history of the previous run immediately:
+	 * 600 measures, updated every 5 seconds.
+	 */
+	if (slog_file && server_data.sensors) {
+		slog_set_format(slog_format);
+		slog_load_history(slog_file,
+				  server_data.sensors,
+				  time(NULL) - 600 * 5);
+	}
+
 	d = MHD_start_daemon(MHD_USE_THREAD_PER_CONNECTION,
 			     port,
 			     NULL, NULL, &cbk_http_request, server_data.sensors,
@@ -467,6 +658,9 @@ int main(int argc, char *argv[])
 	if (slog_file) {
 		if (slog_interval <= 0)
 			slog_interval = 300;
+		slog_set_format(slog_format);
+		slog_set_sync(slog_sync);
+		slog_set_rotation(&slog_rotation);
 		ret = slog_activate(slog_file,
 				    server_data.sensors,
 				    &mutex,
@@ -475,7 +669,16 @@ int main(int argc, char *argv[])
 			log_err(_("Failed to activate logging of sensors."));
 	}
 
+	if (shm)
+		pshm_open(shm_path);
+
+	if (push_url && !ppush_open(push_url, push_format, push_prefix))
+		log_err(_("Failed to activate the push of the sensors."));
+
 	while (!server_stop_requested) {
+		/* done without the mutex, the daemon may be slow */
+		hddtemp_fetch();
+
 		pmutex_lock(&mutex);
 
 #ifdef HAVE_GTOP
@@ -489,15 +692,31 @@ int main(int argc, char *argv[])
 
 		hddtemp_psensor_list_update(server_data.sensors);
 
+		hwmon_disk_psensor_list_update(server_data.sensors);
+
 		lmsensor_psensor_list_update(server_data.sensors);
 
+		thermal_psensor_list_update(server_data.sensors);
+
+		cpustat_psensor_list_update(server_data.sensors);
+
+		psi_psensor_list_update(server_data.sensors);
+
 		psensor_log_measures(server_data.sensors);
 
+		pshm_publish(server_data.sensors);
+
+		metrics_update();
+
+		ppush_send(server_data.sensors);
+
 		pmutex_unlock(&mutex);
-		sleep(5);
+		pevent_wait(5000);
 	}
 
 	slog_close();
+	pshm_close();
+	ppush_close();
 
 	MHD_stop_daemon(d);
 
@@ -507,6 +726,9 @@ int main(int argc, char *argv[])
 	psensor_free(server_data.cpu_usage);
 #endif
 	free(server_data.www_dir);
+	pbuf_free(&metrics_bufs[0]);
+	pbuf_free(&metrics_bufs[1]);
+	pbuf_free(&api_page);
 	lmsensor_cleanup();
 
 #ifdef HAVE_GTOP
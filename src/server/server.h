@@ -32,6 +32,8 @@
 #define URL_API_1_1_SERVER_STOP "/api/1.1/server/stop"
 #define URL_API_1_1_SYSINFO "/api/1.1/sysinfo"
 #define URL_API_1_1_CPU_USAGE "/api/1.1/cpu/usage"
+#define URL_API_1_1_LAST_MEASURES "/api/1.1/last_measures"
+#define URL_METRICS "/metrics"
 
 struct server_data {
 	struct psensor *cpu_usage;
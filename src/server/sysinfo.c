@@ -23,11 +23,7 @@
 
 #include "config.h"
 
-#ifdef HAVE_JSON_0
-#include <json/json.h>
-#else
-#include <json-c/json.h>
-#endif
+#include <pjson.h>
 
 #include "sysinfo.h"
 
@@ -73,112 +69,203 @@ void sysinfo_cleanup(void)
 		g_free(cpu);
 }
 
-static json_object *ram_to_json_object(const struct psysinfo *s)
+static void ram_to_json(struct pjson *w, const struct psysinfo *s)
 {
-	json_object *obj = json_object_new_object();
+	pjson_object_begin(w);
 
-	json_object_object_add(obj, "total",
-			       json_object_new_double(s->mem.total));
+	pjson_key(w, "total");
+	pjson_double(w, s->mem.total);
 
-	json_object_object_add(obj, "free",
-			       json_object_new_double(s->mem.free));
+	pjson_key(w, "free");
+	pjson_double(w, s->mem.free);
 
-	json_object_object_add(obj, "shared",
-			       json_object_new_double(s->mem.shared));
+	pjson_key(w, "shared");
+	pjson_double(w, s->mem.shared);
 
-	json_object_object_add(obj, "buffer",
-			       json_object_new_double(s->mem.buffer));
+	pjson_key(w, "buffer");
+	pjson_double(w, s->mem.buffer);
 
-	return obj;
+	pjson_object_end(w);
 }
 
-static json_object *swap_to_json_object(const struct psysinfo *s)
+static void swap_to_json(struct pjson *w, const struct psysinfo *s)
 {
-	json_object *obj = json_object_new_object();
+	pjson_object_begin(w);
 
-	json_object_object_add(obj, "total",
-			       json_object_new_double(s->swap.total));
+	pjson_key(w, "total");
+	pjson_double(w, s->swap.total);
 
-	json_object_object_add(obj, "free",
-			       json_object_new_double(s->swap.free));
+	pjson_key(w, "free");
+	pjson_double(w, s->swap.free);
 
-	return obj;
+	pjson_object_end(w);
 }
 
-static json_object *netif_to_json_object(const char *netif)
+static void netif_to_json(struct pjson *w, const char *netif)
 {
 	glibtop_netload buf;
-	json_object *obj = json_object_new_object();
 
-	json_object_object_add(obj, "name", json_object_new_string(netif));
+	pjson_object_begin(w);
+
+	pjson_key(w, "name");
+	pjson_string(w, netif);
 
 	glibtop_get_netload(&buf, netif);
 
-	json_object_object_add(obj, "bytes_in",
-			       json_object_new_double(buf.bytes_in));
+	pjson_key(w, "bytes_in");
+	pjson_double(w, buf.bytes_in);
 
-	json_object_object_add(obj, "bytes_out",
-			       json_object_new_double(buf.bytes_out));
+	pjson_key(w, "bytes_out");
+	pjson_double(w, buf.bytes_out);
 
-	return obj;
+	pjson_object_end(w);
 }
 
-static json_object *net_to_json_object(const struct psysinfo *s)
+static void net_to_json(struct pjson *w, const struct psysinfo *s)
 {
 	char **netif = s->interfaces;
-	json_object *net = json_object_new_array();
+
+	pjson_array_begin(w);
 
 	while (*netif) {
-		json_object_array_add(net, netif_to_json_object(*netif));
+		netif_to_json(w, *netif);
 
 		netif++;
 	}
 
-	return net;
+	pjson_array_end(w);
 }
 
-static json_object *sysinfo_to_json_object(const struct psysinfo *s)
+void sysinfo_json_append(struct pbuf *b, const struct psysinfo *s)
 {
-	json_object *obj;
+	struct pjson w;
+
+	pjson_init(&w, b);
+
+	pjson_object_begin(&w);
+
+	pjson_key(&w, "load");
+	pjson_double(&w, s->cpu_rate);
+
+	pjson_key(&w, "load_1");
+	pjson_double(&w, s->loadavg.loadavg[0]);
 
-	obj = json_object_new_object();
+	pjson_key(&w, "load_5");
+	pjson_double(&w, s->loadavg.loadavg[1]);
 
-	json_object_object_add(obj, "load",
-			       json_object_new_double(s->cpu_rate));
+	pjson_key(&w, "load_15");
+	pjson_double(&w, s->loadavg.loadavg[2]);
 
-	json_object_object_add
-		(obj, "load_1",
-		 json_object_new_double(s->loadavg.loadavg[0]));
+	pjson_key(&w, "uptime");
+	pjson_double(&w, s->uptime.uptime);
 
-	json_object_object_add
-		(obj, "load_5",
-		 json_object_new_double(s->loadavg.loadavg[1]));
+	pjson_key(&w, "mem_unit");
+	pjson_double(&w, 1);
 
-	json_object_object_add
-		(obj, "load_15",
-		 json_object_new_double(s->loadavg.loadavg[2]));
+	pjson_key(&w, "ram");
+	ram_to_json(&w, s);
 
-	json_object_object_add
-		(obj, "uptime", json_object_new_double(s->uptime.uptime));
+	pjson_key(&w, "swap");
+	swap_to_json(&w, s);
 
-	json_object_object_add
-		(obj, "mem_unit", json_object_new_double(1));
+	pjson_key(&w, "net");
+	net_to_json(&w, s);
 
-	json_object_object_add(obj, "ram", ram_to_json_object(s));
-	json_object_object_add(obj, "swap", swap_to_json_object(s));
-	json_object_object_add(obj, "net", net_to_json_object(s));
+	pjson_object_end(&w);
+}
 
-	return obj;
+static void gauge(struct pmetrics *w,
+		  const char *name,
+		  const char *help,
+		  double value)
+{
+	pmetrics_family(w, name, "gauge", help);
+	pmetrics_sample(w, name, value);
 }
 
-char *sysinfo_to_json_string(const struct psysinfo *s)
+static void net_to_metrics(struct pmetrics *w, const struct psysinfo *s)
 {
-	char *str;
-	json_object *obj = sysinfo_to_json_object(s);
+	glibtop_netload *loads;
+	char **netif;
+	int i, n;
+
+	for (n = 0, netif = s->interfaces; *netif; netif++)
+		n++;
+
+	if (!n)
+		return;
+
+	/* each family lists its samples together */
+	loads = malloc(n * sizeof(*loads));
+	for (i = 0; i < n; i++)
+		glibtop_get_netload(&loads[i], s->interfaces[i]);
+
+	pmetrics_family(w,
+			"psensor_network_receive_bytes_total",
+			"counter",
+			"Bytes received by the network interface.");
+	for (i = 0; i < n; i++) {
+		pmetrics_sample_begin(w, "psensor_network_receive_bytes_total");
+		pmetrics_label(w, "interface", s->interfaces[i]);
+		pmetrics_sample_end(w, loads[i].bytes_in);
+	}
 
-	str = strdup(json_object_to_json_string(obj));
+	pmetrics_family(w,
+			"psensor_network_transmit_bytes_total",
+			"counter",
+			"Bytes sent by the network interface.");
+	for (i = 0; i < n; i++) {
+		pmetrics_sample_begin(w,
+				      "psensor_network_transmit_bytes_total");
+		pmetrics_label(w, "interface", s->interfaces[i]);
+		pmetrics_sample_end(w, loads[i].bytes_out);
+	}
 
-	json_object_put(obj);
+	free(loads);
+}
 
-	return str;
+void sysinfo_to_metrics(struct pmetrics *w, const struct psysinfo *s)
+{
+	gauge(w, "psensor_cpu_usage_ratio", "CPU usage.", s->cpu_rate);
+
+	gauge(w, "psensor_load1", "1m load average.", s->loadavg.loadavg[0]);
+	gauge(w, "psensor_load5", "5m load average.", s->loadavg.loadavg[1]);
+	gauge(w,
+	      "psensor_load15",
+	      "15m load average.",
+	      s->loadavg.loadavg[2]);
+
+	gauge(w,
+	      "psensor_uptime_seconds",
+	      "Time since the boot.",
+	      s->uptime.uptime);
+
+	gauge(w,
+	      "psensor_memory_total_bytes",
+	      "Total RAM.",
+	      s->mem.total);
+	gauge(w,
+	      "psensor_memory_free_bytes",
+	      "Free RAM.",
+	      s->mem.free);
+	gauge(w,
+	      "psensor_memory_shared_bytes",
+	      "Shared RAM.",
+	      s->mem.shared);
+	gauge(w,
+	      "psensor_memory_buffer_bytes",
+	      "RAM used by the buffers.",
+	      s->mem.buffer);
+
+	gauge(w,
+	      "psensor_swap_total_bytes",
+	      "Total swap space.",
+	      s->swap.total);
+	gauge(w,
+	      "psensor_swap_free_bytes",
+	      "Free swap space.",
+	      s->swap.free);
+
+	if (s->interfaces)
+		net_to_metrics(w, s);
 }
@@ -25,6 +25,9 @@
 #include <glibtop/swap.h>
 #include <glibtop/uptime.h>
 
+#include <pbuf.h>
+#include <pmetrics.h>
+
 struct psysinfo {
 	glibtop_loadavg loadavg;
 	glibtop_mem mem;
@@ -39,6 +42,7 @@ struct psysinfo {
 void sysinfo_update(struct psysinfo *sysinfo);
 void sysinfo_cleanup(void);
 
-char *sysinfo_to_json_string(const struct psysinfo *sysinfo);
+void sysinfo_json_append(struct pbuf *b, const struct psysinfo *sysinfo);
+void sysinfo_to_metrics(struct pmetrics *w, const struct psysinfo *sysinfo);
 
 #endif
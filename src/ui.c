@@ -409,20 +409,27 @@ void ui_enable_alpha_channel(struct ui_psensor *ui)
 	}
 }
 
-static void slog_enabled_cbk(void *data)
+void ui_slog_activate(struct ui_psensor *ui)
 {
-	struct ui_psensor *ui;
-	struct psensor **sensors;
-	pthread_mutex_t *mutex;
+	struct slog_rotation rotation;
 
-	ui = (struct ui_psensor *)data;
-	sensors = ui->sensors;
-	mutex = &ui->sensors_mutex;
+	slog_set_format(config_get_slog_format());
+	slog_set_sync(config_get_slog_sync());
+	config_get_slog_rotation(&rotation);
+	slog_set_rotation(&rotation);
 
+	slog_activate(NULL,
+		      ui->sensors,
+		      &ui->sensors_mutex,
+		      config_get_slog_interval());
+}
+
+static void slog_enabled_cbk(void *data)
+{
 	log_debug("slog_enabled_cbk");
 
 	if (is_slog_enabled())
-		slog_activate(NULL, sensors, mutex, config_get_slog_interval());
+		ui_slog_activate(data);
 	else
 		slog_close();
 }
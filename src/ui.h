@@ -71,6 +71,9 @@ void ui_psensor_quit(struct ui_psensor *ui);
 /* Creates the main GTK window */
 void ui_window_create(struct ui_psensor *ui);
 
+/* Starts the sensor log with the settings of the configuration. */
+void ui_slog_activate(struct ui_psensor *ui);
+
 void ui_menu_bar_show(unsigned int show, struct ui_psensor *ui);
 
 void ui_enable_alpha_channel(struct ui_psensor *ui);
@@ -217,6 +217,8 @@ static void update_label(struct ui_psensor *ui)
 				str = "999UUU";
 			else if ((*p)->type & SENSOR_TYPE_RPM)
 				str = "999UUU";
+			else if ((*p)->type & SENSOR_TYPE_FREQUENCY)
+				str = "9999UUU";
 			else /* percent */
 				str = "999%";
 
@@ -95,6 +95,7 @@ void ui_pref_dialog_run(struct ui_psensor *ui)
 		*w_hide_on_startup, *w_win_restore, *w_slog_enabled,
 		*w_autostart, *w_smooth_curves, *w_atiadlsdk, *w_lmsensors,
 		*w_nvctrl, *w_gtop2, *w_hddtemp, *w_libatasmart, *w_udisks2,
+		*w_hwmon_disk, *w_thermal, *w_cpustat, *w_psi,
 		*w_decoration, *w_keep_below;
 	GtkComboBoxText *w_temp_unit;
 	GtkEntry *w_notif_script;
@@ -239,6 +240,11 @@ void ui_pref_dialog_run(struct ui_psensor *ui)
 		gtk_widget_set_has_tooltip(GTK_WIDGET(w_lmsensors), TRUE);
 	}
 
+	w_thermal
+		= GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder,
+							   "thermal"));
+	gtk_toggle_button_set_active(w_thermal, config_is_thermal_enabled());
+
 	w_nvctrl
 		= GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder,
 							   "nvctrl"));
@@ -278,6 +284,20 @@ void ui_pref_dialog_run(struct ui_psensor *ui)
 
 	gtk_toggle_button_set_active(w_gtop2, config_is_gtop2_enabled());
 
+	w_cpustat
+		= GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder,
+							   "cpustat"));
+	gtk_toggle_button_set_active(w_cpustat, config_is_cpustat_enabled());
+
+	w_psi = GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder, "psi"));
+	gtk_toggle_button_set_active(w_psi, config_is_psi_enabled());
+
+	w_hwmon_disk
+		= GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder,
+							   "hwmon_disk"));
+	gtk_toggle_button_set_active(w_hwmon_disk,
+				     config_is_hwmon_disk_enabled());
+
 	w_hddtemp
 		= GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder,
 							   "hddtemp"));
@@ -376,6 +396,9 @@ void ui_pref_dialog_run(struct ui_psensor *ui)
 		config_set_lmsensor_enable
 			(gtk_toggle_button_get_active(w_lmsensors));
 
+		config_set_thermal_enable
+			(gtk_toggle_button_get_active(w_thermal));
+
 		config_set_nvctrl_enable
 			(gtk_toggle_button_get_active(w_nvctrl));
 
@@ -385,6 +408,15 @@ void ui_pref_dialog_run(struct ui_psensor *ui)
 		config_set_gtop2_enable
 			(gtk_toggle_button_get_active(w_gtop2));
 
+		config_set_cpustat_enable
+			(gtk_toggle_button_get_active(w_cpustat));
+
+		config_set_psi_enable
+			(gtk_toggle_button_get_active(w_psi));
+
+		config_set_hwmon_disk_enable
+			(gtk_toggle_button_get_active(w_hwmon_disk));
+
 		config_set_hddtemp_enable
 			(gtk_toggle_button_get_active(w_hddtemp));
 
@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include <cfg.h>
+#include <rsensor.h>
 #include <ui.h>
 #include <ui_color.h>
 #include <ui_pref.h>
@@ -369,6 +370,69 @@ void ui_sensorlist_cb_graph_toggled(GtkCellRendererToggle *cell,
 	}
 }
 
+/* Gives the state of the server of a remote sensor. */
+static gboolean query_tooltip_cbk(GtkWidget *widget,
+				  gint x,
+				  gint y,
+				  gboolean keyboard,
+				  GtkTooltip *tooltip,
+				  gpointer data)
+{
+	GtkTreeView *view;
+	GtkTreeModel *model;
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	struct psensor *s;
+	struct rserver_status st;
+	char *str;
+
+	view = GTK_TREE_VIEW(widget);
+
+	if (!gtk_tree_view_get_tooltip_context(view,
+					       &x,
+					       &y,
+					       keyboard,
+					       &model,
+					       &path,
+					       &iter))
+		return FALSE;
+
+	gtk_tree_model_get(model, &iter, COL_SENSOR, &s, -1);
+
+	if (!(s->type & SENSOR_TYPE_REMOTE) || !rsensor_get_status(s, &st)) {
+		gtk_tree_path_free(path);
+		return FALSE;
+	}
+
+	switch (st.state) {
+	case RSERVER_UP:
+		str = g_strdup_printf(_("%s: connected"), st.host);
+		break;
+	case RSERVER_BACKOFF:
+		str = g_strdup_printf
+			(_("%s: %u failure(s), next attempt in %us"),
+			 st.host,
+			 st.failures,
+			 st.retry_delay);
+		break;
+	default:
+		str = g_strdup_printf
+			(_("%s: not reachable, %u failure(s), "
+			   "next attempt in %us"),
+			 st.host,
+			 st.failures,
+			 st.retry_delay);
+	}
+
+	gtk_tooltip_set_text(tooltip, str);
+	gtk_tree_view_set_tooltip_row(view, tooltip, path);
+
+	g_free(str);
+	gtk_tree_path_free(path);
+
+	return TRUE;
+}
+
 void ui_sensorlist_create(struct ui_psensor *ui)
 {
 	GtkTreeModel *fmodel, *model;
@@ -385,6 +449,10 @@ void ui_sensorlist_create(struct ui_psensor *ui)
 	g_signal_connect(ui->sensors_tree,
 			 "button-press-event", (GCallback)clicked_cbk, ui);
 
+	gtk_widget_set_has_tooltip(GTK_WIDGET(ui->sensors_tree), TRUE);
+	g_signal_connect(ui->sensors_tree,
+			 "query-tooltip", (GCallback)query_tooltip_cbk, ui);
+
 	ui_sensorlist_update(ui, 1);
 
 	log_functionname_exit();
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+/*
+ * Compares the parsing and matching of the hddtemp output with the
+ * previous implementation which allocated the device names and
+ * searched the sensors list for each record.
+ *
+ * Usage: bench-hddtemp [DISKS [ITERATIONS]]
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <hdd.h>
+#include <pindex.h>
+#include <psensor.h>
+
+static char *create_output(int n)
+{
+	char *out, *c;
+	int i;
+
+	out = malloc(n * 64 + 1);
+	c = out;
+	for (i = 0; i < n; i++)
+		c += sprintf(c, "|/dev/sd%c%c|BENCH DISK %d|%d|C|",
+			     'a' + i / 26 % 26, 'a' + i % 26, i, 30 + i % 20);
+
+	return out;
+}
+
+static struct psensor **create_sensors(const char *out, struct pindex *idx)
+{
+	struct psensor **sensors;
+	struct hddtemp_record r;
+	char *name, *id;
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	while ((out = hddtemp_parse_next(out, &r))) {
+		name = strndup(r.name, r.name_len);
+		if (asprintf(&id, "hddtemp %s", name) == -1)
+			exit(EXIT_FAILURE);
+
+		psensor_list_append(&sensors,
+				    psensor_create(id,
+						   name,
+						   NULL,
+						   SENSOR_TYPE_HDDTEMP
+						   | SENSOR_TYPE_TEMP,
+						   10));
+		pindex_add(idx, name, sensors[psensor_list_size(sensors) - 1]);
+	}
+
+	return sensors;
+}
+
+/* Previous implementation, see git history of hdd_hddtemp.c */
+static void update_previous(struct psensor **sensors, const char *out)
+{
+	struct hddtemp_record r;
+	struct psensor **cur;
+	char *name;
+
+	while ((out = hddtemp_parse_next(out, &r))) {
+		name = malloc(r.name_len + 1);
+		strncpy(name, r.name, r.name_len);
+		name[r.name_len] = '\0';
+
+		for (cur = sensors; *cur; cur++)
+			if ((*cur)->type & SENSOR_TYPE_HDDTEMP
+			    && !strcmp((*cur)->id + 8, name))
+				psensor_set_current_value(*cur, r.temp);
+
+		free(name);
+	}
+}
+
+static void update_index(struct pindex *idx, const char *out)
+{
+	struct hddtemp_record r;
+	struct psensor *s;
+
+	while ((out = hddtemp_parse_next(out, &r))) {
+		s = pindex_getn(idx, r.name, r.name_len);
+		if (s && r.temp_valid)
+			psensor_set_current_value(s, r.temp);
+	}
+}
+
+static double elapsed(struct timespec *t0, struct timespec *t1)
+{
+	return (t1->tv_sec - t0->tv_sec)
+		+ (t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	struct psensor **sensors;
+	struct pindex idx;
+	struct timespec t0, t1, t2;
+	double t_previous, t_index;
+	int n, iterations, i;
+	char *out;
+
+	n = argc > 1 ? atoi(argv[1]) : 200;
+	iterations = argc > 2 ? atoi(argv[2]) : 1000;
+
+	out = create_output(n);
+
+	pindex_init(&idx);
+	sensors = create_sensors(out, &idx);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < iterations; i++)
+		update_previous(sensors, out);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (i = 0; i < iterations; i++)
+		update_index(&idx, out);
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	t_previous = elapsed(&t0, &t1) / iterations;
+	t_index = elapsed(&t1, &t2) / iterations;
+
+	printf("%d disks, %zu bytes, %d iterations\n",
+	       n, strlen(out), iterations);
+	printf("list search:    %10.3f us\n", t_previous * 1e6);
+	printf("index:          %10.3f us\n", t_index * 1e6);
+	printf("speedup:        %10.2fx\n", t_previous / t_index);
+
+	pindex_cleanup(&idx);
+	psensor_list_free(sensors);
+	free(out);
+
+	exit(EXIT_SUCCESS);
+}
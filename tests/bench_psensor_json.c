@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+/*
+ * Compares the streaming JSON writer used by sensors_to_json_string
+ * with the previous json-c object tree serialization.
+ *
+ * Usage: bench-psensor-json [SENSORS [ITERATIONS]]
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/lib/psensor_json.h"
+
+static json_object *jsonc_measure(struct measure *m)
+{
+	json_object *o = json_object_new_object();
+
+	json_object_object_add(o, "value", json_object_new_double(m->value));
+	json_object_object_add(o, "time",
+			       json_object_new_int((m->time).tv_sec));
+	return o;
+}
+
+static json_object *jsonc_sensor(struct psensor *s)
+{
+	json_object *obj, *ms;
+	unsigned int i;
+
+	obj = json_object_new_object();
+
+	json_object_object_add(obj, "id", json_object_new_string(s->id));
+	json_object_object_add(obj, "name", json_object_new_string(s->name));
+	json_object_object_add(obj, "type", json_object_new_int(s->type));
+	json_object_object_add(obj, "min",
+			       json_object_new_double(s->sess_lowest));
+	json_object_object_add(obj, "max",
+			       json_object_new_double(s->sess_highest));
+
+	ms = json_object_new_array();
+	for (i = 0; i < s->values_max_length; i++)
+		if (s->measures[i].time.tv_sec)
+			json_object_array_add(ms, jsonc_measure(&s->measures[i]));
+	json_object_object_add(obj, "measures", ms);
+
+	json_object_object_add(obj, "last_measure",
+			       jsonc_measure(psensor_get_current_measure(s)));
+
+	return obj;
+}
+
+static char *jsonc_sensors_to_json_string(struct psensor **sensors)
+{
+	json_object *obj;
+	char *str;
+
+	obj = json_object_new_array();
+	for (; *sensors; sensors++)
+		json_object_array_add(obj, jsonc_sensor(*sensors));
+
+	str = strdup(json_object_to_json_string(obj));
+	json_object_put(obj);
+
+	return str;
+}
+
+static struct psensor **create_sensors(int n)
+{
+	struct psensor **sensors;
+	struct timeval tv;
+	char *id;
+	int i, j;
+
+	sensors = malloc((n + 1) * sizeof(struct psensor *));
+
+	for (i = 0; i < n; i++) {
+		if (asprintf(&id, "lmsensor bench-isa-0000 temp%d", i) == -1)
+			exit(EXIT_FAILURE);
+
+		sensors[i] = psensor_create(id,
+					    strdup(id),
+					    NULL,
+					    SENSOR_TYPE_LMSENSOR
+					    | SENSOR_TYPE_TEMP,
+					    600);
+
+		for (j = 0; j < 600; j++) {
+			tv.tv_sec = 1400000000 + 5 * j;
+			tv.tv_usec = 0;
+			psensor_set_current_measure(sensors[i],
+						    30 + (i + j) % 40 / 4.0,
+						    tv);
+		}
+	}
+	sensors[n] = NULL;
+
+	return sensors;
+}
+
+static double elapsed(struct timespec *t0, struct timespec *t1)
+{
+	return (t1->tv_sec - t0->tv_sec)
+		+ (t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static double bench(char *(*fct)(struct psensor **),
+		    struct psensor **sensors,
+		    int iterations,
+		    size_t *len)
+{
+	struct timespec t0, t1;
+	char *str;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < iterations; i++) {
+		str = fct(sensors);
+		*len = strlen(str);
+		free(str);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return elapsed(&t0, &t1) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+	struct psensor **sensors;
+	int n, iterations;
+	char *ref, *str;
+	double t_jsonc, t_writer;
+	size_t len;
+
+	n = argc > 1 ? atoi(argv[1]) : 50;
+	iterations = argc > 2 ? atoi(argv[2]) : 100;
+
+	sensors = create_sensors(n);
+
+	ref = jsonc_sensors_to_json_string(sensors);
+	str = sensors_to_json_string(sensors);
+	if (strcmp(ref, str)) {
+		fprintf(stderr, "FAILURE: outputs differ\n");
+		exit(EXIT_FAILURE);
+	}
+	free(ref);
+	free(str);
+
+	t_jsonc = bench(jsonc_sensors_to_json_string, sensors, iterations,
+			&len);
+	t_writer = bench(sensors_to_json_string, sensors, iterations, &len);
+
+	printf("%d sensors, %zu bytes, %d iterations\n", n, len, iterations);
+	printf("json-c tree:    %10.3f ms\n", t_jsonc * 1000);
+	printf("stream writer:  %10.3f ms\n", t_writer * 1000);
+	printf("speedup:        %10.2fx\n", t_jsonc / t_writer);
+
+	psensor_list_free(sensors);
+
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+/*
+ * Measures the time range queries of the sensor log reader on a
+ * generated binary log, compared to a decoding of the whole log as
+ * done without index.
+ *
+ * Usage: bench-slogread [MB [SENSORS [QUERIES]]]
+ *
+ * The log is written in $TMPDIR (or /tmp), several GB are needed to
+ * bench the reading of a log bigger than the page cache.
+ */
+#define _GNU_SOURCE
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <measure.h>
+#include <slogfile.h>
+#include <slogfmt.h>
+#include <slogread.h>
+
+#define T0 1451606400
+
+static unsigned int seed = 42;
+
+static unsigned int next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+static double elapsed(struct timespec *t0, struct timespec *t1)
+{
+	return (t1->tv_sec - t0->tv_sec)
+		+ (t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+/* Writes a log of 'size' bytes, returns the number of records. */
+static long create_log(const char *path, off_t size, int n)
+{
+	struct slog_encoder e;
+	struct slog_header h;
+	struct timeval t;
+	struct pbuf b;
+	double *values;
+	off_t written;
+	long k;
+	FILE *f;
+	int i;
+
+	f = fopen(path, "w");
+	if (!f) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+
+	h.start = T0;
+	h.version = "bench";
+	h.n = n;
+	h.ids = malloc(n * sizeof(char *));
+	h.types = malloc(n * sizeof(unsigned int));
+	values = malloc(n * sizeof(double));
+
+	for (i = 0; i < n; i++) {
+		if (asprintf(&h.ids[i], "lmsensor bench temp%d", i) == -1)
+			exit(EXIT_FAILURE);
+		h.types[i] = 0x101;
+		values[i] = 40;
+	}
+
+	pbuf_init(&b, 1 << 20);
+	slog_encoder_init(&e, SLOG_FORMAT_BINARY);
+	slog_encode_header(&e, &b, &h);
+
+	written = 0;
+	t.tv_usec = 0;
+	for (k = 0; written + (off_t)b.len < size; k++) {
+		/* a third of the values change at each record */
+		for (i = 0; i < n; i++)
+			if (next_rand() % 3 == 0)
+				values[i] += next_rand() % 2 ? 0.5 : -0.5;
+
+		t.tv_sec = T0 + k;
+		slog_encode_record(&e, &b, &t, values);
+
+		if (b.len >= 1 << 20) {
+			fwrite(b.data, 1, b.len, f);
+			written += b.len;
+			pbuf_reset(&b);
+		}
+	}
+
+	fwrite(b.data, 1, b.len, f);
+	fclose(f);
+
+	for (i = 0; i < n; i++)
+		free(h.ids[i]);
+	free(h.ids);
+	free(h.types);
+	free(values);
+	slog_encoder_free(&e);
+	pbuf_free(&b);
+
+	return k;
+}
+
+/* Query without index: decodes the whole log. */
+static size_t query_scan(struct slog_segment *s,
+			 const char *id,
+			 time_t t1,
+			 time_t t2)
+{
+	struct slog_decoder d;
+	enum slog_entry entry;
+	size_t n, i, col;
+
+	slog_decoder_init(&d, s->data, s->len);
+
+	n = 0;
+	col = 0;
+	while ((entry = slog_decoder_next(&d)) != SLOG_ENTRY_END
+	       && entry != SLOG_ENTRY_ERROR) {
+		if (entry == SLOG_ENTRY_HEADER) {
+			for (i = 0; i < d.header.n; i++)
+				if (!strcmp(d.header.ids[i], id))
+					col = i;
+		} else if (d.time.tv_sec >= t1
+			   && d.time.tv_sec <= t2
+			   && d.values[col] != UNKNOWN_DOUBLE_VALUE) {
+			n++;
+		}
+	}
+
+	slog_decoder_free(&d);
+
+	return n;
+}
+
+int main(int argc, char **argv)
+{
+	struct slog_reader *r;
+	struct slog_sample *samples;
+	struct timespec t0, t1;
+	double t_scan, t_build, t_load, t_query, t_down;
+	const char *dir;
+	char *log, *idx;
+	long mb, records;
+	int n, queries, i;
+	size_t len, scan_len;
+	time_t start;
+
+	mb = argc > 1 ? atol(argv[1]) : 256;
+	n = argc > 2 ? atoi(argv[2]) : 16;
+	queries = argc > 3 ? atoi(argv[3]) : 1000;
+
+	dir = getenv("TMPDIR");
+	if (!dir)
+		dir = "/tmp";
+
+	if (asprintf(&log, "%s/bench-slogread-%d.log", dir, getpid()) == -1)
+		exit(EXIT_FAILURE);
+	idx = slog_index_path(log);
+
+	records = create_log(log, (off_t)mb * 1024 * 1024, n);
+
+	/* build of the index, then load of the saved index */
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	r = slog_reader_open(log, 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	t_build = elapsed(&t0, &t1);
+
+	if (!r) {
+		unlink(log);
+		exit(EXIT_FAILURE);
+	}
+	slog_reader_close(r);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	r = slog_reader_open(log, 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	t_load = elapsed(&t0, &t1);
+
+	/* one hour of a sensor */
+	start = T0 + records / 2;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	scan_len = query_scan(&r->segments[0],
+			      "lmsensor bench temp0",
+			      start,
+			      start + 3599);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	t_scan = elapsed(&t0, &t1);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < queries; i++) {
+		start = T0 + ((long)next_rand() << 15 | next_rand()) % records;
+
+		samples = slog_reader_query(r,
+					    "lmsensor bench temp0",
+					    start,
+					    start + 3599,
+					    0,
+					    &len);
+		free(samples);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	t_query = elapsed(&t0, &t1) / queries;
+
+	/* whole log, one sample per day */
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	samples = slog_reader_query(r,
+				    "lmsensor bench temp0",
+				    0,
+				    LONG_MAX,
+				    86400,
+				    &len);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	t_down = elapsed(&t0, &t1);
+	free(samples);
+
+	printf("%ld MB, %d sensors, %ld records, %zu index entries\n",
+	       mb, n, records, r->segments[0].index_n);
+	printf("scan (1 hour):    %10.3f ms, %zu values\n",
+	       t_scan * 1e3, scan_len);
+	printf("index build:      %10.3f ms\n", t_build * 1e3);
+	printf("index load:       %10.3f ms\n", t_load * 1e3);
+	printf("query (1 hour):   %10.3f ms\n", t_query * 1e3);
+	printf("query (daily):    %10.3f ms, %zu samples\n",
+	       t_down * 1e3, len);
+	printf("speedup:          %10.2fx\n", t_scan / t_query);
+
+	slog_reader_close(r);
+
+	unlink(log);
+	unlink(idx);
+	free(log);
+	free(idx);
+
+	exit(EXIT_SUCCESS);
+}
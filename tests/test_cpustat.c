@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cpustat.h>
+#include <psensor.h>
+
+static char root[] = "/tmp/psensor-test-cpustat-XXXXXX";
+
+static void mk(const char *path)
+{
+	char p[512];
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	if (mkdir(p, 0700)) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void wr(const char *path, const char *content)
+{
+	char p[512];
+	FILE *f;
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	f = fopen(p, "w");
+	if (!f) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(f, "%s\n", content);
+	fclose(f);
+}
+
+static const char *STAT_0 =
+	"cpu  400 20 200 3000 100 0 10 0 0 0\n"
+	"cpu0 100 10 50 1000 50 0 5 0 0 0\n"
+	"cpu1 300 10 150 2000 50 0 5 0 0 0\n"
+	"cpu3 100 0 0 100\n"
+	"intr 12345 0 0\n"
+	"ctxt 67890\n";
+
+/* cpu0: +60 busy, +40 idle; cpu1: +10 busy, +90 idle */
+static const char *STAT_1 =
+	"cpu  470 20 230 3130 100 0 10 0 0 0\n"
+	"cpu0 140 10 60 1030 60 0 15 0 0 0\n"
+	"cpu1 305 10 155 2090 50 0 5 0 0 0\n"
+	"cpu3 100 0 0 100\n"
+	"intr 12346 0 0\n"
+	"ctxt 67891\n";
+
+/* cpu0 and cpu1 are online, only cpu0 has cpufreq, cpu2 is offline */
+static void create_tree(void)
+{
+	mk("proc");
+	wr("proc/stat", STAT_0);
+
+	mk("sys");
+	mk("sys/devices");
+	mk("sys/devices/system");
+	mk("sys/devices/system/cpu");
+	mk("sys/devices/system/cpu/cpu0");
+	mk("sys/devices/system/cpu/cpu0/cpufreq");
+	wr("sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "2400000");
+	mk("sys/devices/system/cpu/cpu1");
+}
+
+static int rm(const char *path, const struct stat *st, int flag, struct FTW *f)
+{
+	return remove(path);
+}
+
+static struct psensor *get(struct psensor **sensors, const char *id)
+{
+	for (; *sensors; sensors++)
+		if (!strcmp((*sensors)->id, id))
+			return *sensors;
+
+	fprintf(stderr, "sensor not found: %s\n", id);
+
+	return NULL;
+}
+
+static int check(struct psensor **sensors, const char *id, double value)
+{
+	struct psensor *s;
+	double v;
+
+	s = get(sensors, id);
+	if (!s)
+		return 1;
+
+	v = psensor_get_current_value(s);
+	if (v != value) {
+		fprintf(stderr, "%s: value: %f expected: %f\n", id, v, value);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct psensor **sensors;
+	int errs;
+
+	if (!mkdtemp(root)) {
+		perror(root);
+		exit(EXIT_FAILURE);
+	}
+
+	create_tree();
+
+	cpustat_set_root(root);
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	cpustat_psensor_list_append(&sensors, 10);
+
+	errs = 0;
+
+	/* cpu0 usage and frequency, cpu1 usage, cpu3 usage */
+	if (psensor_list_size(sensors) != 4) {
+		fprintf(stderr, "returns %zu sensors, expected: 4\n",
+			psensor_list_size(sensors));
+		errs++;
+	}
+
+	wr("proc/stat", STAT_1);
+	wr("sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "1200000");
+
+	cpustat_psensor_list_update(sensors);
+
+	errs += check(sensors, "cpustat cpu0 usage", 60);
+	errs += check(sensors, "cpustat cpu1 usage", 10);
+	errs += check(sensors, "cpustat cpu0 freq", 1200);
+
+	/* no change of the counters, no measure */
+	cpustat_psensor_list_update(sensors);
+	errs += check(sensors, "cpustat cpu0 usage", 60);
+	if (psensor_get_current_value(get(sensors, "cpustat cpu3 usage"))
+	    != UNKNOWN_DOUBLE_VALUE) {
+		fprintf(stderr, "cpu3: unexpected measure\n");
+		errs++;
+	}
+
+	psensor_list_free(sensors);
+
+	cpustat_set_root(NULL);
+
+	nftw(root, rm, 8, FTW_DEPTH | FTW_PHYS);
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <hdd.h>
+#include <psensor.h>
+
+static char root[] = "/tmp/psensor-test-hwmon-XXXXXX";
+
+static void mk(const char *path)
+{
+	char p[512];
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	if (mkdir(p, 0700)) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void wr(const char *path, const char *content)
+{
+	char p[512];
+	FILE *f;
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	f = fopen(p, "w");
+	if (!f) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(f, "%s\n", content);
+	fclose(f);
+}
+
+static void ln(const char *target, const char *path)
+{
+	char p[512];
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	if (symlink(target, p)) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* A SATA disk (drivetemp), a NVMe drive and a CPU sensor. */
+static void create_sysfs(void)
+{
+	mk("class");
+	mk("class/hwmon");
+	mk("devices");
+
+	mk("devices/target0:0:0");
+	mk("devices/target0:0:0/0:0:0:0");
+	mk("devices/target0:0:0/0:0:0:0/block");
+	mk("devices/target0:0:0/0:0:0:0/block/sda");
+	wr("devices/target0:0:0/0:0:0:0/model", "ST3500418AS     ");
+	mk("class/hwmon/hwmon0");
+	wr("class/hwmon/hwmon0/name", "drivetemp");
+	wr("class/hwmon/hwmon0/temp1_input", "38000");
+	wr("class/hwmon/hwmon0/temp1_crit", "70000");
+	ln("../../../devices/target0:0:0/0:0:0:0", "class/hwmon/hwmon0/device");
+
+	mk("devices/nvme0");
+	mk("devices/nvme0/nvme0n1");
+	mk("devices/nvme0/hwmon1");
+	wr("devices/nvme0/model", "Samsung SSD 970");
+	mk("class/hwmon/hwmon1");
+	wr("class/hwmon/hwmon1/name", "nvme");
+	wr("class/hwmon/hwmon1/temp1_input", "45850");
+	wr("class/hwmon/hwmon1/temp1_label", "Composite");
+	wr("class/hwmon/hwmon1/temp1_alarm", "0");
+	wr("class/hwmon/hwmon1/temp2_input", "50850");
+	wr("class/hwmon/hwmon1/temp2_label", "Sensor 1");
+	ln("../../../devices/nvme0", "class/hwmon/hwmon1/device");
+
+	mk("class/hwmon/hwmon2");
+	wr("class/hwmon/hwmon2/name", "coretemp");
+	wr("class/hwmon/hwmon2/temp1_input", "55000");
+}
+
+static int rm(const char *path, const struct stat *st, int flag, struct FTW *f)
+{
+	return remove(path);
+}
+
+static struct psensor *get(struct psensor **sensors, const char *id)
+{
+	for (; *sensors; sensors++)
+		if (!strcmp((*sensors)->id, id))
+			return *sensors;
+
+	fprintf(stderr, "sensor not found: %s\n", id);
+
+	return NULL;
+}
+
+static int check(struct psensor **sensors,
+		 const char *id,
+		 const char *name,
+		 double value)
+{
+	struct psensor *s;
+	double v;
+
+	s = get(sensors, id);
+	if (!s)
+		return 1;
+
+	if (strcmp(s->name, name)) {
+		fprintf(stderr, "%s: name: %s expected: %s\n",
+			id, s->name, name);
+		return 1;
+	}
+
+	v = psensor_get_current_value(s);
+	if (v != value) {
+		fprintf(stderr, "%s: value: %f expected: %f\n", id, v, value);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct psensor **sensors;
+	int errs;
+
+	if (!mkdtemp(root)) {
+		perror(root);
+		exit(EXIT_FAILURE);
+	}
+
+	create_sysfs();
+
+	hwmon_disk_set_sysfs_root(root);
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	hwmon_disk_psensor_list_append(&sensors, 10);
+
+	errs = 0;
+
+	if (psensor_list_size(sensors) != 3) {
+		fprintf(stderr, "returns %zu sensors, expected: 3\n",
+			psensor_list_size(sensors));
+		errs++;
+	}
+
+	hwmon_disk_psensor_list_update(sensors);
+
+	errs += check(sensors, "hwmon /dev/sda", "/dev/sda", 38);
+	errs += check(sensors,
+		      "hwmon /dev/nvme0n1 1", "/dev/nvme0n1 Composite", 45.85);
+	errs += check(sensors,
+		      "hwmon /dev/nvme0n1 2", "/dev/nvme0n1 Sensor 1", 50.85);
+
+	if (get(sensors, "hwmon /dev/sda")->max != 70) {
+		fprintf(stderr, "wrong max of /dev/sda\n");
+		errs++;
+	}
+
+	if (strcmp(get(sensors, "hwmon /dev/sda")->chip, "ST3500418AS")) {
+		fprintf(stderr, "wrong model of /dev/sda\n");
+		errs++;
+	}
+
+	/* the attributes are read again through the opened files */
+	wr("class/hwmon/hwmon0/temp1_input", "39000");
+	hwmon_disk_psensor_list_update(sensors);
+	errs += check(sensors, "hwmon /dev/sda", "/dev/sda", 39);
+
+	if (!hwmon_disk_has_device(sensors, "/dev/sda")
+	    || hwmon_disk_has_device(sensors, "/dev/sdb")) {
+		fprintf(stderr, "hwmon_disk_has_device failure\n");
+		errs++;
+	}
+
+	if (!hwmon_disk_has_hwmon(sensors, "/sys/class/hwmon/hwmon1")
+	    || hwmon_disk_has_hwmon(sensors, "/sys/class/hwmon/hwmon2")) {
+		fprintf(stderr, "hwmon_disk_has_hwmon failure\n");
+		errs++;
+	}
+
+	psensor_list_free(sensors);
+
+	nftw(root, rm, 8, FTW_DEPTH | FTW_PHYS);
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <hdd.h>
+#include <psensor.h>
+
+/*
+ * Output sent by the stub daemon for each connection, NULL to never
+ * answer.
+ */
+static const char *reply;
+
+static void *stub_server(void *data)
+{
+	int sfd, fd;
+	char c;
+
+	sfd = *(int *)data;
+
+	while ((fd = accept(sfd, NULL, NULL)) != -1) {
+		if (reply) {
+			if (write(fd, reply, strlen(reply)) == -1)
+				perror("stub server");
+		} else {
+			/* waits for the client to give up */
+			while (read(fd, &c, 1) > 0)
+				;
+		}
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+static int stub_server_start(unsigned int *port)
+{
+	struct sockaddr_in addr;
+	socklen_t len;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+
+	len = sizeof(addr);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr))
+	    || listen(fd, 4)
+	    || getsockname(fd, (struct sockaddr *)&addr, &len)) {
+		perror("stub server");
+		exit(EXIT_FAILURE);
+	}
+
+	*port = ntohs(addr.sin_port);
+
+	return fd;
+}
+
+static int check_value(struct psensor **sensors, int i, double ref)
+{
+	double v;
+
+	v = psensor_get_current_value(sensors[i]);
+	if (v != ref) {
+		fprintf(stderr, "%s: returns: %f expected: %f\n",
+			sensors[i]->id, v, ref);
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * A disk found again after a restart is given to its sensor restored
+ * from the cache, which is then updated in place of the new one.
+ */
+static int test_adopt(unsigned int port)
+{
+	struct psensor **found, *monitored[2], *cached;
+	int errs;
+
+	/* no delay after the failure of the previous test */
+	hddtemp_set_server("127.0.0.1", port, 300);
+
+	reply = "|/dev/sda|ST3500418AS|38|C||/dev/sdc|ST1000DM003|35|C|";
+
+	cached = psensor_create(strdup("hddtemp /dev/sdc"),
+				strdup("/dev/sdc"),
+				NULL,
+				SENSOR_TYPE_HDD_TEMP,
+				10);
+
+	found = malloc(sizeof(struct psensor *));
+	*found = NULL;
+
+	/* /dev/sda is already known */
+	hddtemp_psensor_list_append(&found, 10);
+
+	if (psensor_list_size(found) != 1) {
+		fprintf(stderr, "adopt: returns %zu sensors, expected: 1\n",
+			psensor_list_size(found));
+		psensor_list_free(found);
+		psensor_free(cached);
+		return 1;
+	}
+
+	psensor_adopt(cached, found[0]);
+	free(found);
+
+	monitored[0] = cached;
+	monitored[1] = NULL;
+
+	reply = "|/dev/sda|ST3500418AS|38|C||/dev/sdc|ST1000DM003|36|C|";
+
+	hddtemp_fetch();
+	hddtemp_psensor_list_update(monitored);
+
+	errs = check_value(monitored, 0, 36);
+
+	psensor_free(cached);
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	struct psensor **sensors, *empty;
+	struct timeval t0, t1;
+	pthread_t thread;
+	unsigned int port;
+	long elapsed;
+	int sfd, errs;
+
+	sfd = stub_server_start(&port);
+	pthread_create(&thread, NULL, stub_server, &sfd);
+
+	hddtemp_set_server("127.0.0.1", port, 300);
+
+	errs = 0;
+
+	reply = "|/dev/sda|ST3500418AS|38|C||/dev/sdb|WDC WD10EARS|41|C|";
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	hddtemp_psensor_list_append(&sensors, 10);
+
+	if (psensor_list_size(sensors) != 2) {
+		fprintf(stderr, "returns %zu sensors, expected: 2\n",
+			psensor_list_size(sensors));
+		exit(EXIT_FAILURE);
+	}
+
+	if (strcmp(sensors[0]->name, "/dev/sda")
+	    || strcmp(sensors[1]->name, "/dev/sdb")) {
+		fprintf(stderr, "wrong sensor names: %s %s\n",
+			sensors[0]->name, sensors[1]->name);
+		errs++;
+	}
+
+	reply = "|/dev/sda|ST3500418AS|39|C||/dev/sdb|WDC WD10EARS|42|C|";
+
+	/* not monitored yet, e.g. while their history is loaded */
+	empty = NULL;
+	hddtemp_fetch();
+	hddtemp_psensor_list_update(&empty);
+
+	errs += check_value(sensors, 0, UNKNOWN_DOUBLE_VALUE);
+	errs += check_value(sensors, 1, UNKNOWN_DOUBLE_VALUE);
+
+	hddtemp_fetch();
+	hddtemp_psensor_list_update(sensors);
+
+	errs += check_value(sensors, 0, 39);
+	errs += check_value(sensors, 1, 42);
+
+	/* a daemon which does not answer must not block the fetch */
+	reply = NULL;
+
+	gettimeofday(&t0, NULL);
+	hddtemp_fetch();
+	gettimeofday(&t1, NULL);
+
+	elapsed = (t1.tv_sec - t0.tv_sec) * 1000
+		+ (t1.tv_usec - t0.tv_usec) / 1000;
+	if (elapsed > 1000) {
+		fprintf(stderr, "fetch took %ldms, expected: 300ms\n",
+			elapsed);
+		errs++;
+	}
+
+	hddtemp_psensor_list_update(sensors);
+
+	errs += check_value(sensors, 0, 39);
+	errs += check_value(sensors, 1, 42);
+
+	errs += test_adopt(port);
+
+	close(sfd);
+	psensor_list_free(sensors);
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
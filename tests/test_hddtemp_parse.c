@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <hdd.h>
+
+/* Small deterministic generator so that failures can be replayed. */
+static unsigned int seed = 42;
+
+static unsigned int next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+static int check_record(const char *name,
+			const struct hddtemp_record *r,
+			const char *ref_name,
+			bool ref_valid,
+			int ref_temp)
+{
+	if (r->name_len != strlen(ref_name)
+	    || strncmp(r->name, ref_name, r->name_len)
+	    || r->temp_valid != ref_valid
+	    || (ref_valid && r->temp != ref_temp)) {
+		fprintf(stderr, "%s: returns: %.*s %d %d expected: %s %d %d\n",
+			name,
+			(int)r->name_len, r->name, r->temp_valid, r->temp,
+			ref_name, ref_valid, ref_temp);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_valid(void)
+{
+	const char *str, *c;
+	struct hddtemp_record r;
+	int errs;
+
+	str = "|/dev/sda|ST3500418AS|38|C|"
+		"|/dev/sdb|WDC WD10EARS|SLP|*|"
+		"|/dev/sdc||-5|C|";
+
+	errs = 0;
+
+	c = hddtemp_parse_next(str, &r);
+	errs += check_record("valid", &r, "/dev/sda", true, 38);
+
+	c = hddtemp_parse_next(c, &r);
+	errs += check_record("sleeping", &r, "/dev/sdb", false, 0);
+
+	c = hddtemp_parse_next(c, &r);
+	errs += check_record("negative", &r, "/dev/sdc", true, -5);
+
+	if (!c || *c || hddtemp_parse_next(c, &r)) {
+		fprintf(stderr, "end of output not detected\n");
+		errs++;
+	}
+
+	if (hddtemp_parse_next("|/dev/sda|ST3500418AS|38|C", &r)) {
+		fprintf(stderr, "truncated record accepted\n");
+		errs++;
+	}
+
+	if (hddtemp_parse_next("/dev/sda|ST3500418AS|38|C|", &r)) {
+		fprintf(stderr, "record without leading pipe accepted\n");
+		errs++;
+	}
+
+	return errs;
+}
+
+/*
+ * Parses the whole buffer and checks that the records stay within
+ * it, returns the number of errors.
+ */
+static int parse_all(const char *buf, size_t len)
+{
+	const char *c, *prev, *end;
+	struct hddtemp_record r;
+
+	end = buf + len;
+	c = buf;
+	for (;;) {
+		prev = c;
+		c = hddtemp_parse_next(c, &r);
+		if (!c)
+			return 0;
+
+		if (c <= prev || c > end
+		    || r.name < prev || r.name + r.name_len > end) {
+			fprintf(stderr, "fuzz: out of bounds record, seed %u\n",
+				seed);
+			return 1;
+		}
+	}
+}
+
+static int test_fuzz(void)
+{
+	static const char alphabet[] = "||||/devsa0123456789-CFNASLP* \n";
+	const char *valid;
+	char buf[257];
+	size_t len, vlen, i;
+	int errs, iter;
+
+	valid = "|/dev/sda|ST3500418AS|38|C||/dev/sdb|WDC WD10EARS|41|C|";
+	vlen = strlen(valid);
+
+	errs = 0;
+	for (iter = 0; iter < 200000 && !errs; iter++) {
+		if (iter % 2) {
+			/* random string over the significant characters */
+			len = next_rand() % (sizeof(buf) - 1);
+			for (i = 0; i < len; i++)
+				buf[i] = alphabet[next_rand()
+						  % (sizeof(alphabet) - 1)];
+		} else {
+			/* truncated and mutated valid output */
+			len = next_rand() % (vlen + 1);
+			memcpy(buf, valid, len);
+			for (i = next_rand() % 4; i > 0 && len; i--)
+				buf[next_rand() % len] = next_rand() % 256;
+			len = strnlen(buf, len);
+		}
+		buf[len] = '\0';
+
+		errs += parse_all(buf, len);
+	}
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	int errs;
+
+	errs = test_valid();
+	errs += test_fuzz();
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <pdiscovery.h>
+#include <psensor.h>
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int calls;
+static bool all_done;
+static int errs;
+
+static struct psensor *create(const char *id)
+{
+	return psensor_create(strdup(id),
+			      strdup(id),
+			      strdup("chip"),
+			      SENSOR_TYPE_TEMP,
+			      1);
+}
+
+static bool has(struct psensor **sensors, const char *id)
+{
+	return psensor_list_get_by_id(sensors, id) != NULL;
+}
+
+static void fast_append(struct psensor ***sensors, unsigned int n)
+{
+	/* the seed is visible to the providers */
+	if (!has(*sensors, "seed"))
+		errs++;
+
+	psensor_list_append(sensors, create("fast"));
+}
+
+static void slow_append(struct psensor ***sensors, unsigned int n)
+{
+	struct timespec t = {0, 300000000};
+
+	nanosleep(&t, NULL);
+
+	psensor_list_append(sensors, create("slow"));
+}
+
+static void after_append(struct psensor ***sensors, unsigned int n)
+{
+	/* runs after slow_append on the same list */
+	if (has(*sensors, "slow"))
+		psensor_list_append(sensors, create("after"));
+}
+
+static void empty_append(struct psensor ***sensors, unsigned int n)
+{
+}
+
+static void cbk(const char *name, struct psensor **sensors, void *data)
+{
+	size_t n;
+
+	n = psensor_list_size(sensors);
+
+	if (has(sensors, "seed")) {
+		fprintf(stderr, "%s: seed in the result\n", name);
+		errs++;
+	}
+
+	if (!strcmp(name, "fast") && (n != 1 || !has(sensors, "fast"))) {
+		fprintf(stderr, "%s: wrong result\n", name);
+		errs++;
+	}
+
+	if (!strcmp(name, "slow")
+	    && (n != 2 || !has(sensors, "slow") || !has(sensors, "after"))) {
+		fprintf(stderr, "%s: wrong result\n", name);
+		errs++;
+	}
+
+	if (!strcmp(name, "empty") && n) {
+		fprintf(stderr, "%s: wrong result\n", name);
+		errs++;
+	}
+
+	psensor_list_free(sensors);
+
+	pthread_mutex_lock(&mutex);
+	calls++;
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&mutex);
+}
+
+static void done(void *data)
+{
+	pthread_mutex_lock(&mutex);
+	if (calls != 3) {
+		fprintf(stderr, "done before the providers\n");
+		errs++;
+	}
+	all_done = true;
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&mutex);
+}
+
+int main(int argc, char **argv)
+{
+	struct pdiscovery_provider providers[] = {
+		{"fast", fast_append, NULL, 1000},
+		{"slow", slow_append, after_append, 100},
+		{"empty", empty_append, NULL, 1000}
+	};
+	struct psensor **seed;
+	struct timespec t;
+
+	seed = malloc(sizeof(struct psensor *));
+	*seed = NULL;
+	psensor_list_append(&seed, create("seed"));
+
+	pdiscovery_start(providers, 3, seed, 1, cbk, done, NULL);
+
+	clock_gettime(CLOCK_REALTIME, &t);
+	t.tv_sec += 10;
+
+	pthread_mutex_lock(&mutex);
+	while (!all_done)
+		if (pthread_cond_timedwait(&cond, &mutex, &t))
+			break;
+	pthread_mutex_unlock(&mutex);
+
+	if (calls != 3 || !all_done) {
+		fprintf(stderr, "calls: %d expected: 3\n", calls);
+		errs++;
+	}
+
+	psensor_list_free(seed);
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <pevent.h>
+
+static int calls;
+
+static bool cbk(int fd, short revents, void *data)
+{
+	char c;
+
+	c = 0;
+	if (read(fd, &c, 1) == 1)
+		calls++;
+
+	if (c == 'w')
+		pevent_wakeup();
+
+	/* stops watching the file on 'q' */
+	return c != 'q';
+}
+
+static double now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int put(int fd, char c)
+{
+	if (write(fd, &c, 1) != 1) {
+		perror("write");
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int p[2], errs;
+	double t;
+
+	errs = 0;
+
+	/* nothing pending: the timeout expires */
+	t = now();
+	if (pevent_wait(100) || now() - t < 0.09) {
+		fprintf(stderr, "pevent_wait: timeout expected\n");
+		errs++;
+	}
+
+	if (pipe(p)) {
+		perror("pipe");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!pevent_add(p[0], POLLIN, cbk, NULL)) {
+		fprintf(stderr, "pevent_add failure\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* the callback wakes up the waiting thread */
+	errs += put(p[1], 'w');
+	t = now();
+	if (!pevent_wait(10000) || now() - t > 5) {
+		fprintf(stderr, "pevent_wait: wakeup expected\n");
+		errs++;
+	}
+
+	errs += put(p[1], 'q');
+	while (calls < 2 && now() - t < 5)
+		usleep(1000);
+
+	/* not watched anymore */
+	errs += put(p[1], 'w');
+	if (pevent_wait(200) || calls != 2) {
+		fprintf(stderr, "calls: %d expected: 2\n", calls);
+		errs++;
+	}
+
+	pevent_remove(p[0]);
+
+	close(p[0]);
+	close(p[1]);
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
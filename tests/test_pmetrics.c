@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <locale.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <pmetrics.h>
+#include <psensor_metrics.h>
+
+static int check(const char *name, struct pbuf *b, const char *expected)
+{
+	if (b->err || strcmp(b->data, expected)) {
+		fprintf(stderr, "%s:\n%s\nexpected:\n%s\n",
+			name, b->data, expected);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_format(void)
+{
+	struct pbuf b;
+	struct pmetrics w;
+	int errs;
+
+	pbuf_init(&b, 0);
+	pmetrics_init(&w, &b);
+
+	pmetrics_family(&w, "m", "gauge", "a \\ help\nline");
+	pmetrics_sample(&w, "m", 1);
+	pmetrics_sample_begin(&w, "m");
+	pmetrics_label(&w, "a", "x\"y\\z\n");
+	pmetrics_label(&w, "b", NULL);
+	pmetrics_sample_end(&w, 0.5);
+	pmetrics_sample(&w, "m", -INFINITY);
+
+	errs = check("format", &b,
+		     "# HELP m a \\\\ help\\nline\n"
+		     "# TYPE m gauge\n"
+		     "m 1.0\n"
+		     "m{a=\"x\\\"y\\\\z\\n\",b=\"\"} 0.5\n"
+		     "m -Inf\n");
+
+	pbuf_free(&b);
+
+	return errs;
+}
+
+static int test_sensors(void)
+{
+	struct psensor *sensors[3];
+	struct timeval t;
+	struct pbuf b;
+	struct pmetrics w;
+	int errs;
+
+	sensors[0] = psensor_create(strdup("lmsensor chip temp1"),
+				    strdup("Core 0"),
+				    strdup("coretemp"),
+				    SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP,
+				    2);
+	sensors[1] = psensor_create(strdup("unknown"),
+				    strdup("unknown"),
+				    NULL,
+				    SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_RPM,
+				    2);
+	sensors[2] = NULL;
+
+	t.tv_sec = 1000;
+	t.tv_usec = 500000;
+	psensor_set_current_measure(sensors[0], 42.5, t);
+
+	pbuf_init(&b, 0);
+	pmetrics_init(&w, &b);
+	psensors_to_metrics(&w, sensors);
+
+	/* the sensor without value is skipped */
+	errs = check("sensors", &b,
+		     "# HELP psensor_sensor_value "
+		     "Current value of the sensor.\n"
+		     "# TYPE psensor_sensor_value gauge\n"
+		     "psensor_sensor_value{id=\"lmsensor chip temp1\","
+		     "name=\"Core 0\",chip=\"coretemp\","
+		     "type=\"Temperature\"} 42.5\n"
+		     "# HELP psensor_sensor_last_update_seconds "
+		     "Time of the current value of the sensor.\n"
+		     "# TYPE psensor_sensor_last_update_seconds gauge\n"
+		     "psensor_sensor_last_update_seconds"
+		     "{id=\"lmsensor chip temp1\","
+		     "name=\"Core 0\",chip=\"coretemp\","
+		     "type=\"Temperature\"} 1000.5\n");
+
+	/* the buffer is reused */
+	pbuf_reset(&b);
+	psensors_to_metrics(&w, sensors + 1);
+	errs += check("empty", &b,
+		      "# HELP psensor_sensor_value "
+		      "Current value of the sensor.\n"
+		      "# TYPE psensor_sensor_value gauge\n"
+		      "# HELP psensor_sensor_last_update_seconds "
+		      "Time of the current value of the sensor.\n"
+		      "# TYPE psensor_sensor_last_update_seconds gauge\n");
+
+	pbuf_free(&b);
+	psensor_free(sensors[0]);
+	psensor_free(sensors[1]);
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	int failures;
+
+	/* the decimal separator does not depend on the locale */
+	setlocale(LC_ALL, "fr_FR.UTF-8");
+
+	failures = test_format();
+	failures += test_sensors();
+
+	if (failures)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <pbuf.h>
+#include <ppush.h>
+
+#define N_SENSORS 100
+
+static struct psensor *sensors[N_SENSORS + 1];
+
+static void create_sensors(void)
+{
+	struct timeval t;
+	char *id;
+	int i;
+
+	t.tv_sec = 1000;
+	t.tv_usec = 500000;
+
+	sensors[0] = psensor_create(strdup("lmsensor coretemp-isa-0000 Core 0"),
+				    strdup("Core 0"),
+				    strdup("coretemp"),
+				    SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP,
+				    2);
+	psensor_set_current_measure(sensors[0], 42.5, t);
+
+	/* without value */
+	sensors[1] = psensor_create(strdup("unknown"),
+				    strdup("unknown"),
+				    NULL,
+				    SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_RPM,
+				    2);
+
+	for (i = 2; i < N_SENSORS; i++) {
+		if (asprintf(&id, "hwmon disk sd%d temperature", i) == -1)
+			exit(EXIT_FAILURE);
+		sensors[i] = psensor_create(id,
+					    strdup("disk"),
+					    NULL,
+					    SENSOR_TYPE_HDD_TEMP,
+					    2);
+		psensor_set_current_measure(sensors[i], i, t);
+	}
+	sensors[N_SENSORS] = NULL;
+}
+
+static int check(const char *name, const char *s, const char *expected)
+{
+	if (strcmp(s, expected)) {
+		fprintf(stderr, "%s:\n%s\nexpected:\n%s\n",
+			name, s, expected);
+		return 1;
+	}
+
+	return 0;
+}
+
+static struct psensor *create_with_value(const char *id, double v)
+{
+	struct psensor *s;
+	struct timeval t;
+
+	t.tv_sec = 1000;
+	t.tv_usec = 0;
+
+	s = psensor_create(strdup(id),
+			   strdup(id),
+			   NULL,
+			   SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP,
+			   2);
+	psensor_set_current_measure(s, v, t);
+
+	return s;
+}
+
+static int test_encode(void)
+{
+	struct psensor *ss[5];
+	struct pbuf b;
+	int errs;
+
+	ss[0] = sensors[0];
+	ss[1] = sensors[1];
+	/* not representable, skipped */
+	ss[2] = create_with_value("nan", NAN);
+	ss[3] = create_with_value("inf", INFINITY);
+	ss[4] = NULL;
+
+	pbuf_init(&b, 0);
+
+	ppush_encode(&b, PPUSH_FORMAT_STATSD, "psensor", ss);
+	errs = check("statsd", b.data,
+		     "psensor.lmsensor_coretemp-isa-0000_Core_0:42.5|g\n");
+
+	pbuf_reset(&b);
+	ppush_encode(&b, PPUSH_FORMAT_GRAPHITE, "", ss);
+	errs += check("graphite", b.data,
+		      "lmsensor_coretemp-isa-0000_Core_0 42.5 1000\n");
+
+	pbuf_reset(&b);
+	ppush_encode(&b, PPUSH_FORMAT_INFLUX, "sensors", ss);
+	errs += check("influx", b.data,
+		      "sensors,id=lmsensor\\ coretemp-isa-0000\\ Core\\ 0,"
+		      "name=Core\\ 0,chip=coretemp,type=Temperature "
+		      "value=42.5 1000500000000\n");
+
+	pbuf_free(&b);
+	psensor_free(ss[2]);
+	psensor_free(ss[3]);
+
+	return errs;
+}
+
+/* Creates a socket bound to a free port of the loopback. */
+static int create_listener(int type, char **url)
+{
+	struct sockaddr_in sa;
+	socklen_t len;
+	int fd;
+
+	fd = socket(AF_INET, type, 0);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	len = sizeof(sa);
+	if (bind(fd, (struct sockaddr *)&sa, len)
+	    || getsockname(fd, (struct sockaddr *)&sa, &len)
+	    || (type == SOCK_STREAM && listen(fd, 1))
+	    || asprintf(url,
+			"%s://127.0.0.1:%d",
+			type == SOCK_STREAM ? "tcp" : "udp",
+			ntohs(sa.sin_port)) == -1) {
+		perror("listener");
+		exit(EXIT_FAILURE);
+	}
+
+	return fd;
+}
+
+static void set_timeout(int fd)
+{
+	struct timeval tv;
+
+	tv.tv_sec = 5;
+	tv.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+/* The datagrams hold whole lines and are not fragmented. */
+static int test_udp(void)
+{
+	struct pbuf expected, received;
+	char *url, buf[65536];
+	ssize_t n;
+	int fd, errs, datagrams;
+
+	fd = create_listener(SOCK_DGRAM, &url);
+	set_timeout(fd);
+
+	if (!ppush_open(url, PPUSH_FORMAT_STATSD, "psensor"))
+		return 1;
+
+	ppush_send(sensors);
+
+	pbuf_init(&expected, 0);
+	ppush_encode(&expected, PPUSH_FORMAT_STATSD, "psensor", sensors);
+
+	pbuf_init(&received, 0);
+	errs = 0;
+	datagrams = 0;
+	while (received.len < expected.len) {
+		n = recv(fd, buf, sizeof(buf), 0);
+		if (n <= 0) {
+			fprintf(stderr, "udp: no datagram\n");
+			errs++;
+			break;
+		}
+
+		if (n > 1432 || buf[n - 1] != '\n') {
+			fprintf(stderr, "udp: invalid datagram\n");
+			errs++;
+		}
+
+		pbuf_append(&received, buf, n);
+		datagrams++;
+	}
+
+	if (datagrams < 2) {
+		fprintf(stderr, "udp: batch not split\n");
+		errs++;
+	}
+
+	if (received.data)
+		errs += check("udp", received.data, expected.data);
+
+	ppush_close();
+
+	pbuf_free(&expected);
+	pbuf_free(&received);
+	free(url);
+	close(fd);
+
+	return errs;
+}
+
+/* The queued batches are sent before ppush_close returns. */
+static int test_tcp(void)
+{
+	struct pbuf expected, received;
+	char *url, buf[4096];
+	ssize_t n;
+	int fd, conn, errs;
+
+	fd = create_listener(SOCK_STREAM, &url);
+
+	if (!ppush_open(url, PPUSH_FORMAT_GRAPHITE, "psensor"))
+		return 1;
+
+	ppush_send(sensors);
+	ppush_send(sensors);
+	ppush_close();
+
+	pbuf_init(&expected, 0);
+	ppush_encode(&expected, PPUSH_FORMAT_GRAPHITE, "psensor", sensors);
+	ppush_encode(&expected, PPUSH_FORMAT_GRAPHITE, "psensor", sensors);
+
+	pbuf_init(&received, 0);
+	pbuf_append(&received, "", 0);
+
+	conn = accept(fd, NULL, NULL);
+	set_timeout(conn);
+	while ((n = recv(conn, buf, sizeof(buf), 0)) > 0)
+		pbuf_append(&received, buf, n);
+
+	errs = check("tcp", received.data, expected.data);
+
+	pbuf_free(&expected);
+	pbuf_free(&received);
+	free(url);
+	close(conn);
+	close(fd);
+
+	return errs;
+}
+
+static double now(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+
+	return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+/*
+ * A collector which does not read: the batches are dropped once the
+ * queue is full and ppush_send never waits.
+ */
+static int test_stalled(void)
+{
+	char *url;
+	double t, start, max;
+	int fd, rcvbuf, errs;
+
+	fd = create_listener(SOCK_STREAM, &url);
+	rcvbuf = 4096;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	if (!ppush_open(url, PPUSH_FORMAT_INFLUX, "psensor"))
+		return 1;
+
+	max = 0;
+	start = now();
+	while (!ppush_get_dropped() && now() - start < 10) {
+		t = now();
+		ppush_send(sensors);
+		t = now() - t;
+
+		if (t > max)
+			max = t;
+	}
+
+	errs = 0;
+
+	if (!ppush_get_dropped()) {
+		fprintf(stderr, "stalled: no batch dropped\n");
+		errs++;
+	}
+
+	if (max > 0.1) {
+		fprintf(stderr, "stalled: ppush_send took %fs\n", max);
+		errs++;
+	}
+
+	ppush_close();
+
+	free(url);
+	close(fd);
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	int failures, i;
+
+	create_sensors();
+
+	failures = test_encode();
+	failures += test_udp();
+	failures += test_tcp();
+	failures += test_stalled();
+
+	for (i = 0; i < N_SENSORS; i++)
+		psensor_free(sensors[i]);
+
+	if (failures)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
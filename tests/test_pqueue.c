@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <pqueue.h>
+
+static const unsigned int COUNT = 1000000;
+
+static struct pqueue queue;
+static unsigned int slots[8];
+
+static void *producer(void *data)
+{
+	unsigned int v;
+	int i;
+
+	for (v = 1; v <= COUNT; v++) {
+		while ((i = pqueue_reserve(&queue)) == -1)
+			sched_yield();
+
+		slots[i] = v;
+		pqueue_push(&queue);
+	}
+
+	return NULL;
+}
+
+/* The consumer gets all the elements in order. */
+static int test_threads(void)
+{
+	pthread_t t;
+	unsigned int expected;
+	int i;
+
+	pqueue_init(&queue, 8);
+	pthread_create(&t, NULL, producer, NULL);
+
+	for (expected = 1; expected <= COUNT; expected++) {
+		while ((i = pqueue_front(&queue)) == -1)
+			sched_yield();
+
+		if (slots[i] != expected) {
+			fprintf(stderr, "got %u, expected: %u\n",
+				slots[i], expected);
+			break;
+		}
+
+		pqueue_pop(&queue);
+	}
+
+	pthread_join(t, NULL);
+
+	return expected <= COUNT;
+}
+
+static int test_full(void)
+{
+	struct pqueue q;
+	int i, errs;
+
+	errs = 0;
+
+	if (pqueue_size(5) != 8 || pqueue_size(8) != 8 || pqueue_size(0) != 1) {
+		fprintf(stderr, "size is not rounded to a power of 2\n");
+		errs++;
+	}
+
+	pqueue_init(&q, 3);
+
+	if (pqueue_front(&q) != -1) {
+		fprintf(stderr, "new queue is not empty\n");
+		errs++;
+	}
+
+	for (i = 0; i < 4; i++) {
+		if (pqueue_reserve(&q) != i) {
+			fprintf(stderr, "invalid slot %d\n", i);
+			errs++;
+		}
+		pqueue_push(&q);
+	}
+
+	if (pqueue_reserve(&q) != -1) {
+		fprintf(stderr, "full queue accepts an element\n");
+		errs++;
+	}
+
+	pqueue_pop(&q);
+	if (pqueue_reserve(&q) != 0 || pqueue_front(&q) != 1) {
+		fprintf(stderr, "slots are not reused\n");
+		errs++;
+	}
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	int errs;
+
+	errs = test_full();
+	errs += test_threads();
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <io.h>
+#include <pring.h>
+#include <psensor.h>
+
+static char root[] = "/tmp/psensor-test-pring-XXXXXX";
+
+static struct measure measure(int i)
+{
+	struct measure m;
+
+	m.value = i * 1.5;
+	m.time.tv_sec = 1000 + i;
+	m.time.tv_usec = 0;
+
+	return m;
+}
+
+/* Whether 'ms' are the measures 'first' to 'first + n - 1'. */
+static int check(const char *name,
+		 const struct measure *ms,
+		 int first,
+		 int n)
+{
+	int i;
+	struct measure m;
+
+	for (i = 0; i < n; i++) {
+		m = measure(first + i);
+
+		if (ms[i].value != m.value
+		    || ms[i].time.tv_sec != m.time.tv_sec) {
+			fprintf(stderr, "%s: measure %d: %f expected: %f\n",
+				name, i, ms[i].value, m.value);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int test_ring(void)
+{
+	struct pring *r;
+	struct measure m, ms[10];
+	int i, errs;
+
+	errs = 0;
+
+	r = pring_open(root, "lmsensor chip/temp 1", 4);
+	if (!r) {
+		fprintf(stderr, "cannot create the ring\n");
+		return 1;
+	}
+
+	for (i = 0; i < 6; i++) {
+		m = measure(i);
+		pring_push(r, &m);
+	}
+
+	/* the missing measures are left unchanged */
+	for (i = 0; i < 10; i++)
+		ms[i] = measure(100);
+	pring_read(r, ms, 10);
+
+	errs += check("push", ms, 100, 1);
+	errs += check("push", &ms[6], 2, 4);
+
+	pring_close(r);
+
+	/* keeps its size */
+	r = pring_open(root, "lmsensor chip/temp 1", 8);
+	if (!r || r->header->size != 4) {
+		fprintf(stderr, "the ring is not reopened\n");
+		return errs + 1;
+	}
+
+	pring_read(r, ms, 2);
+	errs += check("reopen", ms, 4, 2);
+
+	/* a measure older than the next one is not valid */
+	r->slots[(r->header->head - 2) % 4].time.tv_sec = 2000;
+	pring_read(r, ms, 3);
+	errs += check("order", ms, 2, 2);
+	errs += check("order", &ms[2], 5, 1);
+
+	for (i = 0; i < 3; i++)
+		ms[i] = measure(10 + i);
+	timerclear(&ms[1].time);
+
+	if (!pring_rewrite(r, ms, 3) || r->header->size != 3) {
+		fprintf(stderr, "the ring is not rewritten\n");
+		errs++;
+	}
+
+	memset(ms, 0, sizeof(ms));
+	pring_read(r, ms, 3);
+	errs += check("rewrite", &ms[1], 10, 1);
+	errs += check("rewrite", &ms[2], 12, 1);
+
+	pring_close(r);
+
+	return errs;
+}
+
+static int test_invalid(void)
+{
+	struct pring *r;
+	struct measure m;
+	char *path;
+	FILE *f;
+	int errs;
+
+	if (asprintf(&path, "%s/invalid.ring", root) == -1)
+		return 1;
+
+	f = fopen(path, "w");
+	fputs("garbage", f);
+	fclose(f);
+	free(path);
+
+	errs = 0;
+
+	r = pring_open(root, "invalid", 4);
+	if (!r || r->header->head || r->header->size != 4) {
+		fprintf(stderr, "an invalid ring is not reset\n");
+		return 1;
+	}
+
+	/* the reset ring is usable */
+	pring_close(r);
+	r = pring_open(root, "invalid", 4);
+	m = measure(1);
+	pring_push(r, &m);
+	pring_close(r);
+
+	memset(&m, 0, sizeof(m));
+	r = pring_open(root, "invalid", 4);
+	pring_read(r, &m, 1);
+	errs += check("invalid", &m, 1, 1);
+	pring_close(r);
+
+	return errs;
+}
+
+/* A failed rewrite leaves the ring usable. */
+static int test_rewrite_failure(void)
+{
+	struct pring *r;
+	struct measure m, ms[2];
+	char *tmp;
+	int errs;
+
+	r = pring_open(root, "failure", 4);
+	if (!r)
+		return 1;
+
+	/* the temporary file cannot be created */
+	if (asprintf(&tmp, "%s.tmp", r->path) == -1 || mkdir(tmp, 0700))
+		return 1;
+
+	errs = 0;
+
+	ms[0] = measure(1);
+	ms[1] = measure(2);
+	if (pring_rewrite(r, ms, 2) || !r->header || r->header->size != 4) {
+		fprintf(stderr, "rewrite failure: the ring is changed\n");
+		errs++;
+	}
+
+	m = measure(3);
+	pring_push(r, &m);
+	memset(&m, 0, sizeof(m));
+	pring_read(r, &m, 1);
+	errs += check("rewrite failure", &m, 3, 1);
+
+	rmdir(tmp);
+	free(tmp);
+	pring_close(r);
+
+	return errs;
+}
+
+static int test_psensor(void)
+{
+	struct psensor *s;
+	int i, errs;
+
+	psensor_set_history_dir(root);
+
+	s = psensor_create(strdup("hdd at /dev/sda"),
+			   strdup("sda"),
+			   NULL,
+			   SENSOR_TYPE_HDD_TEMP,
+			   5);
+	for (i = 0; i < 3; i++)
+		psensor_set_current_measure(s,
+					    measure(i).value,
+					    measure(i).time);
+	psensor_free(s);
+
+	s = psensor_create(strdup("hdd at /dev/sda"),
+			   strdup("sda"),
+			   NULL,
+			   SENSOR_TYPE_HDD_TEMP,
+			   5);
+
+	errs = check("psensor", &s->measures[2], 0, 3);
+
+	psensor_values_resize(s, 8);
+	errs += check("resize", &s->measures[5], 0, 3);
+	if (s->ring->header->size != 8) {
+		fprintf(stderr, "the ring is not resized\n");
+		errs++;
+	}
+
+	psensor_free(s);
+
+	psensor_set_history_dir(NULL);
+
+	return errs;
+}
+
+/*
+ * A sensor restored from the cache and the one found again by its
+ * provider share the ring of their id.
+ */
+static int test_adopt(void)
+{
+	struct psensor *cached, *found;
+	struct measure ms[2];
+	int errs;
+
+	psensor_set_history_dir(root);
+
+	cached = psensor_create(strdup("hdd at /dev/sdb"),
+				strdup("sdb"),
+				NULL,
+				SENSOR_TYPE_HDD_TEMP,
+				5);
+	found = psensor_create(strdup("hdd at /dev/sdb"),
+			       strdup("sdb"),
+			       NULL,
+			       SENSOR_TYPE_HDD_TEMP,
+			       5);
+
+	errs = 0;
+	if (!cached->ring || found->ring) {
+		fprintf(stderr, "adopt: the ring is opened twice\n");
+		errs++;
+	}
+
+	psensor_adopt(cached, found);
+
+	/* replaces the file of the ring */
+	ms[0] = measure(0);
+	ms[1] = measure(1);
+	psensor_merge_measures(cached, ms, 2);
+
+	psensor_set_current_measure(cached,
+				    measure(2).value,
+				    measure(2).time);
+	psensor_free(cached);
+
+	cached = psensor_create(strdup("hdd at /dev/sdb"),
+				strdup("sdb"),
+				NULL,
+				SENSOR_TYPE_HDD_TEMP,
+				5);
+	errs += check("adopt", &cached->measures[2], 0, 3);
+	psensor_free(cached);
+
+	psensor_set_history_dir(NULL);
+
+	return errs;
+}
+
+static void cleanup(void)
+{
+	char **paths, **cur;
+
+	paths = dir_list(root, NULL);
+	if (paths) {
+		for (cur = paths; *cur; cur++)
+			unlink(*cur);
+		paths_free(paths);
+	}
+
+	rmdir(root);
+}
+
+int main(int argc, char **argv)
+{
+	int failures;
+
+	if (!mkdtemp(root)) {
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+
+	failures = test_ring();
+	failures += test_invalid();
+	failures += test_rewrite_failure();
+	failures += test_psensor();
+	failures += test_adopt();
+
+	cleanup();
+
+	if (failures)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
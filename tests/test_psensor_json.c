@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/lib/psensor_json.h"
+
+/*
+ * Reference serialization based on the json-c object tree, the
+ * output of sensors_to_json_string must be byte-identical.
+ */
+static json_object *ref_measure(struct measure *m)
+{
+	json_object *o = json_object_new_object();
+
+	json_object_object_add(o, "value", json_object_new_double(m->value));
+	json_object_object_add(o, "time",
+			       json_object_new_int((m->time).tv_sec));
+	return o;
+}
+
+static json_object *ref_sensor(struct psensor *s)
+{
+	json_object *obj, *ms;
+	unsigned int i;
+
+	obj = json_object_new_object();
+
+	json_object_object_add(obj, "id", json_object_new_string(s->id));
+	json_object_object_add(obj, "name", json_object_new_string(s->name));
+	json_object_object_add(obj, "type", json_object_new_int(s->type));
+	json_object_object_add(obj, "min",
+			       json_object_new_double(s->sess_lowest));
+	json_object_object_add(obj, "max",
+			       json_object_new_double(s->sess_highest));
+
+	ms = json_object_new_array();
+	for (i = 0; i < s->values_max_length; i++)
+		if (s->measures[i].time.tv_sec)
+			json_object_array_add(ms, ref_measure(&s->measures[i]));
+	json_object_object_add(obj, "measures", ms);
+
+	json_object_object_add(obj, "last_measure",
+			       ref_measure(psensor_get_current_measure(s)));
+
+	return obj;
+}
+
+static char *ref_sensors_to_json_string(struct psensor **sensors)
+{
+	json_object *obj;
+	char *str;
+
+	obj = json_object_new_array();
+	for (; *sensors; sensors++)
+		json_object_array_add(obj, ref_sensor(*sensors));
+
+	str = strdup(json_object_to_json_string(obj));
+	json_object_put(obj);
+
+	return str;
+}
+
+static struct psensor *create_sensor(const char *id, const char *name)
+{
+	return psensor_create(strdup(id),
+			      strdup(name),
+			      NULL,
+			      SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP,
+			      8);
+}
+
+static void add_measure(struct psensor *s, double v, time_t t)
+{
+	struct timeval tv;
+
+	tv.tv_sec = t;
+	tv.tv_usec = 0;
+
+	psensor_set_current_measure(s, v, tv);
+}
+
+/* reused by all the tests, as the server does */
+static struct pbuf page;
+
+static int test_sensors(struct psensor **sensors)
+{
+	char *ref, *str;
+	int ret;
+
+	ref = ref_sensors_to_json_string(sensors);
+	str = sensors_to_json_string(sensors);
+
+	if (str && !strcmp(ref, str)) {
+		ret = 0;
+	} else {
+		fprintf(stderr,
+			"FAILURE: sensors_to_json_string returns\n%s\n"
+			"instead of\n%s\n",
+			str,
+			ref);
+		ret = 1;
+	}
+
+	pbuf_reset(&page);
+	sensors_json_append(&page, sensors);
+
+	if (page.err || strcmp(ref, page.data)) {
+		fprintf(stderr,
+			"FAILURE: sensors_json_append appends\n%s\n"
+			"instead of\n%s\n",
+			page.data,
+			ref);
+		ret = 1;
+	}
+
+	free(ref);
+	free(str);
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	struct psensor *sensors[4];
+	int failures;
+
+	failures = 0;
+
+	sensors[0] = NULL;
+	failures += test_sensors(sensors);
+
+	/* no measure */
+	sensors[0] = create_sensor("lmsensor empty", "empty");
+	sensors[1] = NULL;
+	failures += test_sensors(sensors);
+
+	sensors[1] = create_sensor("lmsensor coretemp-isa-0000/Core 0",
+				   "Core \"0\"\\\t\x01");
+	add_measure(sensors[1], 45, 1400000000);
+	add_measure(sensors[1], 45.5, 1400000005);
+	add_measure(sensors[1], -0.1, 1400000010);
+	add_measure(sensors[1], 1e20, 1400000015);
+	add_measure(sensors[1], 1.0 / 3, 1400000020);
+	add_measure(sensors[1], DBL_MIN, 1400000025);
+
+	sensors[2] = create_sensor("hddtemp /dev/sda", "/dev/sda");
+	add_measure(sensors[2], 2500, 1400000000);
+	add_measure(sensors[2], -12, 1400000005);
+	sensors[3] = NULL;
+
+	failures += test_sensors(sensors);
+
+	psensor_free(sensors[0]);
+	psensor_free(sensors[1]);
+	psensor_free(sensors[2]);
+	pbuf_free(&page);
+
+	if (failures)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <psensor.h>
+
+#define LEN 5
+
+static struct measure m(double v, time_t t)
+{
+	struct measure r;
+
+	r.value = v;
+	r.time.tv_sec = t;
+	r.time.tv_usec = 0;
+
+	return r;
+}
+
+/* Checks the times and values of the history, 0 for an empty slot. */
+static int check(const char *name,
+		 struct psensor *s,
+		 const time_t *times,
+		 const double *values)
+{
+	int i;
+
+	for (i = 0; i < LEN; i++) {
+		if (s->measures[i].time.tv_sec != times[i]
+		    || (times[i] && s->measures[i].value != values[i])) {
+			fprintf(stderr,
+				"%s: index %d: returns: %ld %f expected: %ld %f\n",
+				name,
+				i,
+				(long)s->measures[i].time.tv_sec,
+				s->measures[i].value,
+				(long)times[i],
+				values[i]);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static struct psensor *create(void)
+{
+	return psensor_create(strdup("id"),
+			      strdup("name"),
+			      NULL,
+			      SENSOR_TYPE_TEMP,
+			      LEN);
+}
+
+static int test_empty(void)
+{
+	struct psensor *s;
+	struct measure ms[] = { m(1, 1), m(2, 2), m(3, 3) };
+	time_t times[] = { 0, 0, 1, 2, 3 };
+	double values[] = { 0, 0, 1, 2, 3 };
+	int ret;
+
+	s = create();
+	psensor_merge_measures(s, ms, 3);
+
+	ret = check("empty", s, times, values);
+
+	if (s->sess_lowest != 1 || s->sess_highest != 3) {
+		fprintf(stderr, "empty: wrong session bounds\n");
+		ret++;
+	}
+
+	psensor_free(s);
+
+	return ret;
+}
+
+static int test_overflow(void)
+{
+	struct psensor *s;
+	struct measure ms[] = { m(1, 1), m(2, 2), m(3, 3), m(4, 4),
+				m(5, 5), m(6, 6), m(7, 7) };
+	time_t times[] = { 3, 4, 5, 6, 7 };
+	double values[] = { 3, 4, 5, 6, 7 };
+	int ret;
+
+	s = create();
+	psensor_merge_measures(s, ms, 7);
+
+	ret = check("overflow", s, times, values);
+
+	psensor_free(s);
+
+	return ret;
+}
+
+/* Fills a gap of unknown measures. */
+static int test_gap(void)
+{
+	struct psensor *s;
+	struct timeval tv;
+	struct measure ms[] = { m(21, 11), m(22, 12), m(23, 13) };
+	time_t times[] = { 10, 11, 12, 13, 14 };
+	double values[] = { 10, 21, 22, 23, 14 };
+	int ret;
+
+	s = create();
+
+	tv.tv_usec = 0;
+
+	tv.tv_sec = 10;
+	psensor_set_current_measure(s, 10, tv);
+	tv.tv_sec = 11;
+	psensor_set_current_measure(s, 11, tv);
+	tv.tv_sec = 12;
+	psensor_set_current_measure(s, UNKNOWN_DOUBLE_VALUE, tv);
+	tv.tv_sec = 14;
+	psensor_set_current_measure(s, 14, tv);
+
+	psensor_merge_measures(s, ms, 3);
+
+	ret = check("gap", s, times, values);
+
+	psensor_free(s);
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int errs;
+
+	errs = test_empty();
+	errs += test_overflow();
+	errs += test_gap();
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
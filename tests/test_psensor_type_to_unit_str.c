@@ -62,6 +62,9 @@ static int test(void) {
 	if (!test_fct(SENSOR_TYPE_RPM, 0, _("RPM")))
 		failures++;
 
+	if (!test_fct(SENSOR_TYPE_CPU | SENSOR_TYPE_FREQUENCY, 1, _("MHz")))
+		failures++;
+
 	return failures;
 }
 
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <pshm.h>
+#include <psensor_shm.h>
+
+#define ITERATIONS 200000
+
+static char root[] = "/tmp/psensor-test-pshm-XXXXXX";
+static char *path;
+
+static struct psensor *create(const char *id)
+{
+	return psensor_create(strdup(id),
+			      strdup(id),
+			      NULL,
+			      SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP,
+			      2);
+}
+
+static void set(struct psensor *s, int i)
+{
+	struct timeval t;
+
+	t.tv_sec = i;
+	t.tv_usec = 0;
+
+	psensor_set_current_measure(s, i, t);
+}
+
+static int test_publish(void)
+{
+	struct psensor *sensors[3], *removed;
+	struct psensor_shm *shm;
+	struct psensor_shm_value v;
+	int i, errs;
+
+	errs = 0;
+
+	if (!pshm_open(path)) {
+		fprintf(stderr, "cannot open the segment\n");
+		return 1;
+	}
+
+	sensors[0] = create("lmsensor chip temp1");
+	sensors[1] = create("lmsensor chip temp2");
+	sensors[2] = NULL;
+
+	set(sensors[0], 42);
+	pshm_publish(sensors);
+
+	shm = psensor_shm_open(path);
+	if (!shm) {
+		fprintf(stderr, "cannot read the segment\n");
+		pshm_close();
+		return 1;
+	}
+
+	if (psensor_shm_count(shm) != 2 || shm->pid != getpid()) {
+		fprintf(stderr, "publish: wrong header\n");
+		errs++;
+	}
+
+	i = psensor_shm_find(shm, "lmsensor chip temp1");
+	if (!psensor_shm_read(shm, i, &v)
+	    || v.value != 42
+	    || v.sec != 42
+	    || v.type != (SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP)) {
+		fprintf(stderr, "publish: wrong value of temp1\n");
+		errs++;
+	}
+
+	/* never measured */
+	i = psensor_shm_find(shm, "lmsensor chip temp2");
+	if (!psensor_shm_read(shm, i, &v) || !isnan(v.value)) {
+		fprintf(stderr, "publish: wrong value of temp2\n");
+		errs++;
+	}
+
+	if (psensor_shm_find(shm, "unknown") != -1
+	    || psensor_shm_read(shm, 2, &v)) {
+		fprintf(stderr, "publish: unknown sensor found\n");
+		errs++;
+	}
+
+	removed = sensors[1];
+	sensors[1] = NULL;
+	pshm_publish(sensors);
+	if (psensor_shm_count(shm) != 1) {
+		fprintf(stderr, "publish: the count is not updated\n");
+		errs++;
+	}
+
+	pshm_close();
+
+	if (shm->pid || psensor_shm_count(shm) || !access(path, F_OK)) {
+		fprintf(stderr, "close: the segment is not released\n");
+		errs++;
+	}
+
+	psensor_shm_close(shm);
+	psensor_free(sensors[0]);
+	psensor_free(removed);
+
+	return errs;
+}
+
+static void *write_values(void *data)
+{
+	struct psensor **sensors;
+	int i;
+
+	sensors = data;
+
+	for (i = 1; i <= ITERATIONS; i++) {
+		set(sensors[0], i);
+		pshm_publish(sensors);
+	}
+
+	return NULL;
+}
+
+/* A reader never sees a value of a measure with the time of another. */
+static int test_concurrent(void)
+{
+	struct psensor *sensors[2];
+	struct psensor_shm *shm;
+	struct psensor_shm_value v;
+	pthread_t thread;
+	int errs;
+
+	if (!pshm_open(path))
+		return 1;
+
+	sensors[0] = create("lmsensor chip temp1");
+	sensors[1] = NULL;
+	set(sensors[0], 0);
+	pshm_publish(sensors);
+
+	shm = psensor_shm_open(path);
+
+	pthread_create(&thread, NULL, write_values, sensors);
+
+	errs = 0;
+	for (;;) {
+		/* may give up while the writer is busy */
+		if (!psensor_shm_read(shm, 0, &v))
+			continue;
+
+		if (v.value != v.sec) {
+			fprintf(stderr, "concurrent: torn read %f %ld\n",
+				v.value, (long)v.sec);
+			errs++;
+			break;
+		}
+
+		if (v.sec == ITERATIONS)
+			break;
+	}
+
+	pthread_join(thread, NULL);
+
+	psensor_shm_close(shm);
+	pshm_close();
+	psensor_free(sensors[0]);
+
+	return errs;
+}
+
+/* An entry left odd by a writer killed during an update is skipped. */
+static int test_stalled(void)
+{
+	struct psensor *sensors[2];
+	struct psensor_shm *shm, *w;
+	struct psensor_shm_value v;
+	int fd, errs;
+
+	if (!pshm_open(path))
+		return 1;
+
+	sensors[0] = create("lmsensor chip temp1");
+	sensors[1] = NULL;
+	set(sensors[0], 1);
+	pshm_publish(sensors);
+
+	shm = psensor_shm_open(path);
+
+	fd = open(path, O_RDWR);
+	w = mmap(NULL, sizeof(*w), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	errs = 0;
+
+	w->entries[0].seq++;
+	if (psensor_shm_read(shm, 0, &v)) {
+		fprintf(stderr, "stalled: entry read while written\n");
+		errs++;
+	}
+
+	w->entries[0].seq++;
+	if (!psensor_shm_read(shm, 0, &v) || v.value != 1) {
+		fprintf(stderr, "stalled: entry not read once written\n");
+		errs++;
+	}
+
+	munmap(w, sizeof(*w));
+	psensor_shm_close(shm);
+	pshm_close();
+	psensor_free(sensors[0]);
+
+	return errs;
+}
+
+/* A single process publishes in a segment. */
+static int test_lock(void)
+{
+	FILE *f;
+	int errs;
+
+	f = fopen(path, "w");
+	flock(fileno(f), LOCK_EX);
+
+	errs = 0;
+	if (pshm_open(path)) {
+		fprintf(stderr, "lock: the segment is not locked\n");
+		pshm_close();
+		errs++;
+	}
+
+	fclose(f);
+	unlink(path);
+
+	return errs;
+}
+
+/* A link planted in place of the segment is not followed. */
+static int test_link(void)
+{
+	char *target;
+	struct stat st;
+	int errs;
+
+	if (asprintf(&target, "%s/target", root) == -1)
+		return 1;
+
+	close(open(target, O_WRONLY | O_CREAT, 0644));
+
+	errs = 0;
+
+	symlink(target, path);
+	if (pshm_open(path)) {
+		fprintf(stderr, "link: symbolic link followed\n");
+		pshm_close();
+		errs++;
+	}
+	unlink(path);
+
+	link(target, path);
+	if (pshm_open(path)) {
+		fprintf(stderr, "link: hard link written\n");
+		pshm_close();
+		errs++;
+	}
+	unlink(path);
+
+	if (stat(target, &st) || st.st_size) {
+		fprintf(stderr, "link: target modified\n");
+		errs++;
+	}
+
+	unlink(target);
+	free(target);
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	int failures;
+
+	if (!mkdtemp(root)) {
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+
+	if (asprintf(&path, "%s/psensor", root) == -1)
+		exit(EXIT_FAILURE);
+
+	failures = test_publish();
+	failures += test_concurrent();
+	failures += test_stalled();
+	failures += test_lock();
+	failures += test_link();
+
+	unlink(path);
+	free(path);
+	rmdir(root);
+
+	if (failures)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <psensor.h>
+#include <psi.h>
+
+static char root[] = "/tmp/psensor-test-psi-XXXXXX";
+
+static void mk(const char *path)
+{
+	char p[512];
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	if (mkdir(p, 0700)) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void wr(const char *path, const char *content)
+{
+	char p[512];
+	FILE *f;
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	f = fopen(p, "w");
+	if (!f) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(f, "%s\n", content);
+	fclose(f);
+}
+
+static void create_tree(void)
+{
+	mk("proc");
+	mk("proc/pressure");
+	wr("proc/pressure/cpu",
+	   "some avg10=1.50 avg60=0.75 avg300=0.10 total=1000000\n"
+	   "full avg10=0.00 avg60=0.00 avg300=0.00 total=0");
+	wr("proc/pressure/memory",
+	   "some avg10=0.00 avg60=0.00 avg300=0.00 total=5000\n"
+	   "full avg10=0.00 avg60=0.00 avg300=0.00 total=0");
+	/* io is missing, e.g. old kernel */
+}
+
+static int rm(const char *path, const struct stat *st, int flag, struct FTW *f)
+{
+	return remove(path);
+}
+
+static struct psensor *get(struct psensor **sensors, const char *id)
+{
+	for (; *sensors; sensors++)
+		if (!strcmp((*sensors)->id, id))
+			return *sensors;
+
+	fprintf(stderr, "sensor not found: %s\n", id);
+
+	return NULL;
+}
+
+static int check(struct psensor **sensors, const char *id, double value)
+{
+	struct psensor *s;
+	double v;
+
+	s = get(sensors, id);
+	if (!s)
+		return 1;
+
+	v = psensor_get_current_value(s);
+	if (v != value) {
+		fprintf(stderr, "%s: value: %f expected: %f\n", id, v, value);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct psensor **sensors, *s;
+	struct timespec delay = {0, 200000000};
+	double v;
+	int errs;
+
+	if (!mkdtemp(root)) {
+		perror(root);
+		exit(EXIT_FAILURE);
+	}
+
+	create_tree();
+
+	psi_set_root(root);
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	psi_psensor_list_append(&sensors, 10);
+
+	errs = 0;
+
+	if (psensor_list_size(sensors) != 6) {
+		fprintf(stderr, "returns %zu sensors, expected: 6\n",
+			psensor_list_size(sensors));
+		errs++;
+	}
+
+	/* 100ms stalled in 200ms */
+	nanosleep(&delay, NULL);
+	wr("proc/pressure/cpu",
+	   "some avg10=2.25 avg60=1.00 avg300=0.20 total=1100000\n"
+	   "full avg10=0.00 avg60=0.00 avg300=0.00 total=0");
+
+	psi_psensor_list_update(sensors);
+
+	errs += check(sensors, "psi cpu some avg10", 2.25);
+	errs += check(sensors, "psi cpu some avg60", 1);
+	errs += check(sensors, "psi memory some avg10", 0);
+	errs += check(sensors, "psi memory some total", 0);
+
+	s = get(sensors, "psi cpu some total");
+	v = s ? psensor_get_current_value(s) : UNKNOWN_DOUBLE_VALUE;
+	if (v <= 0 || v > 50) {
+		fprintf(stderr, "psi cpu some total: %f expected: ]0,50]\n", v);
+		errs++;
+	}
+
+	psensor_list_free(sensors);
+
+	psi_set_root(NULL);
+
+	nftw(root, rm, 8, FTW_DEPTH | FTW_PHYS);
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
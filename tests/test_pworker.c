@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <pworker.h>
+
+static const unsigned int COUNT = 100000;
+
+static struct pworker worker;
+static unsigned int slots[8];
+static unsigned int expected = 1;
+static int errs;
+static atomic_bool held;
+
+static void consume(struct pqueue *q)
+{
+	int i;
+
+	while ((i = pqueue_front(q)) != -1) {
+		if (slots[i] != expected) {
+			fprintf(stderr, "got %u, expected: %u\n",
+				slots[i], expected);
+			errs++;
+		}
+		expected = slots[i] + 1;
+
+		pqueue_pop(q);
+	}
+}
+
+/* The thread consumes all the slots in order, even when stopped. */
+static int test_consume(void)
+{
+	unsigned int v;
+	int i;
+
+	pworker_init(&worker, 8, consume);
+
+	if (!pworker_start(&worker)) {
+		fprintf(stderr, "cannot start the worker\n");
+		return 1;
+	}
+
+	for (v = 1; v <= COUNT; v++) {
+		while ((i = pqueue_reserve(&worker.queue)) == -1)
+			sched_yield();
+
+		slots[i] = v;
+		pworker_push(&worker);
+	}
+
+	pworker_stop(&worker);
+
+	if (expected != COUNT + 1) {
+		fprintf(stderr, "queue not emptied: %u\n", expected);
+		errs++;
+	}
+
+	return errs;
+}
+
+/*
+ * Consumes the first slot, then waits for the stop: a slot pushed
+ * in the meantime is only seen by a consume after the loop.
+ */
+static void consume_held(struct pqueue *q)
+{
+	consume(q);
+
+	if (!atomic_exchange(&held, true))
+		while (atomic_load(&worker.running))
+			sched_yield();
+}
+
+/* A slot pushed just before the stop is consumed. */
+static int test_push_stop(void)
+{
+	unsigned int v;
+	int i;
+
+	expected = 1;
+	atomic_init(&held, false);
+
+	pworker_init(&worker, 8, consume_held);
+	pworker_start(&worker);
+
+	for (v = 1; v <= 2; v++) {
+		i = pqueue_reserve(&worker.queue);
+		slots[i] = v;
+		pworker_push(&worker);
+
+		/* the thread waits for the stop after the first slot */
+		while (v == 1 && !atomic_load(&held))
+			sched_yield();
+	}
+
+	pworker_stop(&worker);
+
+	if (expected != 3) {
+		fprintf(stderr, "push-stop: slot lost\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/* A worker which was never started can be stopped. */
+static int test_not_started(void)
+{
+	pworker_init(&worker, 8, consume);
+	pworker_stop(&worker);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int failures;
+
+	failures = test_consume();
+	failures += test_push_stop();
+	failures += test_not_started();
+
+	if (failures)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
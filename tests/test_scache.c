@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _XOPEN_SOURCE 700
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <psensor.h>
+#include <scache.h>
+
+static char root[] = "/tmp/psensor-test-scache-XXXXXX";
+
+static struct psensor *add(struct psensor ***sensors,
+			   const char *id,
+			   const char *name,
+			   unsigned int type)
+{
+	struct psensor *s;
+
+	s = psensor_create(strdup(id),
+			   strdup(name),
+			   strdup("chip"),
+			   type,
+			   10);
+	psensor_list_append(sensors, s);
+
+	return s;
+}
+
+static int check(struct psensor **sensors,
+		 const char *id,
+		 unsigned int type,
+		 double min,
+		 double max)
+{
+	struct psensor *s;
+
+	s = psensor_list_get_by_id(sensors, id);
+	if (!s) {
+		fprintf(stderr, "sensor not found: %s\n", id);
+		return 1;
+	}
+
+	if (s->type != type) {
+		fprintf(stderr, "%s: type: %x expected: %x\n",
+			id, s->type, type);
+		return 1;
+	}
+
+	if (s->min != min || s->max != max) {
+		fprintf(stderr, "%s: min/max: %f/%f expected: %f/%f\n",
+			id, s->min, s->max, min, max);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_roundtrip(const char *path)
+{
+	struct psensor **sensors, **loaded, *s;
+	int errs;
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	s = add(&sensors,
+		"lmsensor coretemp-isa-0000 temp1",
+		"Core 0",
+		SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP);
+	s->min = 27.5;
+	s->max = 0.1;
+
+	add(&sensors,
+	    "hdd at /dev/sda",
+	    "sda",
+	    SENSOR_TYPE_HDDTEMP | SENSOR_TYPE_HDD_TEMP);
+
+	/* remote sensors, sensors without provider and invalid ids */
+	add(&sensors, "http://host/1", "remote",
+	    SENSOR_TYPE_REMOTE | SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP);
+	add(&sensors, "noprovider", "none", SENSOR_TYPE_TEMP);
+	add(&sensors, "bad\tid", "bad", SENSOR_TYPE_LMSENSOR);
+
+	errs = 0;
+
+	if (!scache_save(path, sensors)) {
+		fprintf(stderr, "save failed\n");
+		errs++;
+	}
+
+	loaded = scache_load(path, 10);
+	if (!loaded) {
+		fprintf(stderr, "load failed\n");
+		psensor_list_free(sensors);
+		return errs + 1;
+	}
+
+	if (psensor_list_size(loaded) != 2) {
+		fprintf(stderr, "loads %zu sensors, expected: 2\n",
+			psensor_list_size(loaded));
+		errs++;
+	}
+
+	/* the placeholders have no provider */
+	errs += check(loaded,
+		      "lmsensor coretemp-isa-0000 temp1",
+		      SENSOR_TYPE_TEMP,
+		      27.5,
+		      0.1);
+	errs += check(loaded,
+		      "hdd at /dev/sda",
+		      SENSOR_TYPE_HDD_TEMP,
+		      UNKNOWN_DOUBLE_VALUE,
+		      UNKNOWN_DOUBLE_VALUE);
+
+	psensor_list_free(loaded);
+	psensor_list_free(sensors);
+
+	return errs;
+}
+
+static int test_load_invalid(const char *path)
+{
+	FILE *f;
+	struct psensor **loaded;
+	int errs;
+
+	errs = 0;
+
+	f = fopen(path, "w");
+	fprintf(f, "V,1\n");
+	fprintf(f, "garbage\n");
+	fprintf(f, "101\t0\t0\tid1\tname\n");
+	fprintf(f, "101\tx\t0\tid2\tname\tchip\n");
+	fprintf(f, "101\t0\t0\tid3\tname\tchip\n");
+	fprintf(f, "101\t0\t0\tid3\tname\tchip\n");
+	fclose(f);
+
+	loaded = scache_load(path, 10);
+	if (!loaded || psensor_list_size(loaded) != 1) {
+		fprintf(stderr, "invalid lines are not skipped\n");
+		errs++;
+	}
+	psensor_list_free(loaded);
+
+	f = fopen(path, "w");
+	fprintf(f, "V,2\n");
+	fclose(f);
+
+	loaded = scache_load(path, 10);
+	if (loaded) {
+		fprintf(stderr, "unknown version is not rejected\n");
+		psensor_list_free(loaded);
+		errs++;
+	}
+
+	return errs;
+}
+
+static int test_adopt(void)
+{
+	struct psensor **sensors, *placeholder, *found;
+	int *data, errs;
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	placeholder = add(&sensors, "id", "name", SENSOR_TYPE_TEMP);
+	add(&sensors, "other", "other", SENSOR_TYPE_TEMP);
+
+	data = malloc(sizeof(int));
+	*data = 42;
+
+	found = psensor_create(strdup("id"),
+			       strdup("name"),
+			       strdup("new chip"),
+			       SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP,
+			       10);
+	found->max = 90;
+	found->provider_data = data;
+
+	psensor_adopt(placeholder, found);
+
+	errs = check(sensors,
+		     "id",
+		     SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP,
+		     UNKNOWN_DOUBLE_VALUE,
+		     90);
+
+	if (placeholder->provider_data != data
+	    || strcmp(placeholder->chip, "new chip")) {
+		fprintf(stderr, "provider is not adopted\n");
+		errs++;
+	}
+
+	psensor_list_remove(sensors, placeholder);
+	if (psensor_list_size(sensors) != 1
+	    || psensor_list_get_by_id(sensors, "id")) {
+		fprintf(stderr, "sensor is not removed\n");
+		errs++;
+	}
+
+	/* frees the provider data */
+	psensor_free(placeholder);
+	psensor_list_free(sensors);
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	char path[sizeof(root) + 16];
+	int errs;
+
+	if (!mkdtemp(root)) {
+		perror(root);
+		exit(EXIT_FAILURE);
+	}
+
+	snprintf(path, sizeof(path), "%s/sensors.cache", root);
+
+	errs = test_roundtrip(path);
+	errs += test_load_invalid(path);
+	errs += test_adopt();
+
+	unlink(path);
+	rmdir(root);
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
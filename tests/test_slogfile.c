@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _XOPEN_SOURCE 700
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <io.h>
+#include <slogfile.h>
+
+static char root[] = "/tmp/psensor-test-slogfile-XXXXXX";
+
+/* path of a log, and of one of its segments: the log and a suffix */
+#define LOG_SIZE 256
+#define SEGMENT_SIZE (LOG_SIZE + 32)
+
+static void touch(const char *path)
+{
+	FILE *f;
+
+	f = fopen(path, "w");
+	fputs("x\n", f);
+	fclose(f);
+}
+
+static int exists(const char *path)
+{
+	struct stat st;
+
+	return !stat(path, &st);
+}
+
+static int test_rotate(const char *log)
+{
+	char *s1, *s2, expected[SEGMENT_SIZE];
+	struct tm tm;
+	time_t t;
+	int errs;
+
+	errs = 0;
+
+	memset(&tm, 0, sizeof(tm));
+	tm.tm_year = 2016 - 1900;
+	tm.tm_mon = 2;
+	tm.tm_mday = 4;
+	tm.tm_hour = 5;
+	tm.tm_min = 6;
+	tm.tm_sec = 7;
+	tm.tm_isdst = -1;
+	t = mktime(&tm);
+
+	touch(log);
+	s1 = slog_segment_rotate(log, t);
+	snprintf(expected, sizeof(expected), "%s.20160304-050607", log);
+	if (!s1 || strcmp(s1, expected)) {
+		fprintf(stderr, "rotate: %s expected: %s\n", s1, expected);
+		errs++;
+	}
+
+	if (exists(log)) {
+		fprintf(stderr, "rotate: %s still exists\n", log);
+		errs++;
+	}
+
+	/* same second, the name of the first segment is taken */
+	touch(log);
+	s2 = slog_segment_rotate(log, t);
+	snprintf(expected, sizeof(expected), "%s.20160304-050607-1", log);
+	if (!s2 || strcmp(s2, expected)) {
+		fprintf(stderr, "rotate: %s expected: %s\n", s2, expected);
+		errs++;
+	}
+
+	free(s1);
+	free(s2);
+
+	return errs;
+}
+
+static int test_list(const char *log)
+{
+	char **segments, path[SEGMENT_SIZE];
+	int errs, n;
+
+	errs = 0;
+
+	snprintf(path, sizeof(path), "%s.20160101-000000.gz", log);
+	touch(path);
+	snprintf(path, sizeof(path), "%s.tmp", log);
+	touch(path);
+	snprintf(path, sizeof(path), "%s/other.log.20160101-000000", root);
+	touch(path);
+
+	segments = slog_segments_list(log);
+	if (!segments) {
+		fprintf(stderr, "list: no segment\n");
+		return 1;
+	}
+
+	for (n = 0; segments[n]; n++)
+		;
+
+	if (n != 3) {
+		fprintf(stderr, "list: %d segments expected: 3\n", n);
+		errs++;
+	} else {
+		snprintf(path, sizeof(path), "%s.20160101-000000.gz", log);
+		if (strcmp(segments[0], path)) {
+			fprintf(stderr, "list: first segment: %s\n",
+				segments[0]);
+			errs++;
+		}
+
+		snprintf(path, sizeof(path), "%s.20160304-050607-1", log);
+		if (strcmp(segments[2], path)) {
+			fprintf(stderr, "list: last segment: %s\n",
+				segments[2]);
+			errs++;
+		}
+	}
+
+	paths_free(segments);
+
+	return errs;
+}
+
+/* Same second: the rank of the rotation, not the extension, counts. */
+static int test_order(void)
+{
+	static const char * const SUFFIXES[] = {
+		".20160304-050607.gz",
+		".20160304-050607-1.zst",
+		".20160304-050607-2",
+		".20160304-050607-10",
+		".20160304-050608"
+	};
+	char **segments, log[LOG_SIZE], path[SEGMENT_SIZE];
+	int errs, i;
+
+	snprintf(log, sizeof(log), "%s/order.log", root);
+
+	for (i = 4; i >= 0; i--) {
+		snprintf(path, sizeof(path), "%s%s", log, SUFFIXES[i]);
+		touch(path);
+	}
+
+	segments = slog_segments_list(log);
+
+	errs = 0;
+	for (i = 0; i < 5; i++) {
+		snprintf(path, sizeof(path), "%s%s", log, SUFFIXES[i]);
+
+		if (!segments || !segments[i] || strcmp(segments[i], path)) {
+			fprintf(stderr, "order: %s expected at %d\n", path, i);
+			errs++;
+			break;
+		}
+	}
+
+	if (segments)
+		paths_free(segments);
+
+	return errs;
+}
+
+static int test_archive(const char *log)
+{
+	char **segments, path[SEGMENT_SIZE];
+	int errs, n;
+
+	errs = 0;
+
+	snprintf(path, sizeof(path), "%s.20160304-050607-1", log);
+	slog_segment_archive(log, path, SLOG_COMPRESSION_NONE, 2);
+
+	segments = slog_segments_list(log);
+	for (n = 0; segments && segments[n]; n++)
+		;
+
+	if (n != 2) {
+		fprintf(stderr, "archive: %d segments expected: 2\n", n);
+		errs++;
+	}
+
+	snprintf(path, sizeof(path), "%s.20160101-000000.gz", log);
+	if (exists(path)) {
+		fprintf(stderr, "archive: oldest segment not removed\n");
+		errs++;
+	}
+
+	snprintf(path, sizeof(path), "%s.tmp", log);
+	if (!exists(path)) {
+		fprintf(stderr, "archive: unrelated file removed\n");
+		errs++;
+	}
+
+	paths_free(segments);
+
+	return errs;
+}
+
+static void cleanup(void)
+{
+	char **paths, **cur;
+
+	paths = dir_list(root, NULL);
+	if (paths) {
+		for (cur = paths; *cur; cur++)
+			unlink(*cur);
+		paths_free(paths);
+	}
+
+	rmdir(root);
+}
+
+int main(int argc, char **argv)
+{
+	char log[LOG_SIZE];
+	int failures;
+
+	if (!mkdtemp(root)) {
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+
+	snprintf(log, sizeof(log), "%s/sensors.log", root);
+
+	failures = test_rotate(log);
+	failures += test_list(log);
+	failures += test_order();
+	failures += test_archive(log);
+
+	cleanup();
+
+	if (failures)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
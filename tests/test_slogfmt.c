@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <measure.h>
+#include <slogfmt.h>
+
+#define N 4
+
+static const char *CSV_LOG =
+	"I,1345974927,0.7.0.4\n"
+	"S,lmsensor coretemp-isa-0000 Physical id 0,101\n"
+	"S,lmsensor coretemp-isa-0000 Core 0,101\n"
+	"S,lmsensor coretemp-isa-0000 Core 1,101\n"
+	"0,37.0,37.0,36.0\n"
+	"5,36.0,,36.0\n"
+	"I,1345975000,0.7.0.5\n"
+	"S,udisks2 /dev/sda,4101\n"
+	"3,41.5\n";
+
+static char *ids[N] = { "a", "b", "c", "d" };
+static unsigned int types[N] = { 0x101, 0x102, 0x104, 0x4101 };
+
+/* values of the successive records, 1 second apart */
+static const double values[][N] = {
+	{ 45.5, 1200, 12.345, UNKNOWN_DOUBLE_VALUE },
+	{ 45.5, 1180, 1.0 / 3, -7.25 },
+	{ 46.125, 1180, 1.0 / 3, NAN },
+	{ 46.125, 1e15, 0, -7.25 }
+};
+
+static const int NRECORDS = sizeof(values) / sizeof(values[0]);
+
+static bool same(double a, double b)
+{
+	return !memcmp(&a, &b, sizeof(a)) || (isnan(a) && isnan(b));
+}
+
+static void encode(enum slog_format format, struct pbuf *b)
+{
+	struct slog_encoder e;
+	struct slog_header h;
+	struct timeval t;
+	int i;
+
+	h.start = 1500000000;
+	h.version = "1.2.0";
+	h.n = N;
+	h.ids = ids;
+	h.types = types;
+
+	slog_encoder_init(&e, format);
+	slog_encode_header(&e, b, &h);
+
+	for (i = 0; i < NRECORDS; i++) {
+		t.tv_sec = h.start + i;
+		t.tv_usec = 250000;
+		slog_encode_record(&e, b, &t, values[i]);
+	}
+
+	slog_encoder_free(&e);
+}
+
+static int check_header(struct slog_decoder *d)
+{
+	size_t i;
+
+	if (slog_decoder_next(d) != SLOG_ENTRY_HEADER
+	    || d->header.start != 1500000000
+	    || strcmp(d->header.version, "1.2.0")
+	    || d->header.n != N) {
+		fprintf(stderr, "invalid header\n");
+		return 1;
+	}
+
+	for (i = 0; i < N; i++)
+		if (strcmp(d->header.ids[i], ids[i])
+		    || d->header.types[i] != types[i]) {
+			fprintf(stderr, "invalid sensor %zu\n", i);
+			return 1;
+		}
+
+	return 0;
+}
+
+/* Values are decoded exactly. */
+static int test_binary(void)
+{
+	struct slog_decoder d;
+	struct pbuf b;
+	int i, j, errs;
+
+	pbuf_init(&b, 0);
+	encode(SLOG_FORMAT_BINARY, &b);
+
+	slog_decoder_init(&d, b.data, b.len);
+
+	errs = check_header(&d);
+
+	for (i = 0; !errs && i < NRECORDS; i++) {
+		if (slog_decoder_next(&d) != SLOG_ENTRY_RECORD) {
+			fprintf(stderr, "binary: record %d missing\n", i);
+			errs++;
+			break;
+		}
+
+		if (d.time.tv_sec != 1500000000 + i
+		    || d.time.tv_usec != 250000) {
+			fprintf(stderr, "binary: record %d: invalid time\n", i);
+			errs++;
+		}
+
+		for (j = 0; j < N; j++)
+			if (!same(d.values[j], values[i][j])) {
+				fprintf(stderr,
+					"binary: record %d: value %d: %g"
+					" expected: %g\n",
+					i, j, d.values[j], values[i][j]);
+				errs++;
+			}
+	}
+
+	if (!errs && slog_decoder_next(&d) != SLOG_ENTRY_END) {
+		fprintf(stderr, "binary: end missing\n");
+		errs++;
+	}
+
+	slog_decoder_free(&d);
+
+	/* an entry being written is not an error */
+	slog_decoder_init(&d, b.data, b.len - 1);
+	while ((i = slog_decoder_next(&d)) == SLOG_ENTRY_HEADER
+	       || i == SLOG_ENTRY_RECORD)
+		;
+	if (i != SLOG_ENTRY_END) {
+		fprintf(stderr, "binary: truncated log is an error\n");
+		errs++;
+	}
+	slog_decoder_free(&d);
+
+	b.data[b.len - 1] = 'X';
+	b.data[b.len] = 'X';
+	slog_decoder_init(&d, b.data, b.len + 1);
+	while ((i = slog_decoder_next(&d)) == SLOG_ENTRY_HEADER
+	       || i == SLOG_ENTRY_RECORD)
+		;
+	if (i != SLOG_ENTRY_ERROR) {
+		fprintf(stderr, "binary: invalid log is not an error\n");
+		errs++;
+	}
+	slog_decoder_free(&d);
+
+	pbuf_free(&b);
+
+	return errs;
+}
+
+/* The CSV encoding is the historical one. */
+static int test_csv(void)
+{
+	struct pbuf b;
+	int errs;
+	const char *expected =
+		"I,1500000000,1.2.0\n"
+		"S,a,101\n"
+		"S,b,102\n"
+		"S,c,104\n"
+		"S,d,4101\n"
+		"0,45.5,1200.0,12.3,0.0\n"
+		"1,,1180.0,0.3,-7.2\n"
+		"2,46.1,,,nan\n"
+		"3,,1000000000000000.0,0.0,-7.2\n";
+
+	pbuf_init(&b, 0);
+	encode(SLOG_FORMAT_CSV, &b);
+
+	errs = 0;
+	if (strcmp(b.data, expected)) {
+		fprintf(stderr, "csv: %s\nexpected: %s\n", b.data, expected);
+		errs++;
+	}
+
+	pbuf_free(&b);
+
+	return errs;
+}
+
+static char *convert(const char *data, size_t len, enum slog_format format,
+		     size_t *out_len)
+{
+	struct slog_decoder d;
+	char *out;
+	FILE *f;
+	bool ok;
+
+	out = NULL;
+	f = open_memstream(&out, out_len);
+
+	slog_decoder_init(&d, data, len);
+	ok = slog_convert(&d, format, f);
+	slog_decoder_free(&d);
+
+	fclose(f);
+
+	if (!ok) {
+		free(out);
+		return NULL;
+	}
+
+	return out;
+}
+
+/* CSV to binary and back. */
+static int test_convert(void)
+{
+	char *bin, *csv;
+	size_t bin_len, csv_len;
+	int errs;
+	const char *expected =
+		"I,1345974927,0.7.0.4\n"
+		"S,lmsensor coretemp-isa-0000 Physical id 0,101\n"
+		"S,lmsensor coretemp-isa-0000 Core 0,101\n"
+		"S,lmsensor coretemp-isa-0000 Core 1,101\n"
+		"0,37.0,37.0,36.0\n"
+		"5,36.0,,\n"
+		"I,1345975000,0.7.0.5\n"
+		"S,udisks2 /dev/sda,4101\n"
+		"3,41.5\n";
+
+	errs = 0;
+
+	bin = convert(CSV_LOG, strlen(CSV_LOG), SLOG_FORMAT_BINARY, &bin_len);
+	if (!bin) {
+		fprintf(stderr, "convert: csv to binary failed\n");
+		return 1;
+	}
+
+	if (bin_len >= strlen(CSV_LOG)) {
+		fprintf(stderr, "convert: binary is %zu bytes, csv %zu\n",
+			bin_len, strlen(CSV_LOG));
+		errs++;
+	}
+
+	csv = convert(bin, bin_len, SLOG_FORMAT_CSV, &csv_len);
+	if (!csv) {
+		fprintf(stderr, "convert: binary to csv failed\n");
+		errs++;
+	} else if (strcmp(csv, expected)) {
+		fprintf(stderr, "convert: %s\nexpected: %s\n", csv, expected);
+		errs++;
+	}
+
+	free(bin);
+	free(csv);
+
+	/* a record before any header */
+	if (convert("5,1.0\n", 6, SLOG_FORMAT_BINARY, &bin_len)) {
+		fprintf(stderr, "convert: invalid csv accepted\n");
+		errs++;
+	}
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	int errs;
+
+	errs = test_binary();
+	errs += test_csv();
+	errs += test_convert();
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
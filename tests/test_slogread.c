@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+/*
+ * Writes a log and a rotated segment, with two sections, and checks
+ * the queries of the reader against the values which were written.
+ */
+#define _GNU_SOURCE
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <io.h>
+#include <measure.h>
+#include <psensor.h>
+#include <slog.h>
+#include <slogfile.h>
+#include <slogfmt.h>
+#include <slogread.h>
+
+/* the reader must use several entries of the index */
+#define NRECORDS 150000
+#define NMORE 5000
+#define T0 1451606400
+
+/* first records in the segment, section 2 starts at SECTION2 */
+#define SEGMENT_END (NRECORDS * 2 / 5)
+#define SECTION2 (NRECORDS * 3 / 4)
+#define TOTAL (NRECORDS + NMORE)
+
+static char root[] = "/tmp/psensor-test-slogread-XXXXXX";
+
+static char *ids1[] = { "s0", "s1", "s2", "s3" };
+static char *ids2[] = { "s3", "s1", "new", "s0" };
+static unsigned int types[] = { 0x101, 0x101, 0x101, 0x101 };
+
+static const char *QUERY_IDS[] = { "s0", "s1", "s2", "new", "absent" };
+
+static enum slog_format format;
+
+static int64_t record_ms(int k)
+{
+	if (format == SLOG_FORMAT_CSV)
+		return ((int64_t)T0 + k) * 1000;
+
+	return ((int64_t)T0 + k) * 1000 + (k % 10) * 7;
+}
+
+/* value of the sensor 'id' at the record 'k', false if not logged */
+static bool record_value(int k, const char *id, double *v)
+{
+	char **ids;
+	int j;
+
+	ids = k < SECTION2 ? ids1 : ids2;
+
+	for (j = 0; j < 4; j++)
+		if (!strcmp(ids[j], id))
+			break;
+
+	if (j == 4)
+		return false;
+
+	/* the CSV format cannot log an unknown value */
+	if (format == SLOG_FORMAT_BINARY && id[1] == '1' && k % 50 == 7)
+		return false;
+
+	/* unchanged during 3 records */
+	*v = (double)(((k / 3) * 7 + id[1] * 13) % 1000) / 10;
+
+	return true;
+}
+
+static void encode_header(struct slog_encoder *e, struct pbuf *b, int k)
+{
+	struct slog_header h;
+
+	h.start = record_ms(k) / 1000;
+	h.version = "1.2.0";
+	h.n = 4;
+	h.ids = k < SECTION2 ? ids1 : ids2;
+	h.types = types;
+
+	slog_encode_header(e, b, &h);
+}
+
+static void encode_record(struct slog_encoder *e, struct pbuf *b, int k)
+{
+	struct timeval t;
+	double values[4];
+	char **ids;
+	int j;
+
+	ids = k < SECTION2 ? ids1 : ids2;
+	for (j = 0; j < 4; j++)
+		if (!record_value(k, ids[j], &values[j]))
+			values[j] = UNKNOWN_DOUBLE_VALUE;
+
+	t.tv_sec = record_ms(k) / 1000;
+	t.tv_usec = record_ms(k) % 1000 * 1000;
+
+	slog_encode_record(e, b, &t, values);
+}
+
+static void write_file(const char *path, const char *mode, struct pbuf *b)
+{
+	FILE *f;
+
+	f = fopen(path, mode);
+	fwrite(b->data, 1, b->len, f);
+	fclose(f);
+
+	pbuf_reset(b);
+}
+
+/* Writes the records [0, n) and returns the path of the log. */
+static char *write_log(int n)
+{
+	struct slog_encoder e;
+	struct pbuf b;
+	char *log, *segment;
+	int k;
+
+	if (asprintf(&log, "%s/sensors.log", root) == -1
+	    || asprintf(&segment, "%s.20160101-000000", log) == -1)
+		exit(EXIT_FAILURE);
+
+	pbuf_init(&b, 1024);
+
+	slog_encoder_init(&e, format);
+	encode_header(&e, &b, 0);
+	for (k = 0; k < SEGMENT_END; k++)
+		encode_record(&e, &b, k);
+	write_file(segment, "w", &b);
+	slog_encoder_free(&e);
+
+	/* a rotated log starts with a header */
+	slog_encoder_init(&e, format);
+	for (k = SEGMENT_END; k < n; k++) {
+		if (k == SEGMENT_END || k == SECTION2)
+			encode_header(&e, &b, k);
+		encode_record(&e, &b, k);
+	}
+	write_file(log, "w", &b);
+
+	slog_encoder_free(&e);
+	pbuf_free(&b);
+	free(segment);
+
+	return log;
+}
+
+static void append_log(const char *log)
+{
+	struct slog_encoder e;
+	struct pbuf b;
+	int k;
+
+	pbuf_init(&b, 1024);
+	slog_encoder_init(&e, format);
+
+	/* the encoder state of the last record is needed */
+	encode_header(&e, &b, SECTION2);
+	for (k = SECTION2; k < NRECORDS; k++)
+		encode_record(&e, &b, k);
+	pbuf_reset(&b);
+
+	for (; k < TOTAL; k++)
+		encode_record(&e, &b, k);
+	write_file(log, "a", &b);
+
+	slog_encoder_free(&e);
+	pbuf_free(&b);
+}
+
+static struct slog_sample *expected(const char *id,
+				    time_t t1,
+				    time_t t2,
+				    unsigned int step,
+				    int n,
+				    size_t *len)
+{
+	struct slog_sample *samples, *s;
+	int64_t ms, period;
+	double v;
+	int k, count;
+
+	samples = malloc((n + 1) * sizeof(*samples));
+	*len = 0;
+	s = NULL;
+	period = -1;
+	count = 0;
+
+	for (k = 0; k < n; k++) {
+		ms = record_ms(k);
+
+		if (ms < (int64_t)t1 * 1000
+		    || ms / 1000 > t2
+		    || !record_value(k, id, &v))
+			continue;
+
+		if (!step || (ms - t1 * 1000) / (step * 1000) != period) {
+			if (s && step)
+				s->value /= count;
+
+			s = &samples[(*len)++];
+			s->value = 0;
+			s->min = v;
+			s->max = v;
+			count = 0;
+
+			if (step) {
+				period = (ms - t1 * 1000) / (step * 1000);
+				ms = (t1 + period * step) * 1000;
+			}
+
+			s->time.tv_sec = ms / 1000;
+			s->time.tv_usec = ms % 1000 * 1000;
+		}
+
+		s->value += v;
+		if (v < s->min)
+			s->min = v;
+		if (v > s->max)
+			s->max = v;
+		count++;
+	}
+
+	if (s && step)
+		s->value /= count;
+
+	return samples;
+}
+
+static int check_query(struct slog_reader *r,
+		       const char *id,
+		       time_t t1,
+		       time_t t2,
+		       unsigned int step,
+		       int n)
+{
+	struct slog_sample *samples, *exp;
+	size_t len, exp_len, i;
+	int errs;
+
+	samples = slog_reader_query(r, id, t1, t2, step, &len);
+	exp = expected(id, t1, t2, step, n, &exp_len);
+
+	errs = 0;
+
+	if (len != exp_len) {
+		fprintf(stderr, "%s %s [%ld, %ld] %u: %zu samples expected: "
+			"%zu\n",
+			slog_format_to_str(format), id, (long)t1, (long)t2,
+			step, len, exp_len);
+		errs++;
+	}
+
+	for (i = 0; !errs && i < len; i++)
+		if (samples[i].time.tv_sec != exp[i].time.tv_sec
+		    || samples[i].time.tv_usec != exp[i].time.tv_usec
+		    || samples[i].value != exp[i].value
+		    || samples[i].min != exp[i].min
+		    || samples[i].max != exp[i].max) {
+			fprintf(stderr,
+				"%s %s [%ld, %ld] %u: sample %zu: "
+				"%ld.%06ld %f expected: %ld.%06ld %f\n",
+				slog_format_to_str(format), id,
+				(long)t1, (long)t2, step, i,
+				(long)samples[i].time.tv_sec,
+				(long)samples[i].time.tv_usec,
+				samples[i].value,
+				(long)exp[i].time.tv_sec,
+				(long)exp[i].time.tv_usec,
+				exp[i].value);
+			errs++;
+		}
+
+	free(samples);
+	free(exp);
+
+	return errs;
+}
+
+static int check_queries(struct slog_reader *r, int n)
+{
+	unsigned int i, j, step;
+	time_t t1, t2;
+	int errs;
+
+	errs = 0;
+
+	for (j = 0; j < sizeof(QUERY_IDS) / sizeof(QUERY_IDS[0]); j++) {
+		errs += check_query(r, QUERY_IDS[j], 0, LONG_MAX, 0, n);
+		errs += check_query(r, QUERY_IDS[j], 0, LONG_MAX, 3600, n);
+	}
+
+	srand(42);
+	for (i = 0; i < 30; i++) {
+		t1 = T0 - 10 + rand() % (TOTAL + 20);
+		t2 = t1 + rand() % 5000;
+		step = i % 2 ? 0 : 1 + rand() % 100;
+
+		for (j = 0; j < sizeof(QUERY_IDS) / sizeof(QUERY_IDS[0]); j++)
+			errs += check_query(r, QUERY_IDS[j], t1, t2, step, n);
+	}
+
+	return errs;
+}
+
+/* Loads the last records as the history of the sensors. */
+static int check_history(const char *log)
+{
+	struct psensor **sensors, *s;
+	struct measure *m;
+	double v;
+	int errs, i;
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	psensor_list_append(&sensors, psensor_create(strdup("s0"),
+						     strdup("s0"),
+						     strdup("chip"),
+						     0x101,
+						     100));
+	psensor_list_append(&sensors, psensor_create(strdup("absent"),
+						     strdup("absent"),
+						     strdup("chip"),
+						     0x101,
+						     100));
+
+	slog_load_history(log, sensors, T0 + NRECORDS - 50);
+
+	errs = 0;
+
+	s = sensors[0];
+	for (i = 0; i < 100; i++) {
+		m = &s->measures[i];
+
+		if (i < 50) {
+			if (timerisset(&m->time))
+				errs++;
+			continue;
+		}
+
+		record_value(NRECORDS - 100 + i, "s0", &v);
+		if (m->value != v
+		    || m->time.tv_sec != T0 + NRECORDS - 100 + i)
+			errs++;
+	}
+
+	if (timerisset(&sensors[1]->measures[99].time))
+		errs++;
+
+	if (errs)
+		fprintf(stderr, "%s: history not loaded\n",
+			slog_format_to_str(format));
+
+	psensor_list_free(sensors);
+
+	return errs;
+}
+
+static void cleanup(void)
+{
+	char **paths, **cur;
+
+	paths = dir_list(root, NULL);
+	if (paths) {
+		for (cur = paths; *cur; cur++)
+			unlink(*cur);
+		paths_free(paths);
+	}
+}
+
+static int test_format(enum slog_format f)
+{
+	struct slog_reader *r;
+	char *log, *idx;
+	size_t index_n;
+	int errs;
+
+	format = f;
+	errs = 0;
+
+	log = write_log(NRECORDS);
+
+	/* builds the indexes */
+	r = slog_reader_open(log, 0);
+	if (!r) {
+		fprintf(stderr, "%s: cannot open %s\n",
+			slog_format_to_str(format), log);
+		free(log);
+		return 1;
+	}
+
+	/* 3 headers and at least 2 entries every SLOG_INDEX_STEP */
+	if (r->n != 2
+	    || r->segments[0].index_n + r->segments[1].index_n < 5) {
+		fprintf(stderr, "%s: %zu segments\n",
+			slog_format_to_str(format), r->n);
+		errs++;
+	}
+
+	errs += check_queries(r, NRECORDS);
+	index_n = r->segments[1].index_n;
+	slog_reader_close(r);
+
+	/* the segment ends before */
+	r = slog_reader_open(log, T0 + SEGMENT_END + 10);
+	if (!r || r->n != 1) {
+		fprintf(stderr, "%s: segment not skipped\n",
+			slog_format_to_str(format));
+		errs++;
+	}
+	if (r)
+		slog_reader_close(r);
+
+	errs += check_history(log);
+
+	idx = slog_index_path(log);
+	if (access(idx, F_OK)) {
+		fprintf(stderr, "%s: %s not saved\n",
+			slog_format_to_str(format), idx);
+		errs++;
+	}
+	free(idx);
+
+	/* loads the indexes and decodes the appended records */
+	append_log(log);
+
+	r = slog_reader_open(log, 0);
+	if (r) {
+		if (r->segments[1].index_n < index_n) {
+			fprintf(stderr, "%s: index not reused\n",
+				slog_format_to_str(format));
+			errs++;
+		}
+
+		errs += check_queries(r, TOTAL);
+		slog_reader_close(r);
+	}
+
+	cleanup();
+	free(log);
+
+	return errs;
+}
+
+int main(int argc, char **argv)
+{
+	int failures;
+
+	if (!mkdtemp(root)) {
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+
+	failures = test_format(SLOG_FORMAT_BINARY);
+	failures += test_format(SLOG_FORMAT_CSV);
+
+	rmdir(root);
+
+	if (failures)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}
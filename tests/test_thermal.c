@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2010-2011 jeanfi@gmail.com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <psensor.h>
+#include <thermal.h>
+
+static char root[] = "/tmp/psensor-test-thermal-XXXXXX";
+
+static void mk(const char *path)
+{
+	char p[512];
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	if (mkdir(p, 0700)) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void wr(const char *path, const char *content)
+{
+	char p[512];
+	FILE *f;
+
+	snprintf(p, sizeof(p), "%s/%s", root, path);
+	f = fopen(p, "w");
+	if (!f) {
+		perror(p);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(f, "%s\n", content);
+	fclose(f);
+}
+
+/*
+ * A CPU zone with trip points, a zone without passive trip point,
+ * a disabled zone, a zone reported by lm-sensors and a cooling
+ * device.
+ */
+static void create_sysfs(void)
+{
+	mk("class");
+	mk("class/thermal");
+
+	mk("class/thermal/thermal_zone0");
+	wr("class/thermal/thermal_zone0/type", "x86_pkg_temp");
+	wr("class/thermal/thermal_zone0/temp", "48500");
+	wr("class/thermal/thermal_zone0/trip_point_0_type", "active");
+	wr("class/thermal/thermal_zone0/trip_point_0_temp", "60000");
+	wr("class/thermal/thermal_zone0/trip_point_1_type", "critical");
+	wr("class/thermal/thermal_zone0/trip_point_1_temp", "100000");
+	wr("class/thermal/thermal_zone0/trip_point_2_type", "passive");
+	wr("class/thermal/thermal_zone0/trip_point_2_temp", "85000");
+
+	mk("class/thermal/thermal_zone1");
+	wr("class/thermal/thermal_zone1/type", "gpu-thermal");
+	wr("class/thermal/thermal_zone1/temp", "41000");
+	wr("class/thermal/thermal_zone1/trip_point_0_type", "active");
+	wr("class/thermal/thermal_zone1/trip_point_0_temp", "60000");
+
+	mk("class/thermal/thermal_zone2");
+	wr("class/thermal/thermal_zone2/type", "disabled");
+
+	mk("class/thermal/thermal_zone3");
+	wr("class/thermal/thermal_zone3/type", "cpu-thermal");
+	wr("class/thermal/thermal_zone3/temp", "52000");
+
+	mk("class/thermal/cooling_device0");
+	wr("class/thermal/cooling_device0/type", "Processor");
+}
+
+static int rm(const char *path, const struct stat *st, int flag, struct FTW *f)
+{
+	return remove(path);
+}
+
+static struct psensor *get(struct psensor **sensors, const char *id)
+{
+	for (; *sensors; sensors++)
+		if (!strcmp((*sensors)->id, id))
+			return *sensors;
+
+	fprintf(stderr, "sensor not found: %s\n", id);
+
+	return NULL;
+}
+
+static int check(struct psensor **sensors,
+		 const char *id,
+		 const char *name,
+		 double value,
+		 double max)
+{
+	struct psensor *s;
+	double v;
+
+	s = get(sensors, id);
+	if (!s)
+		return 1;
+
+	if (strcmp(s->name, name)) {
+		fprintf(stderr, "%s: name: %s expected: %s\n",
+			id, s->name, name);
+		return 1;
+	}
+
+	v = psensor_get_current_value(s);
+	if (v != value) {
+		fprintf(stderr, "%s: value: %f expected: %f\n", id, v, value);
+		return 1;
+	}
+
+	if (s->max != max) {
+		fprintf(stderr, "%s: max: %f expected: %f\n", id, s->max, max);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct psensor **sensors, *s;
+	int errs;
+
+	if (!mkdtemp(root)) {
+		perror(root);
+		exit(EXIT_FAILURE);
+	}
+
+	create_sysfs();
+
+	thermal_set_sysfs_root(root);
+
+	sensors = malloc(sizeof(struct psensor *));
+	*sensors = NULL;
+
+	/* the zone cpu-thermal is already reported by lm-sensors */
+	s = psensor_create(strdup("lmsensor cpu_thermal-virtual-0 temp1"),
+			   strdup("temp1"),
+			   strdup("cpu_thermal"),
+			   SENSOR_TYPE_LMSENSOR | SENSOR_TYPE_TEMP,
+			   10);
+	psensor_list_append(&sensors, s);
+
+	thermal_psensor_list_append(&sensors, 10);
+
+	errs = 0;
+
+	if (psensor_list_size(sensors) != 3) {
+		fprintf(stderr, "returns %zu sensors, expected: 3\n",
+			psensor_list_size(sensors));
+		errs++;
+	}
+
+	thermal_psensor_list_update(sensors);
+
+	errs += check(sensors,
+		      "thermal thermal_zone0", "x86_pkg_temp", 48.5, 85);
+	errs += check(sensors,
+		      "thermal thermal_zone1", "gpu-thermal", 41,
+		      UNKNOWN_DOUBLE_VALUE);
+
+	/* the temperatures are read again through the opened files */
+	wr("class/thermal/thermal_zone0/temp", "61000");
+	thermal_psensor_list_update(sensors);
+	errs += check(sensors,
+		      "thermal thermal_zone0", "x86_pkg_temp", 61, 85);
+
+	psensor_list_free(sensors);
+
+	nftw(root, rm, 8, FTW_DEPTH | FTW_PHYS);
+
+	if (errs)
+		exit(EXIT_FAILURE);
+	else
+		exit(EXIT_SUCCESS);
+}